@@ -0,0 +1,63 @@
+#include "helpers/allocation_counter.h"
+
+#include <cstdlib>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+#include <new>
+
+namespace {
+thread_local size_t allocation_count = 0;
+
+void* counted_alloc (size_t size)
+{
+    ++allocation_count;
+    if (auto* p = std::malloc (size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc {};
+}
+
+void* counted_aligned_alloc (size_t size, std::align_val_t al)
+{
+    ++allocation_count;
+    auto alignment = static_cast<size_t> (al);
+    // aligned_alloc wants the size to be a multiple of the alignment
+    size = (size + alignment - 1) / alignment * alignment;
+#if defined(_MSC_VER)
+    auto* p = _aligned_malloc (size == 0 ? alignment : size, alignment);
+#else
+    auto* p = std::aligned_alloc (alignment, size == 0 ? alignment : size);
+#endif
+    if (p)
+        return p;
+    throw std::bad_alloc {};
+}
+
+void aligned_free (void* p)
+{
+#if defined(_MSC_VER)
+    _aligned_free (p);
+#else
+    std::free (p);
+#endif
+}
+} // namespace
+
+size_t allocation_counter::allocations_on_this_thread()
+{
+    return allocation_count;
+}
+
+void* operator new (size_t size) { return counted_alloc (size); }
+void* operator new[] (size_t size) { return counted_alloc (size); }
+void* operator new (size_t size, std::align_val_t al) { return counted_aligned_alloc (size, al); }
+void* operator new[] (size_t size, std::align_val_t al) { return counted_aligned_alloc (size, al); }
+
+void operator delete (void* p) noexcept { std::free (p); }
+void operator delete[] (void* p) noexcept { std::free (p); }
+void operator delete (void* p, size_t) noexcept { std::free (p); }
+void operator delete[] (void* p, size_t) noexcept { std::free (p); }
+void operator delete (void* p, std::align_val_t) noexcept { aligned_free (p); }
+void operator delete[] (void* p, std::align_val_t) noexcept { aligned_free (p); }
+void operator delete (void* p, size_t, std::align_val_t) noexcept { aligned_free (p); }
+void operator delete[] (void* p, size_t, std::align_val_t) noexcept { aligned_free (p); }
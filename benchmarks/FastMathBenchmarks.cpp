@@ -0,0 +1,75 @@
+#include "FastMath.hpp"
+#include "catch2/benchmark/catch_benchmark_all.hpp"
+#include "catch2/catch_test_macros.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+namespace fastmath = jnickg::audio::ws::fastmath;
+
+constexpr size_t BLOCK_SIZE = 256;
+
+// The harmonics VoicePool sums for OscillatorType::SineWithHarmonics
+constexpr std::array<float, 4> HARMONIC_WEIGHTS { 0.8f, 0.16f, 0.032f, 0.008f };
+constexpr std::array<float, 4> HARMONIC_FACTORS { 1.0f, 2.0f, 4.0f, 8.0f };
+
+/**
+ * @brief A block of inputs spread over [lo, hi], and somewhere to write the results.
+ */
+struct Block {
+    Block(float lo, float hi) {
+        for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+            this->in[i] = lo + (hi - lo) * static_cast<float>(i) / static_cast<float>(BLOCK_SIZE);
+        }
+    }
+
+    template <typename F>
+    float run(F f) {
+        for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+            this->out[i] = f(this->in[i]);
+        }
+        return this->out[BLOCK_SIZE / 2];
+    }
+
+    alignas(64) std::array<float, BLOCK_SIZE> in {};
+    alignas(64) std::array<float, BLOCK_SIZE> out {};
+};
+
+template <typename Sin>
+float harmonics(float t, Sin sin) {
+    auto val = 0.0f;
+    for (size_t i = 0; i < HARMONIC_WEIGHTS.size(); ++i) {
+        val += HARMONIC_WEIGHTS[i] * sin(HARMONIC_FACTORS[i] * t);
+    }
+    return val;
+}
+
+} // namespace
+
+TEST_CASE ("Fast math against libm, per block", "[!benchmark][fastmath]")
+{
+    constexpr auto pi = fastmath::PI;
+    Block phases(-pi, pi);
+    Block exponents(-8.0f, 8.0f);
+    Block gains(-4.0f, 4.0f);
+
+    BENCHMARK ("std::sin") { return phases.run([](float x) { return std::sin(x); }); };
+    BENCHMARK ("fastmath::sin") { return phases.run([](float x) { return fastmath::sin(x); }); };
+
+    // The voice oscillator's inner loop
+    BENCHMARK ("sine with harmonics, std::sin") { return phases.run([](float t) { return harmonics(t, [](float x) { return std::sin(x); }); }); };
+    BENCHMARK ("sine with harmonics, fastmath::sin") { return phases.run([](float t) { return harmonics(t, fastmath::sin); }); };
+
+    BENCHMARK ("std::exp2") { return exponents.run([](float x) { return std::exp2(x); }); };
+    BENCHMARK ("fastmath::exp2") { return exponents.run([](float x) { return fastmath::exp2(x); }); };
+
+    // Pitch bend
+    BENCHMARK ("std::pow(2, semitones / 12)") { return gains.run([](float s) { return static_cast<float>(std::pow(2.0, s / 12.0)); }); };
+    BENCHMARK ("fastmath::semitones_to_ratio") { return gains.run([](float s) { return fastmath::semitones_to_ratio(s); }); };
+
+    BENCHMARK ("std::tanh") { return gains.run([](float x) { return std::tanh(x); }); };
+    BENCHMARK ("fastmath::tanh") { return gains.run([](float x) { return fastmath::tanh(x); }); };
+}
@@ -0,0 +1,128 @@
+#include "LoadGenerator.hpp"
+#include "PluginProcessor.h"
+#include "catch2/benchmark/catch_benchmark_all.hpp"
+#include "catch2/catch_test_macros.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+namespace load = jnickg::audio::ws::load;
+
+constexpr double SAMPLE_RATE = 48000.0;
+constexpr int BLOCK_SIZE = 256;
+
+struct Workload {
+    std::string name;
+    load::Generator::Settings settings;
+};
+
+/**
+ * @brief A prepared processor, fed the workload's MIDI a block at a time.
+ *
+ * Key changes are applied between blocks with set_key(), as a UI thread would, which isn't timed.
+ */
+class Harness
+{
+public:
+    explicit Harness(const Workload& w)
+        : generator(w.settings, SAMPLE_RATE)
+        , buffer(2, BLOCK_SIZE)
+    {
+        plugin.set_chord_trace_enabled(false);
+        plugin.prepareToPlay(SAMPLE_RATE, BLOCK_SIZE);
+        midi.ensureSize(4096);
+    }
+
+    void next_midi() {
+        this->midi.clear();
+        if (auto key = this->generator.next_block(this->midi, BLOCK_SIZE)) {
+            this->plugin.set_key(*key);
+        }
+    }
+
+    void process_block() {
+        this->buffer.clear();
+        this->plugin.processBlock(this->buffer, this->midi);
+    }
+
+    /**
+     * @brief Average and worst time to render one block, as a fraction of the block's duration.
+     */
+    std::pair<double, double> load(double seconds) {
+        auto blocks = std::max(static_cast<int>(seconds * SAMPLE_RATE / BLOCK_SIZE), 1);
+        auto block_seconds = BLOCK_SIZE / SAMPLE_RATE;
+        double total = 0.0;
+        double worst = 0.0;
+        for (int i = 0; i < blocks; ++i) {
+            this->next_midi();
+            auto start = std::chrono::steady_clock::now();
+            this->process_block();
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            total += elapsed;
+            worst = std::max(worst, elapsed);
+        }
+        return { total / (blocks * block_seconds), worst / block_seconds };
+    }
+
+private:
+    load::Generator generator;
+    PluginProcessor plugin;
+    juce::AudioBuffer<float> buffer;
+    juce::MidiBuffer midi;
+};
+
+std::vector<Workload> get_workloads() {
+    std::vector<Workload> workloads;
+    for (int p = 0; p < load::Generator::NUM_PATTERNS; ++p) {
+        auto pattern = static_cast<load::Pattern>(p);
+        Workload w { load::to_string(pattern), {} };
+        w.settings.only(pattern);
+        workloads.push_back(w);
+    }
+    workloads.push_back({ "Everything", {} });
+    Workload dense { "Everything, 4x density", {} };
+    dense.settings.density = 4.0;
+    workloads.push_back(dense);
+    return workloads;
+}
+
+} // namespace
+
+TEST_CASE ("processBlock under generated load", "[!benchmark][load]")
+{
+    auto gui = juce::ScopedJuceInitialiser_GUI {};
+    auto workloads = get_workloads();
+
+    SECTION ("Per-block timings")
+    {
+        for (const auto& w : workloads) {
+            BENCHMARK_ADVANCED (w.name)
+            (Catch::Benchmark::Chronometer meter)
+            {
+                Harness harness(w);
+                meter.measure ([&] {
+                    harness.next_midi();
+                    harness.process_block();
+                });
+            };
+        }
+    }
+
+    SECTION ("Load report")
+    {
+        printf("\n");
+        for (const auto& w : workloads) {
+            Harness harness(w);
+            harness.load(1.0); // let the workload get going
+            auto [average, worst] = harness.load(60.0);
+            printf("%-32s %8.2f%% average %8.2f%% worst block\n", w.name.c_str(), 100.0 * average, 100.0 * worst);
+        }
+    }
+}
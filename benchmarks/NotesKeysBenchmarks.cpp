@@ -0,0 +1,80 @@
+#include "NotesKeys.hpp"
+#include "helpers/allocation_counter.h"
+#include "catch2/benchmark/catch_benchmark_all.hpp"
+#include "catch2/catch_test_macros.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace jnickg::audio;
+
+namespace {
+
+// The same key and notes the plugin uses on note-on
+const key_info key { note::A, scale::yonanuki };
+const note_info root { note::A, 3 };
+const chord_info min7_chord { root, chord::_min7, inversion::first };
+
+struct Case {
+    std::string name;
+    std::function<void()> call;
+};
+
+std::vector<Case> get_cases() {
+    // Each case returns its result through a sink, so the call can't be optimised away
+    static std::vector<chord_info> chords_sink;
+    static std::vector<int> midi_sink;
+    static std::vector<note_info> notes_sink;
+    static bool bool_sink;
+    static const auto all_chords = [] {
+        auto cs = get_chords(key, true);
+        std::reverse(cs.begin(), cs.end());
+        return cs;
+    }();
+
+    return {
+        { "init_chords (after first call)", [] { init_chords(); } },
+        { "get_chords(root)", [] { chords_sink = get_chords(root); } },
+        { "get_chords(root, inversions)", [] { chords_sink = get_chords(root, true); } },
+        { "get_chords(key)", [] { chords_sink = get_chords(key); } },
+        { "get_chords(key, inversions)", [] { chords_sink = get_chords(key, true); } },
+        { "get_chords(root, key)", [] { chords_sink = get_chords(root, key); } },
+        { "get_chords(root, key, inversions)", [] { chords_sink = get_chords(root, key, true); } },
+        { "chord_fits_key", [] { bool_sink = chord_fits_key(min7_chord, key); } },
+        { "chord_info::get_midi_notes", [] { midi_sink = min7_chord.get_midi_notes(); } },
+        { "std::sort(get_chords(key, inversions))", [] {
+            chords_sink = all_chords;
+            std::sort(chords_sink.begin(), chords_sink.end());
+        } },
+        { "key_info::key_notes", [] { notes_sink = key.key_notes(); } },
+    };
+}
+
+} // namespace
+
+TEST_CASE ("NotesKeys chord theory", "[!benchmark][NotesKeys]")
+{
+    // The first call builds the chord table; every case below measures the steady state
+    init_chords();
+    auto cases = get_cases();
+
+    SECTION ("Timings")
+    {
+        for (const auto& c : cases) {
+            BENCHMARK (c.name.c_str()) { c.call(); };
+        }
+    }
+
+    SECTION ("Allocations per call")
+    {
+        printf("\n");
+        for (const auto& c : cases) {
+            c.call(); // let the sinks reach their steady-state capacity
+            auto allocations = count_allocations([&] { c.call(); });
+            printf("%-48s %6zu allocations/call\n", c.name.c_str(), allocations);
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#include "Phaser.hpp"
+#include "catch2/benchmark/catch_benchmark_all.hpp"
+#include "catch2/catch_test_macros.hpp"
+
+#include <juce_dsp/juce_dsp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+using jnickg::audio::ws::StereoPhaser;
+
+constexpr double SAMPLE_RATE = 48000.0;
+constexpr int BLOCK_SIZE = 256;
+
+/**
+ * @brief Average wall-clock time per sample of process(), over the given duration of audio.
+ */
+template <typename Process>
+double ns_per_sample(double seconds, Process&& process) {
+    auto blocks = std::max(static_cast<int>(seconds * SAMPLE_RATE / BLOCK_SIZE), 1);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < blocks; ++i) {
+        process();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (blocks * BLOCK_SIZE);
+}
+
+} // namespace
+
+TEST_CASE ("StereoPhaser against juce::dsp::Phaser", "[!benchmark][phaser]")
+{
+    const juce::dsp::ProcessSpec spec { SAMPLE_RATE, BLOCK_SIZE, 2 };
+    juce::AudioBuffer<float> input(2, BLOCK_SIZE);
+    juce::Random random(1);
+    for (int ch = 0; ch < input.getNumChannels(); ++ch) {
+        for (int i = 0; i < BLOCK_SIZE; ++i) {
+            input.setSample(ch, i, 0.25f * (random.nextFloat() * 2.0f - 1.0f));
+        }
+    }
+    juce::AudioBuffer<float> buffer(2, BLOCK_SIZE);
+
+    // How the plugin configured juce::dsp::Phaser before StereoPhaser replaced it (always 6 stages),
+    // except for the feedback: it was 1.0, which rings on forever and would time denormals and NaNs
+    juce::dsp::Phaser<float> juce_phaser;
+    juce_phaser.setRate(0.5f);
+    juce_phaser.setDepth(0.7f);
+    juce_phaser.setCentreFrequency(0.56f);
+    juce_phaser.setFeedback(0.7f);
+    juce_phaser.setMix(0.7f);
+    juce_phaser.prepare(spec);
+    auto process_juce = [&] {
+        buffer.makeCopyOf(input, true);
+        juce::dsp::AudioBlock<float> block(buffer);
+        juce_phaser.process(juce::dsp::ProcessContextReplacing<float>(block));
+    };
+
+    // The plugin's default configuration
+    StereoPhaser phaser;
+    phaser.set_parameters(StereoPhaser::Parameters {});
+    phaser.prepare(SAMPLE_RATE);
+    auto process_stereo = [&] {
+        buffer.makeCopyOf(input, true);
+        juce::dsp::AudioBlock<float> block(buffer);
+        phaser.process(juce::dsp::ProcessContextReplacing<float>(block));
+    };
+
+    SECTION ("Per-block timings")
+    {
+        BENCHMARK ("juce::dsp::Phaser, 6 stages")
+        {
+            process_juce();
+            return buffer.getSample(0, 0);
+        };
+        BENCHMARK ("StereoPhaser, 6 stages")
+        {
+            process_stereo();
+            return buffer.getSample(0, 0);
+        };
+    }
+
+    SECTION ("Cost relative to juce::dsp::Phaser")
+    {
+        ns_per_sample(0.25, process_juce); // warm up caches
+        auto baseline = ns_per_sample(2.0, process_juce);
+        ns_per_sample(0.25, process_stereo);
+        auto ns = ns_per_sample(2.0, process_stereo);
+        printf("\n%-28s %10.2f ns/sample %8.2fx\n", "juce::dsp::Phaser", baseline, 1.0);
+        printf("%-28s %10.2f ns/sample %8.2fx\n", "StereoPhaser", ns, ns / baseline);
+    }
+}
@@ -0,0 +1,197 @@
+#include "PluginProcessor.h"
+#include "catch2/benchmark/catch_benchmark_all.hpp"
+#include "catch2/catch_test_macros.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+using OscillatorType = jnickg::audio::ws::Voice::OscillatorType;
+using PhaserMode = PluginProcessor::PhaserMode;
+
+struct Scenario {
+    double sample_rate { 48000.0 };
+    int block_size { 256 };
+    int voices { 8 };
+    OscillatorType osc { OscillatorType::SineWithHarmonics };
+    size_t chord_tones { 5 };
+    bool partial_sharing { false };
+    PhaserMode phaser { PhaserMode::Global };
+};
+
+std::string to_string(OscillatorType t) {
+    switch (t) {
+        case OscillatorType::Sine: return "sine";
+        case OscillatorType::Saw: return "saw";
+        case OscillatorType::Square: return "square";
+        case OscillatorType::Triangle: return "triangle";
+        case OscillatorType::SineWithHarmonics: return "sine+harmonics";
+        default: return "?";
+    }
+}
+
+std::string to_string(const Scenario& s) {
+    return std::to_string(static_cast<int>(s.sample_rate)) + "Hz"
+        + " / " + std::to_string(s.block_size) + " samples"
+        + " / " + std::to_string(s.voices) + " voices"
+        + " / " + to_string(s.osc)
+        + " / <=" + std::to_string(s.chord_tones) + " tones"
+        + (s.partial_sharing ? " / shared partials" : "")
+        + (s.phaser == PhaserMode::PerVoice ? " / per-voice phaser" : "");
+}
+
+/**
+ * @brief A processor, prepared for the scenario, holding one note per requested voice.
+ */
+class Harness
+{
+public:
+    explicit Harness(const Scenario& s)
+        : scenario(s)
+        , buffer(2, s.block_size)
+    {
+        plugin.set_oscillator_type(s.osc);
+        plugin.set_max_chord_tones(s.chord_tones);
+        plugin.set_partial_sharing(s.partial_sharing);
+        plugin.set_phaser_mode(s.phaser);
+        plugin.prepareToPlay(s.sample_rate, s.block_size);
+
+        // Notes in the plugin's key (A Yonanuki), so every voice finds a real chord
+        auto key = jnickg::audio::key_info { jnickg::audio::note::A, jnickg::audio::scale::yonanuki };
+        std::vector<int> notes;
+        for (int octave = 2; notes.size() < static_cast<size_t>(s.voices); ++octave) {
+            for (auto& n : key.key_notes(octave)) {
+                if (notes.size() < static_cast<size_t>(s.voices)) {
+                    notes.push_back(n.to_midi());
+                }
+            }
+        }
+        for (auto note : notes) {
+            note_ons.addEvent(juce::MidiMessage::noteOn(1, note, 0.8f), 0);
+        }
+
+        this->process(this->note_ons);
+    }
+
+    void process_block() {
+        this->process(this->empty);
+    }
+
+    /**
+     * @brief Average wall-clock time to render one sample, over the given duration of audio.
+     */
+    double ns_per_sample(double seconds) {
+        auto blocks = std::max(static_cast<int>(seconds * this->scenario.sample_rate / this->scenario.block_size), 1);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < blocks; ++i) {
+            this->process_block();
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / (blocks * this->scenario.block_size);
+    }
+
+private:
+    void process(juce::MidiBuffer& midi) {
+        this->buffer.clear();
+        this->plugin.processBlock(this->buffer, midi);
+    }
+
+    Scenario scenario;
+    PluginProcessor plugin;
+    juce::AudioBuffer<float> buffer;
+    juce::MidiBuffer note_ons;
+    juce::MidiBuffer empty;
+};
+
+/**
+ * @brief Prints ns/sample/voice and the real-time factor (audio time / CPU time) for the scenario.
+ */
+void report(const Scenario& s) {
+    Harness harness(s);
+    harness.ns_per_sample(0.25); // warm up caches and let the SilenceGates settle
+    auto ns = harness.ns_per_sample(2.0);
+    auto realtime_factor = 1.0e9 / (ns * s.sample_rate);
+    printf("%-64s %10.2f ns/sample %10.2f ns/sample/voice %10.1fx realtime\n",
+           to_string(s).c_str(),
+           ns,
+           ns / s.voices,
+           realtime_factor);
+}
+
+void benchmark(const Scenario& s) {
+    // Built once, outside the timed samples: preparing the plugin allocates and loads far more than a block costs
+    Harness harness(s);
+    harness.ns_per_sample(0.25); // warm up caches and let the SilenceGates settle
+    BENCHMARK_ADVANCED (to_string(s))
+    (Catch::Benchmark::Chronometer meter)
+    {
+        meter.measure ([&] { harness.process_block(); });
+    };
+}
+
+} // namespace
+
+TEST_CASE ("processBlock throughput", "[!benchmark][processBlock]")
+{
+    auto gui = juce::ScopedJuceInitialiser_GUI {};
+    const Scenario defaults;
+
+    // Each axis is swept on its own around the defaults; the full grid would take hours
+    std::vector<Scenario> scenarios;
+    for (auto block_size : { 32, 64, 128, 256, 512, 1024, 2048, 4096 }) {
+        auto s = defaults;
+        s.block_size = block_size;
+        scenarios.push_back(s);
+    }
+    for (auto sample_rate : { 44100.0, 88200.0, 96000.0, 192000.0 }) {
+        auto s = defaults;
+        s.sample_rate = sample_rate;
+        scenarios.push_back(s);
+    }
+    for (auto voices : { 1, 2, 4, 8, 16 }) {
+        auto s = defaults;
+        s.voices = voices;
+        scenarios.push_back(s);
+    }
+    for (auto osc : { OscillatorType::Sine, OscillatorType::Saw, OscillatorType::Square, OscillatorType::Triangle, OscillatorType::SineWithHarmonics }) {
+        auto s = defaults;
+        s.osc = osc;
+        scenarios.push_back(s);
+    }
+    for (auto tones : { 1, 3, 5 }) {
+        auto s = defaults;
+        s.chord_tones = static_cast<size_t>(tones);
+        scenarios.push_back(s);
+    }
+    // Chords in one key overlap, so more voices means more duplicate pitches to share
+    for (auto sharing : { false, true }) {
+        auto s = defaults;
+        s.voices = 16;
+        s.partial_sharing = sharing;
+        scenarios.push_back(s);
+    }
+    for (auto phaser : { PhaserMode::Global, PhaserMode::PerVoice }) {
+        auto s = defaults;
+        s.phaser = phaser;
+        scenarios.push_back(s);
+    }
+
+    SECTION ("Per-block timings")
+    {
+        for (const auto& s : scenarios) {
+            benchmark(s);
+        }
+    }
+
+    SECTION ("Capacity report")
+    {
+        printf("\n");
+        for (const auto& s : scenarios) {
+            report(s);
+        }
+    }
+}
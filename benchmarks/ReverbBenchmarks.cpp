@@ -0,0 +1,199 @@
+#include "FdnReverb.hpp"
+#include "ImpulseResponses.hpp"
+#include "PluginProcessor.h"
+#include "catch2/benchmark/catch_benchmark_all.hpp"
+#include "catch2/catch_test_macros.hpp"
+
+#include <juce_dsp/juce_dsp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using jnickg::audio::ws::FdnReverb;
+namespace ir = jnickg::audio::ws::ir;
+
+constexpr double SAMPLE_RATE = 48000.0;
+constexpr int BLOCK_SIZE = 256;
+
+std::string to_string(FdnReverb::Quality q) {
+    switch (q) {
+        case FdnReverb::Quality::Eco: return "Eco";
+        case FdnReverb::Quality::Standard: return "Standard";
+        case FdnReverb::Quality::High: return "High";
+        default: return "?";
+    }
+}
+
+/**
+ * @brief A stereo block of noise, so neither reverb gets to run on zeros.
+ */
+juce::AudioBuffer<float> make_input() {
+    juce::AudioBuffer<float> input(2, BLOCK_SIZE);
+    juce::Random random(1);
+    for (int ch = 0; ch < input.getNumChannels(); ++ch) {
+        for (int i = 0; i < BLOCK_SIZE; ++i) {
+            input.setSample(ch, i, 0.25f * (random.nextFloat() * 2.0f - 1.0f));
+        }
+    }
+    return input;
+}
+
+/**
+ * @brief Average wall-clock time per sample of process(), over the given duration of audio.
+ */
+template <typename Process>
+double ns_per_sample(double seconds, Process&& process) {
+    auto blocks = std::max(static_cast<int>(seconds * SAMPLE_RATE / BLOCK_SIZE), 1);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < blocks; ++i) {
+        process();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (blocks * BLOCK_SIZE);
+}
+
+} // namespace
+
+TEST_CASE ("FDN reverb against juce::dsp::Reverb", "[!benchmark][reverb]")
+{
+    const juce::dsp::ProcessSpec spec { SAMPLE_RATE, BLOCK_SIZE, 2 };
+    const auto input = make_input();
+    juce::AudioBuffer<float> buffer(2, BLOCK_SIZE);
+
+    // Same wet/dry/width as the FDN's defaults, which map onto juce::dsp::Reverb's parameters
+    FdnReverb::Parameters fdn_params;
+    juce::dsp::Reverb::Parameters juce_params;
+    juce_params.wetLevel = fdn_params.wet_level;
+    juce_params.dryLevel = fdn_params.dry_level;
+    juce_params.width = fdn_params.width;
+    juce_params.damping = fdn_params.damping;
+
+    juce::dsp::Reverb freeverb;
+    freeverb.setParameters(juce_params);
+    freeverb.prepare(spec);
+    auto process_freeverb = [&] {
+        buffer.makeCopyOf(input, true);
+        juce::dsp::AudioBlock<float> block(buffer);
+        freeverb.process(juce::dsp::ProcessContextReplacing<float>(block));
+    };
+
+    const auto qualities = { FdnReverb::Quality::Eco, FdnReverb::Quality::Standard, FdnReverb::Quality::High };
+
+    SECTION ("Per-block timings")
+    {
+        BENCHMARK ("juce::dsp::Reverb")
+        {
+            process_freeverb();
+            return buffer.getSample(0, 0);
+        };
+
+        for (auto quality : qualities) {
+            FdnReverb reverb;
+            fdn_params.quality = quality;
+            reverb.set_parameters(fdn_params);
+            reverb.prepare(spec);
+            BENCHMARK ("FDN reverb, " + to_string(quality))
+            {
+                buffer.makeCopyOf(input, true);
+                reverb.process(buffer.getWritePointer(0), buffer.getWritePointer(1), BLOCK_SIZE);
+                return buffer.getSample(0, 0);
+            };
+        }
+    }
+
+    SECTION ("Cost relative to juce::dsp::Reverb")
+    {
+        ns_per_sample(0.25, process_freeverb); // warm up caches
+        auto baseline = ns_per_sample(2.0, process_freeverb);
+        printf("\n%-24s %10.2f ns/sample %8.2fx\n", "juce::dsp::Reverb", baseline, 1.0);
+
+        for (auto quality : qualities) {
+            FdnReverb reverb;
+            fdn_params.quality = quality;
+            reverb.set_parameters(fdn_params);
+            reverb.prepare(spec);
+            auto process_fdn = [&] {
+                buffer.makeCopyOf(input, true);
+                reverb.process(buffer.getWritePointer(0), buffer.getWritePointer(1), BLOCK_SIZE);
+            };
+            ns_per_sample(0.25, process_fdn);
+            auto ns = ns_per_sample(2.0, process_fdn);
+            printf("%-24s %10.2f ns/sample %8.2fx\n", ("FDN reverb, " + to_string(quality)).c_str(), ns, ns / baseline);
+        }
+    }
+}
+
+TEST_CASE ("Convolution reverb, worst-case block", "[!benchmark][reverb]")
+{
+    // The plugin's convolver and its longest IR, at the smallest buffer it's tuned for. The mean
+    // hides the blocks where a tail partition fills up and is computed in process()
+    constexpr int block_size = PluginProcessor::CONVOLUTION_HEAD_SIZE;
+    constexpr double seconds = 20.0;
+    const juce::dsp::ProcessSpec spec { SAMPLE_RATE, block_size, 2 };
+
+    juce::dsp::Convolution convolution { juce::dsp::Convolution::NonUniform { PluginProcessor::CONVOLUTION_HEAD_SIZE } };
+    convolution.prepare(spec);
+    convolution.loadImpulseResponse(ir::generate(ir::Space::temple_hall, SAMPLE_RATE),
+                                    SAMPLE_RATE,
+                                    juce::dsp::Convolution::Stereo::yes,
+                                    juce::dsp::Convolution::Trim::no,
+                                    juce::dsp::Convolution::Normalise::yes);
+
+    juce::AudioBuffer<float> buffer(2, block_size);
+    juce::Random random(1);
+    auto process = [&] {
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+            for (int i = 0; i < block_size; ++i) {
+                buffer.setSample(ch, i, 0.25f * (random.nextFloat() * 2.0f - 1.0f));
+            }
+        }
+        juce::dsp::AudioBlock<float> block(buffer);
+        convolution.process(juce::dsp::ProcessContextReplacing<float>(block));
+    };
+
+    // The IR is installed by a later process() call, once JUCE's loader thread has prepared it
+    for (int i = 0; i < 1000 && convolution.getCurrentIRSize() == 0; ++i) {
+        process();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    REQUIRE(convolution.getCurrentIRSize() > 0);
+
+    // Run the tail through once, so every partition has been computed before timing
+    const auto blocks = static_cast<int>(seconds * SAMPLE_RATE / block_size);
+    for (int i = 0; i < static_cast<int>(ir::get_length_seconds(ir::Space::temple_hall) * SAMPLE_RATE / block_size); ++i) {
+        process();
+    }
+
+    std::vector<double> block_ns;
+    block_ns.reserve(static_cast<size_t>(blocks));
+    for (int i = 0; i < blocks; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        process();
+        auto end = std::chrono::steady_clock::now();
+        block_ns.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+
+    std::sort(block_ns.begin(), block_ns.end());
+    auto mean = 0.0;
+    for (auto ns : block_ns) {
+        mean += ns / static_cast<double>(block_ns.size());
+    }
+    auto p99 = block_ns[block_ns.size() * 99 / 100];
+    auto worst = block_ns.back();
+    auto deadline_ns = 1.0e9 * block_size / SAMPLE_RATE;
+    printf("\n%s IR (%.1f s), %d-sample blocks at %.0f Hz, %d blocks:\n",
+           ir::to_string(ir::Space::temple_hall).c_str(),
+           ir::get_length_seconds(ir::Space::temple_hall),
+           block_size,
+           SAMPLE_RATE,
+           blocks);
+    printf("%-8s %12.0f ns %8.1f%% of the deadline\n", "mean", mean, 100.0 * mean / deadline_ns);
+    printf("%-8s %12.0f ns %8.1f%% of the deadline\n", "p99", p99, 100.0 * p99 / deadline_ns);
+    printf("%-8s %12.0f ns %8.1f%% of the deadline\n", "worst", worst, 100.0 * worst / deadline_ns);
+}
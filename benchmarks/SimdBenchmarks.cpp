@@ -0,0 +1,82 @@
+#include "FdnReverb.hpp"
+#include "SimdDispatch.hpp"
+#include "VoicePool.hpp"
+#include "catch2/benchmark/catch_benchmark_all.hpp"
+#include "catch2/catch_test_macros.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace simd = jnickg::audio::ws::simd;
+using jnickg::audio::ws::FdnReverb;
+using jnickg::audio::ws::VoicePool;
+
+constexpr double SAMPLE_RATE = 48000.0;
+constexpr int BLOCK_SIZE = 256;
+constexpr size_t VOICES = 16;
+
+/**
+ * @brief A pool with VOICES five-note voices held, of the given waveform.
+ */
+std::unique_ptr<VoicePool> make_pool(VoicePool::OscillatorType type) {
+    auto pool = std::make_unique<VoicePool>();
+    pool->prepare(SAMPLE_RATE);
+    for (size_t v = 0; v < VOICES; ++v) {
+        auto& envelope = pool->get_envelope(v);
+        envelope.setSampleRate(SAMPLE_RATE);
+        envelope.setParameters({ 0.01f, 0.1f, 0.8f, 1.0f });
+        pool->set_oscillator_type(v, type);
+        for (size_t t = 0; t < VoicePool::MAX_TONES; ++t) {
+            pool->set_frequency(v, t, 110.0f * static_cast<float>(v + 1) + 50.0f * static_cast<float>(t));
+        }
+        pool->set_num_tones(v, VoicePool::MAX_TONES);
+        envelope.noteOn();
+        pool->set_held(v, true);
+    }
+    return pool;
+}
+
+} // namespace
+
+TEST_CASE ("Kernels per instruction set", "[!benchmark][simd]")
+{
+    auto best = simd::get_best();
+    std::vector<float> left(BLOCK_SIZE, 0.0f);
+    std::vector<float> right(BLOCK_SIZE, 0.0f);
+
+    for (int i = static_cast<int>(simd::Isa::__FIRST); i < static_cast<int>(simd::Isa::__COUNT); ++i) {
+        auto isa = static_cast<simd::Isa>(i);
+        if (!simd::is_supported(isa)) {
+            continue;
+        }
+        simd::set_active(isa);
+        auto name = simd::to_string(isa);
+
+        for (auto type : { VoicePool::OscillatorType::Sine, VoicePool::OscillatorType::SineWithHarmonics }) {
+            auto pool = make_pool(type);
+            auto label = type == VoicePool::OscillatorType::Sine ? "sine" : "sine+harmonics";
+            BENCHMARK (name + ": 16 voices, 5 tones, " + label)
+            {
+                pool->render(left.data(), BLOCK_SIZE);
+                return left[0];
+            };
+        }
+
+        FdnReverb reverb;
+        FdnReverb::Parameters params;
+        params.quality = FdnReverb::Quality::High;
+        reverb.set_parameters(params);
+        reverb.prepare({ SAMPLE_RATE, BLOCK_SIZE, 2 });
+        left[0] = 1.0f;
+        BENCHMARK (name + ": FDN reverb, High")
+        {
+            reverb.process(left.data(), right.data(), BLOCK_SIZE);
+            return left[0];
+        };
+    }
+
+    simd::set_active(best);
+}
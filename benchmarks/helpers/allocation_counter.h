@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+/* Counts calls to the global operator new (all forms) made by the calling thread.
+ *
+ * The replacement operators live in AllocationCounter.cpp and are linked into the whole Benchmarks
+ * target, so anything that allocates through new/delete (std::vector, std::string, std::map, ...)
+ * is counted.
+ *
+ * Example usage
+ *
+  auto allocs = count_allocations ([&] { notes = key.key_notes(); });
+
+ */
+namespace allocation_counter {
+
+/// Number of allocations made by this thread since it started.
+size_t allocations_on_this_thread();
+
+} // namespace allocation_counter
+
+template <typename Fn>
+[[maybe_unused]] static size_t count_allocations (Fn&& fn)
+{
+    auto before = allocation_counter::allocations_on_this_thread();
+    fn();
+    return allocation_counter::allocations_on_this_thread() - before;
+}
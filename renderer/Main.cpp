@@ -0,0 +1,176 @@
+#include "OfflineRenderer.hpp"
+
+#include <juce_events/juce_events.h>
+
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+namespace offline = jnickg::audio::ws::offline;
+
+namespace {
+
+constexpr auto USAGE = "<input.mid> <output.wav|output.flac> [options]";
+constexpr auto BATCH_USAGE = "--batch <jobs.txt> [--threads=<n>] [options]";
+
+constexpr auto HELP =
+    "Renders a Standard MIDI File through the synth, without a host or audio device, as fast as\n"
+    "the machine allows.\n"
+    "\n"
+    "Options:\n"
+    "  --sample-rate=<hz>     Default 48000\n"
+    "  --block-size=<n>       Samples per processBlock call. Default 512\n"
+    "  --seed=<n>             Seeds the chord choices; the same seed renders the same audio. Default 1\n"
+    "  --key=<root_scale>     E.g. A_yonanuki (the default), F#_minor or Bb_harmonic_minor\n"
+    "  --bpm=<bpm>            Tempo for the echoes. Default: the file's first tempo, or 120\n"
+    "  --tail=<seconds>       Rendered after the last event. Default: the synth's tail length\n"
+    "  --bits=<16|24|32>      Sample format; 32 is floating point (WAV only). Default 24\n"
+    "  --trace-chords         Log each chord the voices pick\n";
+
+constexpr auto BATCH_HELP =
+    "Renders many MIDI files at once, each in its own instance of the synth, one per CPU core\n"
+    "(or --threads=<n>).\n"
+    "\n"
+    "Each line of the jobs file is \"<input.mid> <output.wav|output.flac> [options]\", with paths\n"
+    "relative to the jobs file. Options on a line override those on the command line. Empty lines\n"
+    "and lines starting with # are skipped.\n";
+
+template <typename T>
+T get_number(const juce::ArgumentList& args, const juce::String& option, T default_value) {
+    if (!args.containsOption(option)) {
+        return default_value;
+    }
+    auto value = args.getValueForOption(option).trim();
+    if (value.isEmpty() || !value.containsOnly("0123456789.")) {
+        juce::ConsoleApplication::fail("Expected a number for " + option + ", e.g. " + option + "=" + juce::String(default_value));
+    }
+    return static_cast<T>(value.getDoubleValue());
+}
+
+// Options not given in args keep the value they have in job
+void parse_options(const juce::ArgumentList& args, offline::Job& job) {
+    auto& options = job.options;
+    options.sample_rate = get_number(args, "--sample-rate", options.sample_rate);
+    options.block_size = get_number(args, "--block-size", options.block_size);
+    options.seed = get_number(args, "--seed", options.seed);
+    options.bpm = get_number(args, "--bpm", options.bpm);
+    options.tail_seconds = get_number(args, "--tail", options.tail_seconds);
+    options.trace_chords = options.trace_chords || args.containsOption("--trace-chords");
+    job.bits_per_sample = get_number(args, "--bits", job.bits_per_sample);
+    if (args.containsOption("--key")) {
+        try {
+            options.key = jnickg::audio::parse_key(args.getValueForOption("--key").toStdString());
+        } catch (const std::exception& e) {
+            juce::ConsoleApplication::fail(e.what());
+        }
+    }
+    if (options.sample_rate <= 0.0 || options.block_size <= 0) {
+        juce::ConsoleApplication::fail("The sample rate and block size must be positive");
+    }
+}
+
+juce::Array<juce::ArgumentList::Argument> get_paths(const juce::ArgumentList& args) {
+    juce::Array<juce::ArgumentList::Argument> paths;
+    for (const auto& arg : args.arguments) {
+        if (!arg.isOption()) {
+            paths.add(arg);
+        }
+    }
+    return paths;
+}
+
+void render(const juce::ArgumentList& args) {
+    auto paths = get_paths(args);
+    if (paths.size() != 2) {
+        juce::ConsoleApplication::fail(juce::String("Usage: ") + args.executableName + " " + USAGE);
+    }
+    offline::Job job;
+    job.input = paths[0].resolveAsExistingFile();
+    job.output = paths[1].resolveAsFile();
+    parse_options(args, job);
+
+    try {
+        auto sequence = offline::load_midi_file(job.input);
+        auto result = offline::render_to_file(sequence, job.options, job.output, job.bits_per_sample);
+        printf("Rendered %.2f s of audio in %.2f s (%.1fx real time): %s\n",
+               result.get_audio_seconds(),
+               result.render_seconds,
+               result.get_realtime_factor(),
+               job.output.getFullPathName().toRawUTF8());
+    } catch (const std::exception& e) {
+        juce::ConsoleApplication::fail(e.what());
+    }
+}
+
+void render_batch(const juce::ArgumentList& args) {
+    auto paths = get_paths(args);
+    if (paths.size() != 1) {
+        juce::ConsoleApplication::fail(juce::String("Usage: ") + args.executableName + " " + BATCH_USAGE);
+    }
+    auto list = paths[0].resolveAsExistingFile();
+    offline::Job defaults;
+    parse_options(args, defaults);
+    auto num_threads = get_number(args, "--threads", 0);
+
+    std::vector<offline::Job> jobs;
+    juce::StringArray lines;
+    list.readLines(lines);
+    for (const auto& raw_line : lines) {
+        auto line = raw_line.trim();
+        if (line.isEmpty() || line.startsWithChar('#')) {
+            continue;
+        }
+        juce::ArgumentList line_args(args.executableName, juce::StringArray::fromTokens(line, true));
+        auto line_paths = get_paths(line_args);
+        if (line_paths.size() != 2) {
+            juce::ConsoleApplication::fail("Expected \"<input.mid> <output> [options]\" in " + list.getFileName() + ": " + line);
+        }
+        auto job = defaults;
+        job.input = list.getParentDirectory().getChildFile(line_paths[0].text.unquoted());
+        job.output = list.getParentDirectory().getChildFile(line_paths[1].text.unquoted());
+        parse_options(line_args, job);
+        jobs.push_back(job);
+    }
+
+    auto batch = offline::render_batch(jobs, num_threads, [](const offline::JobResult& r) {
+        if (r.ok) {
+            printf("%8.2f s in %7.2f s (%6.1fx real time): %s\n",
+                   r.result.get_audio_seconds(),
+                   r.result.render_seconds,
+                   r.result.get_realtime_factor(),
+                   r.job.output.getFullPathName().toRawUTF8());
+        } else {
+            printf("FAILED: %s: %s\n", r.job.input.getFullPathName().toRawUTF8(), r.error.toRawUTF8());
+        }
+        fflush(stdout);
+    });
+
+    printf("Rendered %zu of %zu files, %.2f s of audio in %.2f s on %d threads: %.1fx real time, %.1f cores busy\n",
+           batch.jobs.size() - batch.get_num_failed(),
+           batch.jobs.size(),
+           batch.get_audio_seconds(),
+           batch.wall_seconds,
+           batch.num_threads,
+           batch.get_realtime_factor(),
+           batch.get_parallelism());
+    if (batch.get_num_failed() > 0) {
+        juce::ConsoleApplication::fail(juce::String(static_cast<int>(batch.get_num_failed())) + " jobs failed");
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    // The processor's background threads (e.g. the impulse response loader) expect JUCE to be up
+    juce::ScopedJuceInitialiser_GUI juce_init;
+
+    juce::ConsoleApplication app;
+    app.addHelpCommand("--help|-h",
+                       juce::String("Usage: WabiSonoranceRender ") + USAGE + "\n"
+                           + "       WabiSonoranceRender " + BATCH_USAGE + "\n\n" + HELP + "\n" + BATCH_HELP,
+                       true);
+    app.addCommand({ "--batch", BATCH_USAGE, "Renders a list of MIDI files in parallel", BATCH_HELP, render_batch });
+    app.addDefaultCommand({ "", USAGE, "Renders a MIDI file to WAV or FLAC", HELP, render });
+    return app.run(argc, argv);
+}
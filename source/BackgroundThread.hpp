@@ -0,0 +1,30 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief The one thread that every plugin instance's housekeeping (KeySwitcher, ChordLog) runs on.
+ *
+ * Each client is a juce::TimeSliceClient whose useTimeSlice() returns how long it can wait before
+ * it's called again; the thread sleeps until the soonest client is due. Hold it through a
+ * juce::SharedResourcePointer, so it's started by the first holder and stopped with the last.
+ */
+class BackgroundThread : public juce::TimeSliceThread
+{
+public:
+    static inline constexpr int STOP_TIMEOUT_MS = 1000;
+
+    BackgroundThread()
+        : juce::TimeSliceThread("WabiSonorance background")
+    {
+        this->startThread();
+    }
+
+    ~BackgroundThread() override {
+        this->stopThread(STOP_TIMEOUT_MS);
+    }
+};
+
+} // namespace jnickg::audio::ws
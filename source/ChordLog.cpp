@@ -0,0 +1,109 @@
+#include "ChordLog.hpp"
+
+#include <cstdio>
+
+namespace jnickg::audio::ws {
+
+ChordLog::ChordLog()
+    : start_ticks(juce::Time::getHighResolutionTicks())
+{
+    // no-op
+}
+
+ChordLog::~ChordLog() {
+    this->stop();
+}
+
+void ChordLog::start() {
+    this->background->addTimeSliceClient(this);
+}
+
+void ChordLog::stop() {
+    this->background->removeTimeSliceClient(this);
+    this->flush();
+}
+
+bool ChordLog::push(const Record& r) {
+    int start1, size1, start2, size2;
+    this->fifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 < 1) {
+        this->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    this->records[static_cast<size_t>(size1 > 0 ? start1 : start2)] = r;
+    this->fifo.finishedWrite(1);
+    return true;
+}
+
+void ChordLog::set_output_file(const juce::File& f) {
+    const juce::ScopedLock lock(this->output_lock);
+    this->file.reset();
+    if (f == juce::File()) {
+        return;
+    }
+    auto stream = std::make_unique<juce::FileOutputStream>(f);
+    if (stream->openedOk()) {
+        stream->setPosition(0);
+        stream->truncate();
+        this->file = std::move(stream);
+    }
+}
+
+void ChordLog::flush() {
+    this->drain();
+}
+
+int ChordLog::useTimeSlice() {
+    this->drain();
+    return DRAIN_INTERVAL_MS;
+}
+
+void ChordLog::drain() {
+    // Only one consumer may read the FIFO at a time; run() and flush() can race
+    const juce::ScopedLock lock(this->output_lock);
+
+    auto write_line = [this](const juce::String& line) {
+        if (this->file != nullptr) {
+            this->file->writeText(line + "\n", false, false, nullptr);
+        } else {
+            printf("%s\n", line.toRawUTF8());
+        }
+    };
+
+    auto num_ready = this->fifo.getNumReady();
+    if (num_ready > 0) {
+        int start1, size1, start2, size2;
+        this->fifo.prepareToRead(num_ready, start1, size1, start2, size2);
+        auto format = [this, &write_line](const Record& r) {
+            auto seconds = juce::Time::highResolutionTicksToSeconds(r.ticks - this->start_ticks);
+            auto chord_str = r.chord.to_string(true, true);
+            write_line(juce::String::formatted("[%10.6f] voice %2d: Note %s -> Playing chord: %s%s",
+                                               seconds,
+                                               r.voice,
+                                               note_info(r.midi_note).to_string().c_str(),
+                                               chord_str.c_str(),
+                                               r.fallback ? " (fallback)" : ""));
+        };
+        for (int i = 0; i < size1; ++i) {
+            format(this->records[static_cast<size_t>(start1 + i)]);
+        }
+        for (int i = 0; i < size2; ++i) {
+            format(this->records[static_cast<size_t>(start2 + i)]);
+        }
+        this->fifo.finishedRead(size1 + size2);
+    }
+
+    auto dropped_now = this->dropped.load();
+    if (dropped_now != this->reported_dropped) {
+        write_line(juce::String(static_cast<juce::int64>(dropped_now - this->reported_dropped)) + " chord log records dropped");
+        this->reported_dropped = dropped_now;
+    }
+
+    if (this->file != nullptr) {
+        this->file->flush();
+    } else {
+        fflush(stdout);
+    }
+}
+
+} // namespace jnickg::audio::ws
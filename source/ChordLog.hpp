@@ -0,0 +1,79 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "BackgroundThread.hpp"
+#include "NotesKeys.hpp"
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief Trace of the chords the voices pick, safe to leave on during a performance.
+ *
+ * The audio thread only copies a fixed-size record into a single-producer/single-consumer ring
+ * buffer (a juce::AbstractFifo), which never blocks or allocates. Once start()ed, the shared
+ * BackgroundThread drains it every DRAIN_INTERVAL_MS, formatting the records and writing them to
+ * stdout or a file. If the writer falls behind and the ring fills up, new records are dropped and
+ * counted rather than waited for.
+ */
+class ChordLog : private juce::TimeSliceClient
+{
+public:
+    static inline constexpr int CAPACITY = 1024;
+    static inline constexpr int DRAIN_INTERVAL_MS = 50;
+
+    struct Record {
+        int64_t ticks { 0 };        ///< juce::Time::getHighResolutionTicks() at note-on
+        int voice { 0 };            ///< Index of the voice that played the chord
+        int midi_note { 0 };        ///< The note that was struck
+        chord_info chord;
+        bool fallback { false };    ///< No chord fit, so the struck note was played alone
+    };
+
+    ChordLog();
+    ~ChordLog() override;
+
+    void start();
+    void stop();
+
+    /**
+     * @brief Queues a record. Real-time safe; returns false (and counts a drop) if the ring is full.
+     */
+    bool push(const Record& r);
+
+    /**
+     * @brief Writes to the given file instead of stdout. Pass juce::File() to go back to stdout.
+     */
+    void set_output_file(const juce::File& file);
+
+    /**
+     * @brief Writes out everything queued so far, on the calling thread.
+     */
+    void flush();
+
+    size_t get_dropped() const { return this->dropped.load(); }
+
+private:
+    int useTimeSlice() override;
+    void drain();
+
+    juce::SharedResourcePointer<BackgroundThread> background;
+
+    juce::AbstractFifo fifo { CAPACITY };
+    std::array<Record, CAPACITY> records {};
+    std::atomic<size_t> dropped { 0 };
+    size_t reported_dropped { 0 };
+
+    // The consumer side; the audio thread never touches these
+    juce::CriticalSection output_lock;
+    std::unique_ptr<juce::FileOutputStream> file;
+    int64_t start_ticks { 0 };
+};
+
+} // namespace jnickg::audio::ws
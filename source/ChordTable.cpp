@@ -0,0 +1,111 @@
+#include "ChordTable.hpp"
+
+#include <juce_core/juce_core.h>
+
+#include <algorithm>
+#include <mutex>
+
+namespace jnickg::audio::ws {
+
+bool ChordTable::is_playable(chord c) {
+    #pragma clang diagnostic push
+    #pragma clang diagnostic ignored "-Wswitch-enum"
+    switch (c) {
+        case chord::_unison:
+        case chord::_5:
+        case chord::_maj:
+        case chord::_min:
+        case chord::_7:
+        case chord::_maj7:
+        case chord::_min7:
+        case chord::_11:
+        case chord::_min11:
+        case chord::_maj11:
+            return true;
+        default:
+            return false;
+    }
+    #pragma clang diagnostic pop
+}
+
+std::shared_ptr<const ChordTable::Data> ChordTable::search(const key_info& k) {
+    auto table = std::make_shared<Data>();
+    table->key = k;
+    for (int m = 0; m < NUM_NOTES; ++m) {
+        table->offsets[static_cast<size_t>(m)] = static_cast<uint32_t>(table->choices.size());
+
+        // init_chords() only covers octaves 0-7; notes outside that fall back to unison
+        note_info root(m);
+        if (root.octave < 0 || root.octave > 7 || !k.contains_note(root.n)) {
+            continue;
+        }
+        for (const auto& c : get_chords(root, k, true)) {
+            if (!is_playable(c.chord_type)) {
+                continue;
+            }
+            auto midi_notes = c.get_midi_notes();
+            auto out_of_range = std::any_of(midi_notes.begin(), midi_notes.end(), [](int n) {
+                return n < 0 || n >= NUM_NOTES;
+            });
+            if (midi_notes.size() > MAX_TONES || out_of_range) {
+                continue;
+            }
+            auto& choice = table->choices.emplace_back();
+            choice.chord = c;
+            choice.size = midi_notes.size();
+            std::copy(midi_notes.begin(), midi_notes.end(), choice.midi_notes.begin());
+        }
+    }
+    table->offsets[NUM_NOTES] = static_cast<uint32_t>(table->choices.size());
+    return table;
+}
+
+void ChordTable::build(const key_info& k) {
+    if (this->is_built_for(k)) {
+        return;
+    }
+
+    static constexpr auto NUM_SCALES = static_cast<size_t>(scale::__COUNT);
+    static std::mutex cache_lock;
+    static std::array<std::shared_ptr<const Data>, static_cast<size_t>(note::__COUNT) * NUM_SCALES> cache;
+
+    // Held through the search, so threads building the same key wait for one result
+    const std::lock_guard<std::mutex> lock(cache_lock);
+    auto& cached = cache[static_cast<size_t>(k.root) * NUM_SCALES + static_cast<size_t>(k.scale_type)];
+    if (cached == nullptr) {
+        cached = search(k);
+    }
+    this->data = cached;
+}
+
+size_t ChordTable::count(int midi_note, size_t max_tones) const {
+    if (this->data == nullptr || midi_note < 0 || midi_note >= NUM_NOTES) {
+        return 0;
+    }
+    const auto& choices = this->data->choices;
+    auto begin = choices.begin() + this->data->offsets[static_cast<size_t>(midi_note)];
+    auto end = choices.begin() + this->data->offsets[static_cast<size_t>(midi_note) + 1];
+    return static_cast<size_t>(std::count_if(begin, end, [max_tones](const Choice& c) {
+        return c.size <= max_tones;
+    }));
+}
+
+const ChordTable::Choice& ChordTable::get(int midi_note, size_t max_tones, size_t index) const {
+    jassert(index < this->count(midi_note, max_tones));
+    const auto& choices = this->data->choices;
+    auto begin = this->data->offsets[static_cast<size_t>(midi_note)];
+    auto end = this->data->offsets[static_cast<size_t>(midi_note) + 1];
+    for (auto i = begin; i < end; ++i) {
+        const auto& c = choices[i];
+        if (c.size > max_tones) {
+            continue;
+        }
+        if (index == 0) {
+            return c;
+        }
+        --index;
+    }
+    return choices[end - 1];
+}
+
+} // namespace jnickg::audio::ws
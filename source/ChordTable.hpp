@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "NotesKeys.hpp"
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief Every chord a Voice may answer a note-on with, for each MIDI note, in one key.
+ *
+ * The NotesKeys chord search allocates and takes milliseconds per note, so it runs once per key in
+ * build(), off the audio thread. Lookups afterwards are allocation-free: choices live in one flat
+ * array, with each note's choices contiguous and their MIDI notes precomputed.
+ *
+ * The tables themselves are immutable and cached for the life of the process, one per key, so
+ * every ChordTable built for the same key (e.g. in each of many PluginProcessors rendering in
+ * parallel) shares one copy, and only the first build pays for the search.
+ */
+class ChordTable
+{
+public:
+    static inline constexpr size_t MAX_TONES = 5;  ///< Largest chord from get_intervals(chord)
+    static inline constexpr int NUM_NOTES = 128;
+
+    struct Choice {
+        chord_info chord;
+        std::array<int, MAX_TONES> midi_notes {};
+        size_t size { 0 };
+    };
+
+    /**
+     * @brief Whether a chord type sounds good enough to be played as a pad.
+     */
+    static bool is_playable(chord c);
+
+    /**
+     * @brief Finds the playable, in-key chords rooted on every MIDI note.
+     *
+     * @note Not real-time safe, and blocks while another thread builds any key's table. Does
+     * nothing if the table is already built for this key.
+     */
+    void build(const key_info& key);
+
+    bool is_built_for(const key_info& key) const {
+        return this->data != nullptr && this->data->key.root == key.root && this->data->key.scale_type == key.scale_type;
+    }
+
+    /**
+     * @brief Number of choices for the note with at most max_tones tones.
+     */
+    size_t count(int midi_note, size_t max_tones) const;
+
+    /**
+     * @brief The index-th choice (in table order) for the note with at most max_tones tones.
+     *
+     * @pre index < count(midi_note, max_tones)
+     */
+    const Choice& get(int midi_note, size_t max_tones, size_t index) const;
+
+private:
+    struct Data {
+        key_info key;
+        std::vector<Choice> choices;
+        std::array<uint32_t, NUM_NOTES + 1> offsets {};  ///< Choices of note n are [offsets[n], offsets[n + 1])
+    };
+
+    static std::shared_ptr<const Data> search(const key_info& key);
+
+    std::shared_ptr<const Data> data;
+};
+
+} // namespace jnickg::audio::ws
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief Keeps processBlock within a share of its deadline by capping how many voices sound.
+ *
+ * Each block's callback time, as a fraction of the block's duration, is its load. When a block's
+ * load goes over the budget, the next block's voice ceiling drops in proportion (voices cost about
+ * the same each), so the synth fades out its least audible voices instead of the callback running
+ * late. The ceiling climbs back by one voice per block once the smoothed load, which rises at once
+ * and falls slowly, is under RECOVER_FRACTION of the budget.
+ *
+ * The budget can be set from any thread; everything else runs on the audio thread.
+ */
+class CpuBudget
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    static inline constexpr double RECOVER_FRACTION = 0.8; ///< Of the budget
+    static inline constexpr double LOAD_FALL = 0.02;       ///< Share of the gap the smoothed load closes per block
+
+    /**
+     * @brief The share of each block's deadline to stay within, e.g. 0.7. 0 turns the budget off.
+     */
+    void set_budget(double fraction) { this->budget.store(std::max(fraction, 0.0)); }
+    double get_budget() const { return this->budget.load(); }
+
+    void reset() {
+        this->last_load = 0.0;
+        this->smoothed_load.store(0.0, std::memory_order_relaxed);
+        this->ceiling = SIZE_MAX;
+    }
+
+    /**
+     * @brief Folds in how long the last block's callback took.
+     */
+    void end_block(int64_t callback_ns, int num_samples, double sample_rate) {
+        if (num_samples <= 0 || sample_rate <= 0.0) {
+            return;
+        }
+        auto deadline_ns = 1.0e9 * static_cast<double>(num_samples) / sample_rate;
+        this->last_load = static_cast<double>(callback_ns) / deadline_ns;
+        auto smoothed = this->smoothed_load.load(std::memory_order_relaxed);
+        smoothed = this->last_load > smoothed ? this->last_load : smoothed + LOAD_FALL * (this->last_load - smoothed);
+        this->smoothed_load.store(smoothed, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief How many voices the next block may sound, given how many sounded in the last one.
+     */
+    size_t get_voice_ceiling(size_t sounding_voices, size_t max_voices) {
+        auto b = this->budget.load(std::memory_order_relaxed);
+        if (b <= 0.0) {
+            this->ceiling = max_voices;
+            return max_voices;
+        }
+        this->ceiling = std::min(this->ceiling, max_voices);
+        if (this->last_load > b && sounding_voices > 0) {
+            auto affordable = static_cast<size_t>(std::floor(static_cast<double>(sounding_voices) * b / this->last_load));
+            // At least one fewer than sounded, and never silence
+            affordable = std::clamp<size_t>(affordable, 1, std::max<size_t>(sounding_voices - 1, 1));
+            this->ceiling = std::min(this->ceiling, affordable);
+            // Only count the overrun once: the next block is measured with the voices shed
+            this->last_load = 0.0;
+        } else if (this->smoothed_load.load(std::memory_order_relaxed) < b * RECOVER_FRACTION && this->ceiling < max_voices) {
+            ++this->ceiling;
+        }
+        return this->ceiling;
+    }
+
+    /**
+     * @brief The smoothed load, as a fraction of the deadline. Safe to read from any thread.
+     */
+    double get_load() const { return this->smoothed_load.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief end_block() for the enclosing scope, so early returns are counted too.
+     */
+    class ScopedBlock
+    {
+    public:
+        ScopedBlock(CpuBudget& b, int n, double sr)
+            : cpu_budget(b)
+            , num_samples(n)
+            , sample_rate(sr)
+            , start(clock::now())
+        {
+            // no-op
+        }
+        ~ScopedBlock() {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - this->start).count();
+            this->cpu_budget.end_block(elapsed, this->num_samples, this->sample_rate);
+        }
+        ScopedBlock(const ScopedBlock&) = delete;
+        ScopedBlock& operator=(const ScopedBlock&) = delete;
+    private:
+        CpuBudget& cpu_budget;
+        int num_samples;
+        double sample_rate;
+        clock::time_point start;
+    };
+
+private:
+    std::atomic<double> budget { 0.0 };
+    std::atomic<double> smoothed_load { 0.0 };
+    double last_load { 0.0 };
+    size_t ceiling { SIZE_MAX };
+};
+
+} // namespace jnickg::audio::ws
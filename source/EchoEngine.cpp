@@ -0,0 +1,262 @@
+#include "EchoEngine.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace jnickg::audio::ws {
+
+void EchoEngine::prepare(double sampleRate, const key_info& key) {
+    this->sample_rate = sampleRate;
+    this->fade_samples = std::max(FADE_SECONDS * static_cast<float>(sampleRate), 1.0f);
+
+    for (int m = 0; m < 128; ++m) {
+        auto freq = 440.0 * std::pow(2.0, (m - 69) / 12.0);
+        auto w = juce::MathConstants<double>::twoPi * freq / sampleRate;
+        this->sin_table[static_cast<size_t>(m)] = static_cast<float>(std::sin(w));
+        this->cos_table[static_cast<size_t>(m)] = static_cast<float>(std::cos(w));
+    }
+
+    // Recomputes the per-sample decay and repeat spacing for the new sample rate
+    this->set_parameters(this->params);
+    this->set_key(key);
+    this->reset();
+}
+
+void EchoEngine::Scale::build(const key_info& key) {
+    this->size = 0;
+    auto lowest = 0;
+    for (int m = 0; m < 128; ++m) {
+        if (key.contains_note(note_info(m).n)) {
+            this->notes[this->size++] = m;
+        }
+        if (this->size > 0) {
+            lowest = static_cast<int>(this->size) - 1;
+        }
+        this->degree_of[static_cast<size_t>(m)] = lowest;
+    }
+}
+
+void EchoEngine::set_key(const key_info& key) {
+    this->key_scale.build(key);
+}
+
+void EchoEngine::set_bpm(double new_bpm) {
+    if (new_bpm <= 0.0 || new_bpm == this->bpm) {
+        return;
+    }
+    this->bpm = new_bpm;
+    this->update_samples_per_repeat();
+}
+
+void EchoEngine::set_parameters(const Parameters& p) {
+    this->params = p;
+    this->params.repeats = std::max(this->params.repeats, 0);
+    auto decay_samples = std::max(static_cast<double>(this->params.decay_seconds) * this->sample_rate, 1.0);
+    this->decay_per_sample = static_cast<float>(std::pow(0.001, 1.0 / decay_samples));
+    this->update_samples_per_repeat();
+}
+
+void EchoEngine::update_samples_per_repeat() {
+    this->samples_per_repeat = (60.0 / this->bpm) * this->params.beats_per_repeat * this->sample_rate;
+}
+
+void EchoEngine::reset() {
+    for (auto& e : this->events) {
+        e.pending = false;
+    }
+    this->num_pending = 0;
+    for (auto& v : this->voices) {
+        v.active = false;
+    }
+    for (auto& v : this->shedding) {
+        v.active = false;
+    }
+    this->block_start = 0;
+    this->block_position = 0;
+}
+
+int EchoEngine::step_degrees(int midi_note, int steps) const {
+    if (this->key_scale.size == 0) {
+        return midi_note;
+    }
+    auto degree = this->key_scale.degree_of[static_cast<size_t>(std::clamp(midi_note, 0, 127))] + steps;
+    degree = std::clamp(degree, 0, static_cast<int>(this->key_scale.size) - 1);
+    return this->key_scale.notes[static_cast<size_t>(degree)];
+}
+
+void EchoEngine::trigger(const int* midi_notes, size_t count, float velocity) {
+    auto now = this->block_start + this->block_position;
+    count = std::min(count, MAX_CHORD_TONES);
+
+    auto gain = this->params.level * velocity;
+    for (int r = 1; r <= this->params.repeats; ++r) {
+        if (gain < this->params.min_gain) {
+            break;
+        }
+        auto time = now + static_cast<int64_t>(std::llround(r * this->samples_per_repeat));
+        for (size_t t = 0; t < count; ++t) {
+            auto pitch = this->step_degrees(midi_notes[t], r * this->params.degree_step);
+            this->schedule(time, pitch, gain);
+        }
+        gain *= this->params.feedback;
+    }
+}
+
+void EchoEngine::schedule(int64_t time, int midi_note, float gain) {
+    // Take a free slot if there is one, otherwise replace the quietest pending echo, but only
+    // if the new one would be louder. This is what keeps dense trails bounded.
+    Event* slot = nullptr;
+    for (auto& e : this->events) {
+        if (!e.pending) {
+            slot = &e;
+            break;
+        }
+        if (slot == nullptr || e.gain < slot->gain) {
+            slot = &e;
+        }
+    }
+    if (slot->pending && slot->gain >= gain) {
+        return;
+    }
+    this->num_pending += slot->pending ? 0 : 1;
+    slot->time = time;
+    slot->midi_note = midi_note;
+    slot->gain = gain;
+    slot->pending = true;
+}
+
+void EchoEngine::fire(const Event& e) {
+    EchoVoice* slot = nullptr;
+    for (auto& v : this->voices) {
+        if (!v.active) {
+            slot = &v;
+            break;
+        }
+        if (slot == nullptr || v.gain < slot->gain) {
+            slot = &v;
+        }
+    }
+    if (slot->active) {
+        this->shed(*slot);
+    }
+    auto idx = static_cast<size_t>(std::clamp(e.midi_note, 0, 127));
+    slot->s = 0.0f;
+    slot->c = 1.0f;
+    slot->sin_w = this->sin_table[idx];
+    slot->cos_w = this->cos_table[idx];
+    slot->gain = e.gain;
+    slot->active = true;
+}
+
+void EchoEngine::shed(const EchoVoice& v) {
+    // Same policy as fire(): a free slot, otherwise the quietest, which is nearly faded out anyway
+    EchoVoice* slot = nullptr;
+    for (auto& f : this->shedding) {
+        if (!f.active) {
+            slot = &f;
+            break;
+        }
+        if (slot == nullptr || f.gain < slot->gain) {
+            slot = &f;
+        }
+    }
+    *slot = v;
+    slot->fade_step = v.gain / this->fade_samples;
+}
+
+void EchoEngine::render(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) {
+    auto end = startSample + numSamples;
+    auto sample = startSample;
+
+    while (sample < end && this->num_pending > 0) {
+        // Find the earliest echo due within the rest of this block, and render up to it
+        auto block_end = this->block_start + end;
+        auto next = block_end;
+        for (auto& e : this->events) {
+            if (e.pending && e.time < next) {
+                next = e.time;
+            }
+        }
+        auto segment_end = static_cast<int>(std::max<int64_t>(next - this->block_start, sample));
+        this->render_voices(buffer, sample, segment_end - sample);
+        sample = segment_end;
+
+        if (next >= block_end) {
+            break;
+        }
+        for (auto& e : this->events) {
+            if (e.pending && e.time <= next) {
+                this->fire(e);
+                e.pending = false;
+                --this->num_pending;
+            }
+        }
+    }
+    // The rest of the block, once nothing more is due in it
+    this->render_voices(buffer, sample, end - sample);
+
+    this->block_start += end;
+    this->block_position = 0;
+}
+
+void EchoEngine::render_voices(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) {
+    if (numSamples <= 0) {
+        return;
+    }
+    auto num_channels = buffer.getNumChannels();
+    auto* const* out = buffer.getArrayOfWritePointers();
+
+    for (auto& v : this->voices) {
+        if (!v.active) {
+            continue;
+        }
+        for (int i = startSample; i < startSample + numSamples; ++i) {
+            auto val = v.s * v.gain;
+            for (int ch = 0; ch < num_channels; ++ch) {
+                out[ch][i] += val;
+            }
+            auto s = v.s * v.cos_w + v.c * v.sin_w;
+            auto c = v.c * v.cos_w - v.s * v.sin_w;
+            v.s = s;
+            v.c = c;
+            v.gain *= this->decay_per_sample;
+        }
+        if (v.gain < 1.0e-4f) {
+            v.active = false;
+        }
+    }
+
+    for (auto& v : this->shedding) {
+        if (!v.active) {
+            continue;
+        }
+        for (int i = startSample; i < startSample + numSamples && v.gain > 0.0f; ++i) {
+            auto val = v.s * v.gain;
+            for (int ch = 0; ch < num_channels; ++ch) {
+                out[ch][i] += val;
+            }
+            auto s = v.s * v.cos_w + v.c * v.sin_w;
+            auto c = v.c * v.cos_w - v.s * v.sin_w;
+            v.s = s;
+            v.c = c;
+            v.gain -= v.fade_step;
+        }
+        if (v.gain <= 0.0f) {
+            v.active = false;
+        }
+    }
+}
+
+size_t EchoEngine::active_voices() const {
+    return static_cast<size_t>(std::count_if(this->voices.begin(), this->voices.end(), [](const EchoVoice& v) {
+        return v.active;
+    }));
+}
+
+size_t EchoEngine::shedding_voices() const {
+    return static_cast<size_t>(std::count_if(this->shedding.begin(), this->shedding.end(), [](const EchoVoice& v) {
+        return v.active;
+    }));
+}
+
+} // namespace jnickg::audio::ws
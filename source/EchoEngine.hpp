@@ -0,0 +1,158 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "NotesKeys.hpp"
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief Tempo-synced generative echo, as described in PROPOSAL.md.
+ *
+ * Every chord a Voice plays is handed to trigger(), which schedules a trail of echoes on beat
+ * subdivisions of the host tempo. Each repeat walks the chord tones through the current key by
+ * scale degrees, so the echo "moves through" the notes of the key (e.g. Yonanuki) instead of
+ * repeating the struck chord verbatim.
+ *
+ * All state is preallocated: pending echoes live in a fixed event pool, and fire sample-accurately
+ * into a fixed bank of lightweight sine voices. When either is full, the quietest entry is
+ * replaced, so dense trails cost a bounded amount of memory and CPU. A replaced voice isn't cut
+ * off: it moves to a small bank of shedding voices and ramps out over FADE_SECONDS, so stealing
+ * doesn't click.
+ */
+class EchoEngine
+{
+public:
+    static inline constexpr size_t MAX_EVENTS = 128;
+    static inline constexpr size_t MAX_VOICES = 24;
+    static inline constexpr size_t MAX_CHORD_TONES = 5;
+    static inline constexpr size_t MAX_SHEDDING = 8;        ///< Stolen voices still fading out
+    static inline constexpr float FADE_SECONDS = 0.005f;    ///< Ramp-out time of a stolen voice
+
+    struct Parameters {
+        int repeats { 4 };                  ///< Echoes scheduled per chord tone
+        double beats_per_repeat { 1.0 };    ///< Spacing of repeats, in beats (1.0 = quarter note)
+        float feedback { 0.55f };           ///< Gain multiplier applied on each repeat
+        int degree_step { -1 };             ///< Scale degrees each repeat moves by
+        float level { 0.1f };               ///< Gain of the first repeat at full velocity
+        float decay_seconds { 1.5f };       ///< Time for an echo note to decay by 60dB
+        float min_gain { 0.005f };          ///< Repeats quieter than this are not scheduled
+    };
+
+    /**
+     * @brief The notes of a key, laid out for stepping through it by scale degree.
+     */
+    struct Scale {
+        std::array<int, 128> notes {};      ///< Every MIDI note in the key, ascending
+        std::array<int, 128> degree_of {};  ///< Index into notes of the nearest note at or below
+        size_t size { 0 };
+
+        /**
+         * @note Not real-time safe: key_info builds its note lists on the heap.
+         */
+        void build(const key_info& key);
+    };
+
+    EchoEngine() = default;
+
+    /**
+     * @brief (Re)computes the pitch tables for the given key and sample rate, and clears all echoes.
+     *
+     * @note Not real-time safe: builds the in-key note table via key_info.
+     */
+    void prepare(double sampleRate, const key_info& key);
+
+    /**
+     * @brief Switches key. Not real-time safe; see set_scale().
+     */
+    void set_key(const key_info& key);
+
+    /**
+     * @brief Switches to a prebuilt scale. Real-time safe. Echoes already scheduled keep their pitch.
+     */
+    void set_scale(const Scale& s) { this->key_scale = s; }
+
+    void set_bpm(double bpm);
+    void set_parameters(const Parameters& p);
+    const Parameters& get_parameters() const { return this->params; }
+
+    /**
+     * @brief Tells the engine where in the current block subsequent trigger() calls happen.
+     */
+    void set_block_position(int sample) { this->block_position = sample; }
+
+    /**
+     * @brief Schedules the echo trail for a chord that just started playing.
+     */
+    void trigger(const int* midi_notes, size_t count, float velocity);
+
+    /**
+     * @brief Adds the echo voices to every channel of the buffer, then advances the clock.
+     *
+     * @note Call once per processBlock, after the synth has rendered (and triggered) its voices.
+     */
+    void render(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    void reset();
+
+    size_t pending_events() const { return this->num_pending; }
+    size_t active_voices() const;
+    size_t shedding_voices() const;
+
+    /**
+     * @brief Whether no echo is sounding or due, i.e. whether render() would add nothing.
+     */
+    bool is_idle() const { return this->num_pending == 0 && this->active_voices() == 0 && this->shedding_voices() == 0; }
+
+private:
+    struct Event {
+        int64_t time { 0 };     ///< Absolute sample time at which this echo fires
+        int midi_note { 0 };
+        float gain { 0.0f };
+        bool pending { false };
+    };
+
+    struct EchoVoice {
+        // Quadrature oscillator: (s, c) is rotated by (sin_w, cos_w) each sample, which is much
+        // cheaper than std::sin and plenty stable for notes that decay within a few seconds.
+        float s { 0.0f };
+        float c { 1.0f };
+        float sin_w { 0.0f };
+        float cos_w { 1.0f };
+        float gain { 0.0f };
+        float fade_step { 0.0f };   ///< Linear ramp-out per sample, once the voice is shedding
+        bool active { false };
+    };
+
+    void schedule(int64_t time, int midi_note, float gain);
+    void fire(const Event& e);
+    void shed(const EchoVoice& v);
+    void render_voices(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    int step_degrees(int midi_note, int steps) const;
+    void update_samples_per_repeat();
+
+    Parameters params;
+    double sample_rate { 44100.0 };
+    double bpm { 120.0 };
+    double samples_per_repeat { 22050.0 };
+    float decay_per_sample { 0.9999f };
+    float fade_samples { 240.0f };          ///< FADE_SECONDS at the current sample rate
+
+    std::array<Event, MAX_EVENTS> events {};
+    size_t num_pending { 0 };               ///< Events pending, so idle blocks skip scanning them
+    std::array<EchoVoice, MAX_VOICES> voices {};
+    std::array<EchoVoice, MAX_SHEDDING> shedding {};
+
+    std::array<float, 128> sin_table {};    ///< sin(w) per MIDI note at the current sample rate
+    std::array<float, 128> cos_table {};    ///< cos(w) per MIDI note at the current sample rate
+    Scale key_scale;                        ///< Walked by the echoes
+
+    int64_t block_start { 0 };              ///< Absolute sample time of the current block
+    int block_position { 0 };
+};
+
+} // namespace jnickg::audio::ws
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @brief Polynomial stand-ins for the libm functions on the audio path.
+ *
+ * Each is branch-free float math with no libm calls, so loops calling them vectorise at the baseline
+ * ISA. (GCC only if-converts the clamps with -fno-trapping-math, which CMakeLists.txt sets.) Error
+ * bounds are against the double-precision result over the stated range, include float rounding,
+ * and are checked by tests/TestFastMath.cpp.
+ */
+namespace jnickg::audio::ws::fastmath {
+
+inline constexpr float PI = 3.14159265358979323846f;
+inline constexpr float HALF_PI = 0.5f * PI;
+inline constexpr float TWO_PI = 2.0f * PI;
+
+namespace detail {
+
+// 2 pi in two parts, so k * TWO_PI_HI is exact and range reduction keeps its precision
+inline constexpr float TWO_PI_HI = 6.28125f;
+inline constexpr float TWO_PI_LO = 1.9353071795864769e-3f;
+inline constexpr float INV_TWO_PI = 0.159154943091895336f;
+
+// Odd degree-9 minimax fit of sin on [-pi/2, pi/2]; 3.4e-9 before rounding
+inline constexpr float S1 = 0.999999977f;
+inline constexpr float S3 = -0.166666476f;
+inline constexpr float S5 = 8.33289983e-3f;
+inline constexpr float S7 = -1.98008979e-4f;
+inline constexpr float S9 = 2.5904888e-6f;
+
+// Degree-5 minimax fit of 2^f on [0, 1), relative; 8.3e-8 before rounding.
+// E0 is pinned to 1, so integer powers come out exact
+inline constexpr float E0 = 1.0f;
+inline constexpr float E1 = 0.693151312f;
+inline constexpr float E2 = 0.240164452f;
+inline constexpr float E3 = 0.0557999054f;
+inline constexpr float E4 = 9.01704129e-3f;
+inline constexpr float E5 = 1.86712484e-3f;
+
+/**
+ * @brief floor(x) as an integer, for |x| < 2^31.
+ */
+inline int32_t floor_to_int(float x) {
+    auto truncated = static_cast<int32_t>(x);
+    return truncated - static_cast<int32_t>(static_cast<float>(truncated) > x);
+}
+
+} // namespace detail
+
+/**
+ * @brief sin(x) for x in [-pi/2, pi/2]. Absolute error under 2e-7.
+ */
+inline float sin_half_pi(float x) {
+    using namespace detail;
+    auto x2 = x * x;
+    return x * (S1 + x2 * (S3 + x2 * (S5 + x2 * (S7 + x2 * S9))));
+}
+
+/**
+ * @brief sin(x). Absolute error under 2.5e-7 for |x| <= 256 pi.
+ */
+inline float sin(float x) {
+    using namespace detail;
+    auto k = static_cast<float>(floor_to_int(x * INV_TWO_PI + 0.5f));
+    x = (x - k * TWO_PI_HI) - k * TWO_PI_LO;   // [-pi, pi]
+    // sin(pi - x) == sin(x) folds the outer quarters in
+    auto a = std::abs(x);
+    return sin_half_pi(std::copysign(1.0f, x) * std::min(a, PI - a));
+}
+
+/**
+ * @brief 2^x. Relative error under 2.5e-7 for x in [-126, 126], and exact at integers; clamped
+ * outside that range.
+ */
+inline float exp2(float x) {
+    using namespace detail;
+    x = std::min(std::max(x, -126.0f), 126.0f);
+    auto whole = floor_to_int(x);
+    auto f = x - static_cast<float>(whole);
+    auto p = E0 + f * (E1 + f * (E2 + f * (E3 + f * (E4 + f * E5))));
+    // 2^whole, built straight into the exponent bits
+    auto scale = std::bit_cast<float>((whole + 127) << 23);
+    return p * scale;
+}
+
+/**
+ * @brief The frequency ratio of a pitch interval, i.e. 2^(semitones / 12), with exp2()'s error.
+ */
+inline float semitones_to_ratio(float semitones) {
+    return exp2(semitones * (1.0f / 12.0f));
+}
+
+/**
+ * @brief tanh(x), for soft saturation. Absolute error under 5e-7; exactly 0 at 0 and +-1 past |x| = 9.
+ */
+inline float tanh(float x) {
+    // tanh(x) = (e^2x - 1) / (e^2x + 1), with e^2x = 2^(2x log2(e))
+    constexpr float TWO_LOG2_E = 2.88539008177792681f;
+    auto e = exp2(TWO_LOG2_E * std::min(std::max(x, -9.0f), 9.0f));
+    return (e - 1.0f) / (e + 1.0f);
+}
+
+} // namespace jnickg::audio::ws::fastmath
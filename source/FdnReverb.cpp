@@ -0,0 +1,245 @@
+#include "FdnReverb.hpp"
+
+#include "FastMath.hpp"
+#include "SimdDispatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace jnickg::audio::ws {
+
+namespace {
+
+/**
+ * @brief In-place fast Walsh-Hadamard transform, normalised so that it is energy-preserving.
+ */
+template <size_t N>
+inline void hadamard(float* x) {
+    for (size_t h = 1; h < N; h *= 2) {
+        for (size_t i = 0; i < N; i += 2 * h) {
+            for (size_t j = i; j < i + h; ++j) {
+                auto a = x[j];
+                auto b = x[j + h];
+                x[j] = a + b;
+                x[j + h] = a - b;
+            }
+        }
+    }
+    const auto scale = 1.0f / std::sqrt(static_cast<float>(N));
+    for (size_t i = 0; i < N; ++i) {
+        x[i] *= scale;
+    }
+}
+
+} // namespace
+
+void FdnReverb::prepare(const juce::dsp::ProcessSpec& spec) {
+    this->sample_rate = spec.sampleRate;
+
+    auto max_delay = (MAX_DELAY_MS + MAX_MODULATION_MS) * 0.001 * this->sample_rate + 2.0;
+    size_t size = 1;
+    while (static_cast<double>(size) < max_delay) {
+        size *= 2;
+    }
+    this->delay_mask = size - 1;
+    this->delay_buffer.assign(size * MAX_LINES, 0.0f);
+
+    this->set_parameters(this->params);
+    this->reset();
+}
+
+void FdnReverb::reset() {
+    std::fill(this->delay_buffer.begin(), this->delay_buffer.end(), 0.0f);
+    this->damp_state.fill(0.0f);
+    this->mod_offset.fill(0.0f);
+    for (size_t i = 0; i < MAX_LINES; ++i) {
+        // Spread the LFOs evenly so that lines never all stretch at once
+        this->lfo_phase[i] = juce::MathConstants<float>::twoPi * static_cast<float>(i) / static_cast<float>(MAX_LINES);
+    }
+    this->write_pos = 0;
+    this->mod_countdown = 0;
+
+    // Nothing left to clear
+    this->clear_begin = this->clear_end;
+    if (this->num_lines != this->target_lines) {
+        this->num_lines = this->target_lines;
+        this->update_lines();
+    }
+}
+
+void FdnReverb::set_parameters(const Parameters& p) {
+    this->params = p;
+    this->params.decay_seconds = std::max(this->params.decay_seconds, 0.1f);
+    this->tail_seconds.store(static_cast<double>(this->params.decay_seconds), std::memory_order_relaxed);
+
+    // Lines that sat unused still hold whatever they had when last in use, so they're cleared a
+    // slice at a time (see clear_returning_lines()) before they run again
+    auto lines = this->params.quality == Quality::High ? MAX_LINES : size_t { 8 };
+    if (lines > this->num_lines && !this->delay_buffer.empty()) {
+        if (lines != this->target_lines) {
+            auto line_size = this->delay_mask + 1;
+            this->clear_begin = this->num_lines * line_size;
+            this->clear_end = lines * line_size;
+            std::fill(this->damp_state.begin() + static_cast<std::ptrdiff_t>(this->num_lines),
+                this->damp_state.begin() + static_cast<std::ptrdiff_t>(lines), 0.0f);
+        }
+    } else {
+        this->num_lines = lines;
+    }
+    this->target_lines = lines;
+
+    this->damp_coeff = std::clamp(this->params.damping, 0.0f, 1.0f) * 0.7f;
+    auto depth = std::clamp(this->params.modulation_depth, 0.0f, 1.0f);
+    // Offsets swing between 0 and 2x this, i.e. at most MAX_MODULATION_MS
+    this->mod_depth_samples = static_cast<float>(0.5 * depth * MAX_MODULATION_MS * 0.001 * this->sample_rate);
+    this->lfo_increment = static_cast<float>(juce::MathConstants<double>::twoPi * this->params.modulation_rate
+        * MODULATION_INTERVAL / this->sample_rate);
+
+    // Same wet/dry/width semantics (and scaling) as juce::dsp::Reverb, so presets carry over
+    auto width = std::clamp(this->params.width, 0.0f, 1.0f);
+    auto wet = 3.0f * this->params.wet_level;
+    this->wet1 = 0.5f * wet * (1.0f + width);
+    this->wet2 = 0.5f * wet * (1.0f - width);
+    this->dry = 2.0f * this->params.dry_level;
+
+    this->update_lines();
+}
+
+void FdnReverb::update_lines() {
+    // Exponentially spaced, mutually-detuned delay lengths avoid coinciding echoes
+    auto n = this->num_lines;
+    for (size_t i = 0; i < n; ++i) {
+        auto t = static_cast<float>(i) / static_cast<float>(n - 1);
+        auto ms = MIN_DELAY_MS * std::pow(MAX_DELAY_MS / MIN_DELAY_MS, t);
+        auto samples = std::floor(ms * 0.001f * static_cast<float>(this->sample_rate)) + static_cast<float>(i % 2);
+        this->delays[i] = samples;
+        // Gain per pass such that the loop decays by 60dB in decay_seconds
+        this->feedback[i] = std::pow(10.0f, -3.0f * samples / (this->params.decay_seconds * static_cast<float>(this->sample_rate)));
+    }
+    for (size_t i = n; i < MAX_LINES; ++i) {
+        this->delays[i] = 1.0f;
+        this->feedback[i] = 0.0f;
+    }
+}
+
+void FdnReverb::clear_returning_lines() {
+    auto slice = std::min(CLEAR_SLICE, this->clear_end - this->clear_begin);
+    std::fill_n(this->delay_buffer.begin() + static_cast<std::ptrdiff_t>(this->clear_begin), slice, 0.0f);
+    this->clear_begin += slice;
+    if (this->clear_begin == this->clear_end) {
+        this->num_lines = this->target_lines;
+        this->update_lines();
+    }
+}
+
+void FdnReverb::process(float* left, float* right, int num_samples) {
+    if (this->delay_buffer.empty()) {
+        return;
+    }
+    if (this->num_lines != this->target_lines) {
+        this->clear_returning_lines();
+    }
+    auto modulated = this->params.quality != Quality::Eco && this->mod_depth_samples > 0.0f;
+    // The lane loops are 8 or 16 wide, so they fill AVX2 and AVX-512 registers exactly
+    if (this->num_lines == 16) {
+        simd::dispatch([&] { this->process_lines<16, true>(left, right, num_samples); });
+    } else if (modulated) {
+        simd::dispatch([&] { this->process_lines<8, true>(left, right, num_samples); });
+    } else {
+        simd::dispatch([&] { this->process_lines<8, false>(left, right, num_samples); });
+    }
+}
+
+template <size_t N, bool Modulated>
+void FdnReverb::process_lines(float* left, float* right, int num_samples) {
+    // Work on local copies of the per-line state: the delay buffer is written every sample, and
+    // the compiler can't otherwise prove those stores don't alias our members.
+    alignas(64) std::array<float, N> delay;
+    alignas(64) std::array<float, N> gain;
+    alignas(64) std::array<float, N> damp;
+    alignas(64) std::array<float, N> offset;
+    alignas(64) std::array<float, N> taps;
+    std::copy_n(this->delays.begin(), N, delay.begin());
+    std::copy_n(this->feedback.begin(), N, gain.begin());
+    std::copy_n(this->damp_state.begin(), N, damp.begin());
+    std::copy_n(this->mod_offset.begin(), N, offset.begin());
+
+    // Roughly matches the wet level of juce::dsp::Reverb for the same wet_level
+    const auto input_gain = 0.7f / std::sqrt(static_cast<float>(N));
+    const auto damp_coeff = this->damp_coeff;
+    const auto wet_1 = this->wet1;
+    const auto wet_2 = this->wet2;
+    const auto dry_gain = this->dry;
+    const auto mask = this->delay_mask;
+    const auto line_size = mask + 1;
+    auto* buffer = this->delay_buffer.data();
+    auto pos = this->write_pos;
+
+    for (int s = 0; s < num_samples; ++s) {
+        if constexpr (Modulated) {
+            if (--this->mod_countdown <= 0) {
+                this->mod_countdown = MODULATION_INTERVAL;
+                for (size_t i = 0; i < N; ++i) {
+                    this->lfo_phase[i] += this->lfo_increment;
+                    if (this->lfo_phase[i] >= juce::MathConstants<float>::twoPi) {
+                        this->lfo_phase[i] -= juce::MathConstants<float>::twoPi;
+                    }
+                    offset[i] = this->mod_depth_samples * (1.0f + fastmath::sin(this->lfo_phase[i]));
+                }
+            }
+        }
+
+        // Read: each line is its own contiguous stream, which keeps this prefetcher-friendly
+        for (size_t i = 0; i < N; ++i) {
+            if constexpr (Modulated) {
+                auto d = delay[i] + offset[i];
+                auto whole = static_cast<size_t>(d);
+                auto frac = d - static_cast<float>(whole);
+                auto* line = buffer + i * line_size;
+                auto a = line[(pos - whole) & mask];
+                auto b = line[(pos - whole - 1) & mask];
+                taps[i] = a + frac * (b - a);
+            } else {
+                auto whole = static_cast<size_t>(delay[i]);
+                taps[i] = buffer[i * line_size + ((pos - whole) & mask)];
+            }
+        }
+
+        // Damping and decay, lane-parallel
+        for (size_t i = 0; i < N; ++i) {
+            damp[i] = taps[i] + damp_coeff * (damp[i] - taps[i]);
+            taps[i] = damp[i] * gain[i];
+        }
+
+        // Even lines feed the left output, odd lines the right
+        auto wet_l = 0.0f;
+        auto wet_r = 0.0f;
+        for (size_t i = 0; i < N; i += 2) {
+            wet_l += taps[i];
+            wet_r += taps[i + 1];
+        }
+
+        hadamard<N>(taps.data());
+
+        auto in_l = left[s];
+        auto in_r = right != nullptr ? right[s] : in_l;
+        for (size_t i = 0; i < N; i += 2) {
+            buffer[i * line_size + pos] = taps[i] + in_l * input_gain;
+            buffer[(i + 1) * line_size + pos] = taps[i + 1] + in_r * input_gain;
+        }
+        pos = (pos + 1) & mask;
+
+        if (right != nullptr) {
+            left[s] = dry_gain * in_l + wet_1 * wet_l + wet_2 * wet_r;
+            right[s] = dry_gain * in_r + wet_1 * wet_r + wet_2 * wet_l;
+        } else {
+            left[s] = dry_gain * in_l + 0.5f * (wet_1 + wet_2) * (wet_l + wet_r);
+        }
+    }
+
+    std::copy_n(damp.begin(), N, this->damp_state.begin());
+    std::copy_n(offset.begin(), N, this->mod_offset.begin());
+    this->write_pos = pos;
+}
+
+} // namespace jnickg::audio::ws
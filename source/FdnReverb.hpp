@@ -0,0 +1,149 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief A feedback-delay-network reverb, tuned for long ambient pads.
+ *
+ * Replaces juce::dsp::Reverb (Freeverb) in the post-FX chain. Each sample, the delay lines are read,
+ * damped, scaled to the requested decay time, and mixed through a normalised Hadamard matrix before
+ * being fed back. Per-line state is kept in fixed-width arrays and the line count is a template
+ * parameter, so the damping, gain and matrix stages compile down to straight SIMD loops.
+ *
+ * Delay-line read positions can be slowly modulated, which smears the modal "ringing" that static
+ * FDNs (and Freeverb's comb filters) have on sustained chords.
+ */
+class FdnReverb
+{
+public:
+    static inline constexpr size_t MAX_LINES = 16;
+
+    /**
+     * @brief CPU/quality trade-off. Eco costs roughly a third of High.
+     */
+    enum class Quality
+    {
+        Eco,        ///< 8 lines, static delays
+        Standard,   ///< 8 lines, modulated delays
+        High,       ///< 16 lines, modulated delays
+    };
+
+    struct Parameters {
+        float decay_seconds { 5.0f };       ///< RT60 of the tail
+        float damping { 0.5f };             ///< 0..1, high-frequency loss in the feedback path
+        float wet_level { 0.7f };
+        float dry_level { 0.5f };
+        float width { 0.5f };               ///< 0..1, stereo spread of the wet signal
+        float modulation_depth { 0.5f };    ///< 0..1, scaled to at most MAX_MODULATION_MS
+        float modulation_rate { 0.3f };     ///< Hz
+        Quality quality { Quality::Standard };
+    };
+
+    FdnReverb() = default;
+
+    /**
+     * @brief Allocates the delay lines for the worst case (High quality) at the given sample rate.
+     */
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset();
+
+    /**
+     * @brief Applies new parameters. Real-time safe, including changes of quality.
+     *
+     * Lines that come back into use (Standard to High) still hold whatever they had when last in
+     * use. They're cleared CLEAR_SLICE samples per process() call, and join in once clean, so the
+     * switch costs no block more than a slice.
+     */
+    void set_parameters(const Parameters& p);
+    const Parameters& get_parameters() const { return this->params; }
+
+    /**
+     * @brief The delay lines running now. Lags behind the quality while returning lines are cleared.
+     */
+    size_t get_num_lines() const { return this->num_lines; }
+
+    /**
+     * @brief Time after the input goes silent until the tail has decayed by 60dB. Safe to call from
+     * any thread.
+     */
+    double get_tail_length_seconds() const { return this->tail_seconds.load(std::memory_order_relaxed); }
+
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) {
+        const auto& input = context.getInputBlock();
+        auto& output = context.getOutputBlock();
+        jassert(input.getNumSamples() == output.getNumSamples());
+
+        auto num_channels = output.getNumChannels();
+        auto num_samples = static_cast<int>(output.getNumSamples());
+        if (context.isBypassed || num_channels == 0) {
+            if (!context.usesSeparateInputAndOutputBlocks()) {
+                return;
+            }
+            output.copyFrom(input);
+            return;
+        }
+        if (context.usesSeparateInputAndOutputBlocks()) {
+            output.copyFrom(input);
+        }
+
+        auto* left = output.getChannelPointer(0);
+        auto* right = num_channels > 1 ? output.getChannelPointer(1) : nullptr;
+        this->process(left, right, num_samples);
+    }
+
+    /**
+     * @brief Processes a mono (right == nullptr) or stereo buffer in place.
+     */
+    void process(float* left, float* right, int num_samples);
+
+private:
+    static inline constexpr float MIN_DELAY_MS = 23.0f;
+    static inline constexpr float MAX_DELAY_MS = 97.0f;
+    static inline constexpr float MAX_MODULATION_MS = 1.5f;
+    static inline constexpr int MODULATION_INTERVAL = 16;  ///< Samples between LFO updates
+    static inline constexpr size_t CLEAR_SLICE = 4096;      ///< Samples of returning lines cleared per process()
+
+    template <size_t N, bool Modulated>
+    void process_lines(float* left, float* right, int num_samples);
+
+    void update_lines();
+    void clear_returning_lines();
+
+    Parameters params;
+    std::atomic<double> tail_seconds { 5.0 };   ///< params.decay_seconds, for other threads
+    double sample_rate { 44100.0 };
+    size_t num_lines { 8 };
+    size_t target_lines { 8 };      ///< What the quality asks for; num_lines catches up once cleared
+
+    // MAX_LINES power-of-two delay lines, back to back in one allocation
+    std::vector<float> delay_buffer;
+    size_t delay_mask { 0 };
+    size_t write_pos { 0 };
+    size_t clear_begin { 0 };       ///< Range of delay_buffer still to clear before target_lines run
+    size_t clear_end { 0 };
+
+    alignas(64) std::array<float, MAX_LINES> delays {};         ///< Base delay of each line, in samples
+    alignas(64) std::array<float, MAX_LINES> feedback {};       ///< Per-line gain giving the requested RT60
+    alignas(64) std::array<float, MAX_LINES> damp_state {};
+    alignas(64) std::array<float, MAX_LINES> mod_offset {};     ///< Current modulation, in samples
+    std::array<float, MAX_LINES> lfo_phase {};
+
+    float damp_coeff { 0.0f };
+    float mod_depth_samples { 0.0f };
+    float lfo_increment { 0.0f };   ///< Radians per MODULATION_INTERVAL
+    int mod_countdown { 0 };
+
+    float wet1 { 0.0f };
+    float wet2 { 0.0f };
+    float dry { 0.0f };
+};
+
+} // namespace jnickg::audio::ws
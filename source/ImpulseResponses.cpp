@@ -0,0 +1,74 @@
+#include "ImpulseResponses.hpp"
+
+#include <cmath>
+
+namespace jnickg::audio::ws::ir {
+
+namespace {
+
+struct SpaceInfo {
+    double length_seconds;
+    double rt60_seconds;
+    double pre_delay_seconds;
+    int early_reflections;          ///< Discrete taps over the first early_seconds
+    double early_seconds;
+    float brightness_start;         ///< One-pole lowpass coefficient at t = 0 (0 = brightest)
+    float brightness_end;           ///< ... and at the end of the IR
+};
+
+SpaceInfo get_info(Space s) {
+    switch (s) {
+        case Space::temple_hall: return { 8.0, 7.0, 0.03, 24, 0.12, 0.2f, 0.9f };
+        case Space::garden: return { 2.5, 1.8, 0.005, 12, 0.08, 0.05f, 0.4f };
+        case Space::__COUNT:
+        default: throw std::runtime_error("Invalid space");
+    }
+}
+
+} // namespace
+
+double get_length_seconds(Space s) {
+    return get_info(s).length_seconds;
+}
+
+juce::AudioBuffer<float> generate(Space s, double sampleRate, uint32_t seed) {
+    auto info = get_info(s);
+    auto num_samples = static_cast<int>(info.length_seconds * sampleRate);
+    juce::AudioBuffer<float> result(2, num_samples);
+    result.clear();
+
+    juce::Random random(static_cast<juce::int64>(seed));
+    auto pre_delay = static_cast<int>(info.pre_delay_seconds * sampleRate);
+    auto decay_per_sample = std::pow(0.001, 1.0 / (info.rt60_seconds * sampleRate));
+
+    for (int ch = 0; ch < result.getNumChannels(); ++ch) {
+        auto* out = result.getWritePointer(ch);
+
+        // Diffuse tail: exponentially decaying noise, darkening over time
+        auto envelope = 1.0;
+        auto lowpass = 0.0f;
+        for (int i = pre_delay; i < num_samples; ++i) {
+            auto t = static_cast<float>(i) / static_cast<float>(num_samples);
+            auto coeff = info.brightness_start + t * (info.brightness_end - info.brightness_start);
+            auto noise = random.nextFloat() * 2.0f - 1.0f;
+            lowpass = noise + coeff * (lowpass - noise);
+            out[i] = lowpass * static_cast<float>(envelope);
+            envelope *= decay_per_sample;
+        }
+
+        // Early reflections: sparse taps, different per channel for width
+        auto early_samples = static_cast<int>(info.early_seconds * sampleRate);
+        for (int r = 0; r < info.early_reflections; ++r) {
+            auto pos = pre_delay + random.nextInt(juce::jmax(early_samples, 1));
+            if (pos >= num_samples) {
+                continue;
+            }
+            auto gain = (1.0f - static_cast<float>(pos - pre_delay) / static_cast<float>(early_samples + 1)) * 0.5f;
+            out[pos] += random.nextBool() ? gain : -gain;
+        }
+    }
+
+    return result;
+}
+
+} // namespace jnickg::audio::ws::ir
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace jnickg::audio::ws::ir {
+
+/**
+ * @brief Spaces for which WabiSonorance can synthesize an impulse response.
+ *
+ * These are generated rather than recorded, so the plugin ships without IR assets. Users can
+ * still load any recorded IR from disk instead.
+ */
+enum class Space
+{
+    __FIRST = 0,
+    temple_hall = __FIRST,  ///< Long, dark, dense tail
+    garden,                 ///< Sparse early reflections and a short, bright tail
+    __COUNT
+};
+
+inline std::string to_string(Space s) {
+    switch (s) {
+        case Space::temple_hall: return "Temple Hall";
+        case Space::garden: return "Garden";
+        case Space::__COUNT:
+        default: throw std::runtime_error("Invalid space");
+    }
+}
+
+/**
+ * @brief Length of the impulse response generated for the given space, in seconds.
+ */
+double get_length_seconds(Space s);
+
+/**
+ * @brief Synthesizes a stereo impulse response for the given space.
+ *
+ * @note Not real-time safe: allocates the returned buffer. Intended to run on a background thread.
+ */
+juce::AudioBuffer<float> generate(Space s, double sampleRate, uint32_t seed = 1);
+
+} // namespace jnickg::audio::ws::ir
@@ -0,0 +1,72 @@
+#include "KeySwitcher.hpp"
+
+namespace jnickg::audio::ws {
+
+namespace {
+
+constexpr int NUM_SCALES = static_cast<int>(scale::__COUNT);
+
+int encode(const key_info& key) {
+    return static_cast<int>(key.root) * NUM_SCALES + static_cast<int>(key.scale_type);
+}
+
+key_info decode(int code) {
+    return {
+        .root = static_cast<note>(code / NUM_SCALES),
+        .scale_type = static_cast<scale>(code % NUM_SCALES),
+    };
+}
+
+} // namespace
+
+std::shared_ptr<const KeyTables> KeyTables::build(const key_info& key) {
+    auto tables = std::make_shared<KeyTables>();
+    tables->key = key;
+    tables->chords.build(key);
+    tables->scale.build(key);
+    tables->quantizer.build(key);
+    return tables;
+}
+
+KeySwitcher::KeySwitcher(const key_info& initial)
+    : tables(KeyTables::build(initial))
+{
+    // no-op
+}
+
+KeySwitcher::~KeySwitcher() {
+    this->stop();
+}
+
+void KeySwitcher::start() {
+    this->background->addTimeSliceClient(this);
+}
+
+void KeySwitcher::stop() {
+    // Waits for a build that's already running
+    this->background->removeTimeSliceClient(this);
+}
+
+void KeySwitcher::set_key(const key_info& key) {
+    const std::lock_guard<std::mutex> lock(this->build_lock);
+    if (encode(this->get_key()) == encode(key)) {
+        return;
+    }
+    this->tables.publish(KeyTables::build(key));
+}
+
+void KeySwitcher::request_key(const key_info& key) {
+    this->requested.store(encode(key));
+}
+
+int KeySwitcher::useTimeSlice() {
+    auto code = this->requested.exchange(NO_REQUEST);
+    if (code != NO_REQUEST) {
+        this->set_key(decode(code));
+    }
+    // Frees the tables the audio thread stopped using since the last switch
+    this->tables.collect();
+    return POLL_INTERVAL_MS;
+}
+
+} // namespace jnickg::audio::ws
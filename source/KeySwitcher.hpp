@@ -0,0 +1,91 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "BackgroundThread.hpp"
+#include "ChordTable.hpp"
+#include "EchoEngine.hpp"
+#include "NotesKeys.hpp"
+#include "Rcu.hpp"
+#include "ScaleQuantizer.hpp"
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief Everything the audio thread looks up by key, built together so a key switch is atomic.
+ */
+struct KeyTables {
+    key_info key;
+    ChordTable chords;          ///< What the voices pick from on note-on
+    EchoEngine::Scale scale;    ///< What the echoes walk through
+    ScaleQuantizer quantizer;   ///< What incoming notes are snapped into
+
+    /**
+     * @note Not real-time safe: runs the chord search the first time a key is built.
+     */
+    static std::shared_ptr<const KeyTables> build(const key_info& key);
+};
+
+/**
+ * @brief Switches key while playing, without the audio thread building or freeing anything.
+ *
+ * The current KeyTables are published through an Rcu. set_key() builds new tables on the calling
+ * thread; request_key() is for the audio thread (e.g. to follow automation), and leaves the build
+ * to the shared BackgroundThread, which checks for requests every POLL_INTERVAL_MS once start()ed.
+ * Either way, the audio thread picks the new tables up with its next read(). Notes already sounding
+ * keep their chord.
+ */
+class KeySwitcher : private juce::TimeSliceClient
+{
+public:
+    static inline constexpr int POLL_INTERVAL_MS = 10;
+
+    explicit KeySwitcher(const key_info& initial);
+    ~KeySwitcher() override;
+
+    void start();
+    void stop();
+
+    /**
+     * @brief Builds and publishes the tables for a key. Not real-time safe; does nothing if the key
+     * is already current.
+     */
+    void set_key(const key_info& key);
+
+    /**
+     * @brief Asks the background thread to switch key. Real-time safe. Only the latest request
+     * before the thread wakes is built.
+     */
+    void request_key(const key_info& key);
+
+    /**
+     * @brief The key last published. Not real-time safe.
+     */
+    key_info get_key() const { return this->tables.get_latest()->key; }
+
+    /**
+     * @brief The tables to use until the next read(). Real-time safe; only one thread may read.
+     */
+    const KeyTables& read() { return *this->tables.read(); }
+
+    /**
+     * @brief Tables published over but not freed yet. Freed once the reader has moved past them.
+     */
+    size_t get_num_retired() const { return this->tables.get_num_retired(); }
+
+private:
+    static inline constexpr int NO_REQUEST = -1;
+
+    int useTimeSlice() override;
+
+    juce::SharedResourcePointer<BackgroundThread> background;
+    Rcu<KeyTables> tables;
+    std::mutex build_lock;                      ///< Held from building tables until they're published
+    std::atomic<int> requested { NO_REQUEST };  ///< Root and scale, packed into one int
+};
+
+} // namespace jnickg::audio::ws
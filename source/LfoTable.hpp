@@ -0,0 +1,55 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+namespace jnickg::audio::ws::lfo {
+
+/**
+ * @brief One cycle of a sine, shared by every LFO in the plugin.
+ *
+ * Built once per process (thread-safe via the function-local static), so LFOs cost a table lookup
+ * and a lerp instead of a std::sin per sample.
+ */
+class SineTable
+{
+public:
+    static inline constexpr size_t SIZE = 2048;
+
+    static const SineTable& get() {
+        static const SineTable table;
+        return table;
+    }
+
+    /**
+     * @brief sin(2 pi phase), for phase in [0, 1).
+     */
+    inline float operator()(float phase) const {
+        auto pos = phase * static_cast<float>(SIZE);
+        auto idx = static_cast<size_t>(pos);
+        auto frac = pos - static_cast<float>(idx);
+        idx &= SIZE - 1;
+        return this->values[idx] + frac * (this->values[idx + 1] - this->values[idx]);
+    }
+
+private:
+    SineTable() {
+        for (size_t i = 0; i <= SIZE; ++i) {
+            this->values[i] = static_cast<float>(std::sin(juce::MathConstants<double>::twoPi * static_cast<double>(i) / SIZE));
+        }
+    }
+
+    std::array<float, SIZE + 1> values {};  ///< Extra guard point so lerp never wraps
+};
+
+/**
+ * @brief Wraps a phase back into [0, 1).
+ */
+inline float wrap(float phase) {
+    return phase - std::floor(phase);
+}
+
+} // namespace jnickg::audio::ws::lfo
@@ -0,0 +1,154 @@
+#include "LoadGenerator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace jnickg::audio::ws::load {
+
+namespace {
+
+constexpr auto NEVER = std::numeric_limits<juce::int64>::max();
+constexpr int STORM_NOTES = 40;     ///< Well past the plugin's 16 voices
+constexpr double SWEEP_INTERVAL_SECONDS = 0.01;
+constexpr double SWEEP_PERIOD_SECONDS = 4.0;
+
+} // namespace
+
+Generator::Generator(const Settings& s, double sr)
+    : settings(s)
+    , sample_rate(sr)
+    , random(s.seed)
+{
+    this->note_off_at.fill(-1);
+    for (int p = 0; p < NUM_PATTERNS; ++p) {
+        this->next_event[static_cast<size_t>(p)] = this->settings.patterns[static_cast<size_t>(p)] ? 0 : NEVER;
+    }
+    // Staggered, so the patterns don't all start on the first sample
+    if (this->settings.patterns[static_cast<size_t>(Pattern::retrigger_storm)]) {
+        this->next_event[static_cast<size_t>(Pattern::retrigger_storm)] = this->random_samples(0.5, 2.0);
+    }
+    if (this->settings.patterns[static_cast<size_t>(Pattern::key_changes)]) {
+        this->next_event[static_cast<size_t>(Pattern::key_changes)] = this->random_samples(10.0, 30.0);
+    }
+}
+
+juce::int64 Generator::random_samples(double min_seconds, double max_seconds) {
+    auto seconds = min_seconds + (max_seconds - min_seconds) * this->random.nextDouble();
+    return std::max<juce::int64>(1, this->seconds_to_samples(seconds));
+}
+
+int Generator::random_note() {
+    return this->settings.lowest_note + this->random.nextInt(this->settings.highest_note - this->settings.lowest_note + 1);
+}
+
+void Generator::note_on(juce::MidiBuffer& midi, int note, float velocity, juce::int64 at, juce::int64 length) {
+    note = std::clamp(note, 0, 127);
+    auto& off_at = this->note_off_at[static_cast<size_t>(note)];
+    if (off_at >= 0) {
+        if (off_at > at) {
+            return;
+        }
+        // Due earlier in this block, but not sent yet
+        midi.addEvent(juce::MidiMessage::noteOff(1, note), static_cast<int>(off_at - this->position));
+    }
+    midi.addEvent(juce::MidiMessage::noteOn(1, note, velocity), static_cast<int>(at - this->position));
+    off_at = at + length;
+}
+
+void Generator::run(Pattern p, juce::MidiBuffer& midi, juce::int64 at, std::optional<key_info>& key_change) {
+    auto& next = this->next_event[static_cast<size_t>(p)];
+    auto density = std::max(this->settings.density, 0.01);
+    switch (p) {
+        case Pattern::chord_clusters: {
+            auto base = this->random_note();
+            auto num_notes = 4 + this->random.nextInt(5);
+            for (int i = 0; i < num_notes; ++i) {
+                auto note = std::clamp(base + this->random.nextInt(25) - 12, this->settings.lowest_note, this->settings.highest_note);
+                this->note_on(midi, note, 0.3f + 0.6f * this->random.nextFloat(), at, this->random_samples(0.5, 2.0));
+            }
+            next = at + this->random_samples(1.0 / density, 3.0 / density);
+            break;
+        }
+        case Pattern::retrigger_storm: {
+            if (this->storm_notes_left == 0) {
+                this->storm_notes_left = STORM_NOTES;
+            }
+            this->note_on(midi, this->random_note(), 0.2f + 0.8f * this->random.nextFloat(), at, this->random_samples(0.005, 0.03));
+            --this->storm_notes_left;
+            next = at + (this->storm_notes_left > 0 ? this->random_samples(0.01, 0.02) : this->random_samples(2.0 / density, 6.0 / density));
+            break;
+        }
+        case Pattern::sustained_pads: {
+            auto base = this->random_note();
+            auto num_notes = 3 + this->random.nextInt(2);
+            for (int i = 0; i < num_notes; ++i) {
+                this->note_on(midi, base + 7 * i, 0.3f + 0.3f * this->random.nextFloat(), at, this->random_samples(10.0, 30.0));
+            }
+            next = at + this->random_samples(8.0 / density, 16.0 / density);
+            break;
+        }
+        case Pattern::pitch_sweeps: {
+            auto value = 8192.0 + 8191.0 * std::sin(this->sweep_phase);
+            midi.addEvent(juce::MidiMessage::pitchWheel(1, static_cast<int>(value)), static_cast<int>(at - this->position));
+            this->sweep_phase = std::fmod(this->sweep_phase + juce::MathConstants<double>::twoPi * SWEEP_INTERVAL_SECONDS / SWEEP_PERIOD_SECONDS,
+                                          juce::MathConstants<double>::twoPi);
+            next = at + this->seconds_to_samples(SWEEP_INTERVAL_SECONDS);
+            break;
+        }
+        case Pattern::key_changes: {
+            key_info k;
+            k.root = static_cast<note>(this->random.nextInt(static_cast<int>(note::__COUNT)));
+            k.scale_type = static_cast<scale>(this->random.nextInt(static_cast<int>(scale::__COUNT)));
+            key_change = k;
+            next = at + this->random_samples(15.0, 25.0);
+            break;
+        }
+        case Pattern::__COUNT:
+        default:
+            next = NEVER;
+            break;
+    }
+}
+
+std::optional<key_info> Generator::next_block(juce::MidiBuffer& midi, int num_samples) {
+    std::optional<key_info> key_change;
+    auto end = this->position + num_samples;
+    for (int p = 0; p < NUM_PATTERNS; ++p) {
+        while (this->next_event[static_cast<size_t>(p)] < end) {
+            this->run(static_cast<Pattern>(p), midi, this->next_event[static_cast<size_t>(p)], key_change);
+        }
+    }
+    for (int note = 0; note < 128; ++note) {
+        auto& off_at = this->note_off_at[static_cast<size_t>(note)];
+        if (off_at >= 0 && off_at < end) {
+            midi.addEvent(juce::MidiMessage::noteOff(1, note), static_cast<int>(std::max(off_at, this->position) - this->position));
+            off_at = -1;
+        }
+    }
+    this->position = end;
+    return key_change;
+}
+
+juce::MidiMessageSequence Generator::next_sequence(double seconds, int block_size) {
+    juce::MidiMessageSequence sequence;
+    juce::MidiBuffer midi;
+    auto end = this->position + this->seconds_to_samples(seconds);
+    while (this->position < end) {
+        auto block_start = this->position;
+        auto num_samples = static_cast<int>(std::min<juce::int64>(block_size, end - block_start));
+        midi.clear();
+        auto key_change = this->next_block(midi, num_samples);
+        if (key_change) {
+            auto text = juce::MidiMessage::textMetaEvent(1, juce::String(KEY_CHANGE_PREFIX) + key_change->to_string());
+            sequence.addEvent(text, static_cast<double>(block_start) / this->sample_rate);
+        }
+        for (const auto metadata : midi) {
+            sequence.addEvent(metadata.getMessage(), static_cast<double>(block_start + metadata.samplePosition) / this->sample_rate);
+        }
+    }
+    sequence.updateMatchedPairs();
+    return sequence;
+}
+
+} // namespace jnickg::audio::ws::load
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "NotesKeys.hpp"
+
+namespace jnickg::audio::ws::load {
+
+/**
+ * @brief Kinds of MIDI traffic the Generator can mix together.
+ */
+enum class Pattern
+{
+    __FIRST = 0,
+    chord_clusters = __FIRST,   ///< 4-8 notes struck together, held for a second or two
+    retrigger_storm,            ///< Bursts of short notes, more than PluginProcessor::DEFAULT_VOICES at once
+    sustained_pads,             ///< A few notes held for tens of seconds, as in long ambient sets
+    pitch_sweeps,               ///< A continuous pitch-wheel sine, a message every 10 ms
+    key_changes,                ///< A random key every 20 seconds or so
+    __COUNT
+};
+
+inline std::string to_string(Pattern p) {
+    switch (p) {
+        case Pattern::chord_clusters: return "Chord clusters";
+        case Pattern::retrigger_storm: return "Retrigger storm";
+        case Pattern::sustained_pads: return "Sustained pads";
+        case Pattern::pitch_sweeps: return "Pitch sweeps";
+        case Pattern::key_changes: return "Key changes";
+        case Pattern::__COUNT:
+        default: throw std::runtime_error("Invalid pattern");
+    }
+}
+
+/**
+ * @brief Produces synthetic, reproducible MIDI workloads for benchmarks and soak tests.
+ *
+ * Each enabled Pattern runs as its own stream of events, and the streams are merged. Everything
+ * is derived from the seed, so the same settings always produce the same MIDI. Events are made a
+ * block at a time and the state is fixed-size, so a workload can run for hours without growing;
+ * next_block() doesn't allocate once the MidiBuffer has room.
+ */
+class Generator
+{
+public:
+    static inline constexpr int NUM_PATTERNS = static_cast<int>(Pattern::__COUNT);
+    static inline constexpr const char* KEY_CHANGE_PREFIX = "key: ";   ///< Then the key, as parse_key() reads it
+
+    struct Settings {
+        std::array<bool, NUM_PATTERNS> patterns { true, true, true, true, true };
+        juce::int64 seed { 1 };
+        double density { 1.0 };     ///< Scales how often notes are struck
+        int lowest_note { 36 };
+        int highest_note { 96 };
+
+        Settings& only(Pattern p) {
+            this->patterns.fill(false);
+            this->patterns[static_cast<size_t>(p)] = true;
+            return *this;
+        }
+    };
+
+    Generator(const Settings& settings, double sample_rate);
+
+    /**
+     * @brief Appends the next num_samples worth of events to midi, at positions within the block.
+     *
+     * @return The key to switch to from this block on, if the key_changes pattern picked one.
+     */
+    std::optional<key_info> next_block(juce::MidiBuffer& midi, int num_samples);
+
+    /**
+     * @brief The next seconds of events as a sequence, timestamps in seconds from the start.
+     * Key changes become text meta events: KEY_CHANGE_PREFIX and the key.
+     */
+    juce::MidiMessageSequence next_sequence(double seconds, int block_size = 512);
+
+    juce::int64 get_position() const { return this->position; }
+
+private:
+    juce::int64 seconds_to_samples(double seconds) const {
+        return static_cast<juce::int64>(seconds * this->sample_rate);
+    }
+    juce::int64 random_samples(double min_seconds, double max_seconds);
+    int random_note();
+
+    // Strikes the note unless it's already sounding, and schedules its note-off
+    void note_on(juce::MidiBuffer& midi, int note, float velocity, juce::int64 at, juce::int64 length);
+
+    void run(Pattern p, juce::MidiBuffer& midi, juce::int64 at, std::optional<key_info>& key_change);
+
+    Settings settings;
+    double sample_rate;
+    juce::Random random;
+    juce::int64 position { 0 };
+    std::array<juce::int64, NUM_PATTERNS> next_event {};
+    std::array<juce::int64, 128> note_off_at {};   ///< -1 when the note isn't sounding
+    int storm_notes_left { 0 };
+    double sweep_phase { 0.0 };
+};
+
+} // namespace jnickg::audio::ws::load
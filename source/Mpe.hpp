@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief The expression of each MIDI channel, for MPE: every note on its own channel, with its
+ * own pitch bend, pressure and timbre (CC74).
+ *
+ * Covers the lower zone: channel 1 is the master channel, whose pitch bend moves every note, and
+ * channels 2-16 carry one note each. The Synth writes each channel's latest values as they arrive
+ * and the voices read their own channel's, so a note starts from whatever its channel was sent
+ * before the note-on. Fixed-size and allocation-free; audio thread only.
+ */
+class MpeZone
+{
+public:
+    static inline constexpr int NUM_CHANNELS = 16;
+    static inline constexpr int MASTER_CHANNEL = 1;
+    static inline constexpr float DEFAULT_NOTE_BEND_RANGE = 48.0f;  ///< Semitones, as the MPE spec says
+    static inline constexpr float MASTER_BEND_RANGE = 2.0f;         ///< Semitones
+
+    static inline constexpr int PITCH_WHEEL_CENTRE = 8192;
+    static inline constexpr int TIMBRE_CENTRE = 64;
+    static inline constexpr int TIMBRE_CONTROLLER = 74;
+
+    struct Expression {
+        float bend { 0.0f };        ///< Semitones, the master channel's included
+        float pressure { 0.0f };    ///< 0 to 1
+        float timbre { 0.0f };      ///< -1 to 1, 0 at the controller's centre
+    };
+
+    MpeZone() { this->reset(); }
+
+    /**
+     * @brief Whether notes follow their channel's expression. Channels are tracked either way.
+     */
+    void set_enabled(bool e) { this->enabled = e; }
+    bool is_enabled() const { return this->enabled; }
+
+    /**
+     * @brief The member channels' pitch bend range, in semitones either way.
+     */
+    void set_note_bend_range(float semitones) { this->note_bend_range = std::max(semitones, 0.0f); }
+    float get_note_bend_range() const { return this->note_bend_range; }
+
+    /**
+     * @brief Centres every channel.
+     */
+    void reset() {
+        this->pitch_wheels.fill(PITCH_WHEEL_CENTRE);
+        this->pressures.fill(0);
+        this->timbres.fill(TIMBRE_CENTRE);
+    }
+
+    static bool is_master(int channel) { return channel == MASTER_CHANNEL; }
+
+    void set_pitch_wheel(int channel, int value) { this->pitch_wheels[index(channel)] = std::clamp(value, 0, 16383); }
+    void set_pressure(int channel, int value) { this->pressures[index(channel)] = std::clamp(value, 0, 127); }
+    void set_timbre(int channel, int value) { this->timbres[index(channel)] = std::clamp(value, 0, 127); }
+
+    Expression get_expression(int channel) const {
+        auto i = index(channel);
+        Expression e;
+        e.bend = bend_semitones(this->pitch_wheels[i], this->note_bend_range)
+            + bend_semitones(this->pitch_wheels[index(MASTER_CHANNEL)], MASTER_BEND_RANGE);
+        e.pressure = static_cast<float>(this->pressures[i]) / 127.0f;
+        e.timbre = std::clamp(static_cast<float>(this->timbres[i] - TIMBRE_CENTRE) / static_cast<float>(127 - TIMBRE_CENTRE), -1.0f, 1.0f);
+        return e;
+    }
+
+private:
+    static size_t index(int channel) { return static_cast<size_t>(std::clamp(channel, 1, NUM_CHANNELS) - 1); }
+
+    static float bend_semitones(int pitch_wheel, float range) {
+        return range * static_cast<float>(pitch_wheel - PITCH_WHEEL_CENTRE) / static_cast<float>(PITCH_WHEEL_CENTRE);
+    }
+
+    bool enabled { false };
+    float note_bend_range { DEFAULT_NOTE_BEND_RANGE };
+    std::array<int, NUM_CHANNELS> pitch_wheels {};
+    std::array<int, NUM_CHANNELS> pressures {};
+    std::array<int, NUM_CHANNELS> timbres {};
+};
+
+} // namespace jnickg::audio::ws
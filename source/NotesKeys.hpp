@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <array>
+#include <cctype>
 #include <cmath>
 #include <cstdint>
 #include <mutex>
@@ -867,6 +868,58 @@ struct key_info {
     }
 };
 
+/**
+ * @brief Parses a key as written by key_info::to_string(), e.g. "A Yonanuki" or "C# Harmonic Minor".
+ *
+ * Case is ignored, flats ("Bb") are accepted, and underscores may stand in for spaces, so keys can
+ * be given on a command line as e.g. "bb_harmonic_minor".
+ */
+inline key_info parse_key(const std::string& str) {
+    auto normalize = [](std::string s) {
+        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) {
+            return c == '_' ? ' ' : static_cast<char>(std::tolower(c));
+        });
+        return s;
+    };
+    auto normalized = normalize(str);
+    auto split = normalized.find(' ');
+    if (split == std::string::npos) {
+        throw std::runtime_error("Invalid key: " + str);
+    }
+    auto root_str = normalized.substr(0, split);
+    auto scale_str = normalized.substr(normalized.find_first_not_of(' ', split));
+
+    // Flats are one semitone below the natural note's sharp-spelled neighbour
+    auto semitone_offset = 0;
+    if (root_str.size() == 2 && root_str[1] == 'b') {
+        semitone_offset = -1;
+        root_str.resize(1);
+    }
+
+    key_info k;
+    auto found_root = false;
+    for (auto n : get_notes()) {
+        if (normalize(to_string(n)) == root_str) {
+            auto count = static_cast<int>(note::__COUNT);
+            k.root = static_cast<note>((static_cast<int>(n) + semitone_offset + count) % count);
+            found_root = true;
+            break;
+        }
+    }
+    auto found_scale = false;
+    for (auto s = static_cast<int>(scale::__FIRST); s < static_cast<int>(scale::__COUNT); ++s) {
+        if (normalize(to_string(static_cast<scale>(s))) == scale_str) {
+            k.scale_type = static_cast<scale>(s);
+            found_scale = true;
+            break;
+        }
+    }
+    if (!found_root || !found_scale) {
+        throw std::runtime_error("Invalid key: " + str);
+    }
+    return k;
+}
+
 inline bool chord_fits_key(const chord_info& c, const key_info& k) {
     // A chord is considerd in the given key if the root note is in the key, and if all the
     // intervals of the chord fit in the intervals of the key's scale.
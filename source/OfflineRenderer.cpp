@@ -0,0 +1,287 @@
+#include "OfflineRenderer.hpp"
+
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+
+#include "PluginProcessor.h"
+
+namespace jnickg::audio::ws::offline {
+
+namespace {
+
+// Stands in for the host's transport, so the echoes get a tempo
+class OfflinePlayHead : public juce::AudioPlayHead
+{
+public:
+    OfflinePlayHead(double b, double sr)
+        : bpm(b)
+        , sample_rate(sr)
+    {
+        // no-op
+    }
+
+    void set_position(juce::int64 sample) { this->position = sample; }
+
+    juce::Optional<PositionInfo> getPosition() const override {
+        PositionInfo info;
+        info.setBpm(this->bpm);
+        info.setTimeInSamples(this->position);
+        info.setTimeInSeconds(static_cast<double>(this->position) / this->sample_rate);
+        info.setIsPlaying(true);
+        return info;
+    }
+
+private:
+    double bpm;
+    double sample_rate;
+    juce::int64 position { 0 };
+};
+
+using StartFn = std::function<void(int num_channels, juce::int64 num_samples)>;
+using BlockFn = std::function<void(const juce::AudioBuffer<float>& block, juce::int64 position)>;
+
+// Renders the sequence, handing each block to on_block as it's done
+Result render_blocks(const juce::MidiMessageSequence& sequence, const Options& options, const StartFn& on_start, const BlockFn& on_block) {
+    PluginProcessor plugin;
+    plugin.setNonRealtime(true);
+    plugin.set_key(options.key);
+    plugin.set_seed(options.seed);
+    plugin.set_chord_trace_enabled(options.trace_chords);
+    plugin.setRateAndBufferSizeDetails(options.sample_rate, options.block_size);
+    OfflinePlayHead play_head(options.bpm > 0.0 ? options.bpm : get_bpm(sequence), options.sample_rate);
+    plugin.setPlayHead(&play_head);
+    if (options.configure) {
+        options.configure(plugin);
+    }
+    plugin.prepareToPlay(options.sample_rate, options.block_size);
+
+    auto tail_seconds = options.tail_seconds >= 0.0 ? options.tail_seconds : plugin.getTailLengthSeconds();
+    auto end_seconds = (sequence.getNumEvents() > 0 ? sequence.getEndTime() : 0.0) + tail_seconds;
+    auto total_samples = static_cast<juce::int64>(std::ceil(end_seconds * options.sample_rate));
+    auto num_channels = plugin.getTotalNumOutputChannels();
+
+    Result result;
+    result.sample_rate = options.sample_rate;
+    result.num_samples = total_samples;
+    auto start_ms = juce::Time::getMillisecondCounterHiRes();
+    on_start(num_channels, total_samples);
+
+    juce::AudioBuffer<float> block(num_channels, options.block_size);
+    juce::MidiBuffer midi;
+    auto next_event = 0;
+    for (juce::int64 position = 0; position < total_samples; position += options.block_size) {
+        auto num_samples = static_cast<int>(std::min<juce::int64>(options.block_size, total_samples - position));
+
+        midi.clear();
+        for (; next_event < sequence.getNumEvents(); ++next_event) {
+            const auto& message = sequence.getEventPointer(next_event)->message;
+            auto sample = static_cast<juce::int64>(std::llround(message.getTimeStamp() * options.sample_rate));
+            if (sample >= position + num_samples) {
+                break;
+            }
+            if (!message.isMetaEvent()) {
+                midi.addEvent(message, static_cast<int>(std::max<juce::int64>(0, sample - position)));
+            }
+        }
+
+        block.setSize(num_channels, num_samples, false, false, true);
+        block.clear();
+        play_head.set_position(position);
+        plugin.processBlock(block, midi);
+        on_block(block, position);
+    }
+    result.render_seconds = (juce::Time::getMillisecondCounterHiRes() - start_ms) * 1.0e-3;
+
+    plugin.releaseResources();
+    plugin.setPlayHead(nullptr);
+    return result;
+}
+
+std::unique_ptr<juce::AudioFormatWriter> create_writer(const juce::File& file, double sample_rate, int num_channels, int bits_per_sample) {
+    std::unique_ptr<juce::AudioFormat> format;
+    if (file.hasFileExtension("wav")) {
+        format = std::make_unique<juce::WavAudioFormat>();
+    } else if (file.hasFileExtension("flac")) {
+        format = std::make_unique<juce::FlacAudioFormat>();
+    } else {
+        throw std::runtime_error("Unsupported audio file type (use .wav or .flac): " + file.getFileName().toStdString());
+    }
+
+    file.deleteFile();
+    auto stream = std::make_unique<juce::FileOutputStream>(file);
+    if (!stream->openedOk()) {
+        throw std::runtime_error("Can't write " + file.getFullPathName().toStdString());
+    }
+    std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(),
+                                                                            sample_rate,
+                                                                            static_cast<unsigned int>(num_channels),
+                                                                            bits_per_sample,
+                                                                            {},
+                                                                            0));
+    if (writer == nullptr) {
+        throw std::runtime_error(format->getFormatName().toStdString() + " can't be written at "
+                                 + std::to_string(bits_per_sample) + " bits, "
+                                 + std::to_string(static_cast<int>(sample_rate)) + " Hz");
+    }
+    // The writer owns the stream now
+    stream.release();
+    return writer;
+}
+
+} // namespace
+
+juce::MidiMessageSequence load_midi_file(const juce::File& file) {
+    juce::FileInputStream in(file);
+    if (!in.openedOk()) {
+        throw std::runtime_error("Can't open " + file.getFullPathName().toStdString());
+    }
+    juce::MidiFile midi;
+    if (!midi.readFrom(in)) {
+        throw std::runtime_error("Not a Standard MIDI File: " + file.getFullPathName().toStdString());
+    }
+    midi.convertTimestampTicksToSeconds();
+
+    juce::MidiMessageSequence sequence;
+    for (int track = 0; track < midi.getNumTracks(); ++track) {
+        sequence.addSequence(*midi.getTrack(track), 0.0);
+    }
+    sequence.updateMatchedPairs();
+    return sequence;
+}
+
+double get_bpm(const juce::MidiMessageSequence& sequence) {
+    for (const auto* event : sequence) {
+        if (event->message.isTempoMetaEvent()) {
+            return 60.0 / event->message.getTempoSecondsPerQuarterNote();
+        }
+    }
+    return 120.0;
+}
+
+Result render(const juce::MidiMessageSequence& sequence, const Options& options) {
+    juce::AudioBuffer<float> audio;
+    auto result = render_blocks(
+        sequence,
+        options,
+        [&audio](int num_channels, juce::int64 num_samples) {
+            audio.setSize(num_channels, static_cast<int>(num_samples));
+        },
+        [&audio](const juce::AudioBuffer<float>& block, juce::int64 position) {
+            for (int ch = 0; ch < block.getNumChannels(); ++ch) {
+                audio.copyFrom(ch, static_cast<int>(position), block, ch, 0, block.getNumSamples());
+            }
+        });
+    result.audio = std::move(audio);
+    return result;
+}
+
+Result render_to_file(const juce::MidiMessageSequence& sequence, const Options& options, const juce::File& file, int bits_per_sample) {
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    auto result = render_blocks(
+        sequence,
+        options,
+        [&](int num_channels, juce::int64) {
+            writer = create_writer(file, options.sample_rate, num_channels, bits_per_sample);
+        },
+        [&](const juce::AudioBuffer<float>& block, juce::int64) {
+            if (!writer->writeFromAudioSampleBuffer(block, 0, block.getNumSamples())) {
+                throw std::runtime_error("Failed writing " + file.getFullPathName().toStdString());
+            }
+        });
+    // Flushes and closes the file
+    writer.reset();
+    return result;
+}
+
+void write_audio_file(const juce::AudioBuffer<float>& audio, double sample_rate, const juce::File& file, int bits_per_sample) {
+    auto writer = create_writer(file, sample_rate, audio.getNumChannels(), bits_per_sample);
+    if (!writer->writeFromAudioSampleBuffer(audio, 0, audio.getNumSamples())) {
+        throw std::runtime_error("Failed writing " + file.getFullPathName().toStdString());
+    }
+}
+
+//==============================================================================
+double BatchResult::get_audio_seconds() const {
+    return std::accumulate(this->jobs.begin(), this->jobs.end(), 0.0, [](double total, const JobResult& j) {
+        return j.ok ? total + j.result.get_audio_seconds() : total;
+    });
+}
+
+double BatchResult::get_realtime_factor() const {
+    return this->wall_seconds > 0.0 ? this->get_audio_seconds() / this->wall_seconds : 0.0;
+}
+
+double BatchResult::get_parallelism() const {
+    auto busy_seconds = std::accumulate(this->jobs.begin(), this->jobs.end(), 0.0, [](double total, const JobResult& j) {
+        return total + j.result.render_seconds;
+    });
+    return this->wall_seconds > 0.0 ? busy_seconds / this->wall_seconds : 0.0;
+}
+
+size_t BatchResult::get_num_failed() const {
+    return static_cast<size_t>(std::count_if(this->jobs.begin(), this->jobs.end(), [](const JobResult& j) {
+        return !j.ok;
+    }));
+}
+
+BatchResult render_batch(const std::vector<Job>& jobs, int num_threads, std::function<void(const JobResult&)> on_job_finished) {
+    BatchResult batch;
+    batch.num_threads = num_threads > 0 ? num_threads : juce::SystemStats::getNumCpus();
+    batch.jobs.resize(jobs.size());
+    if (jobs.empty()) {
+        return batch;
+    }
+
+    // Longest first (by file size, as a stand-in for length), so the batch doesn't end waiting on one
+    std::vector<size_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), size_t { 0 });
+    std::stable_sort(order.begin(), order.end(), [&jobs](size_t a, size_t b) {
+        return jobs[a].input.getSize() > jobs[b].input.getSize();
+    });
+
+    std::mutex report_lock;
+    std::atomic<size_t> remaining { jobs.size() };
+    juce::WaitableEvent all_done;
+    auto start_ms = juce::Time::getMillisecondCounterHiRes();
+    {
+        juce::ThreadPool pool(batch.num_threads);
+        for (auto i : order) {
+            pool.addJob([&, i] {
+                // Counts the job down however it ends, or all_done.wait() below would never return
+                const juce::ErasedScopeGuard count_down { [&] {
+                    if (remaining.fetch_sub(1) == 1) {
+                        all_done.signal();
+                    }
+                } };
+                auto& r = batch.jobs[i];
+                r.job = jobs[i];
+                try {
+                    auto sequence = load_midi_file(r.job.input);
+                    r.result = render_to_file(sequence, r.job.options, r.job.output, r.job.bits_per_sample);
+                    r.ok = true;
+                } catch (const std::exception& e) {
+                    r.error = e.what();
+                } catch (...) {
+                    r.error = "unknown error";
+                }
+                if (on_job_finished) {
+                    const std::lock_guard<std::mutex> lock(report_lock);
+                    on_job_finished(r);
+                }
+            });
+        }
+        // The pool's destructor would drop jobs that haven't started yet
+        all_done.wait();
+    }
+    batch.wall_seconds = (juce::Time::getMillisecondCounterHiRes() - start_ms) * 1.0e-3;
+    return batch;
+}
+
+} // namespace jnickg::audio::ws::offline
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+
+#include <functional>
+#include <vector>
+
+#include "NotesKeys.hpp"
+
+class PluginProcessor;
+
+namespace jnickg::audio::ws::offline {
+
+/**
+ * @brief How to render a MIDI sequence without a host.
+ */
+struct Options {
+    double sample_rate { 48000.0 };
+    int block_size { 512 };
+    juce::int64 seed { 1 };             ///< Seeds the voices' chord choices, so renders repeat exactly
+    key_info key { note::A, scale::yonanuki };
+    double bpm { 0.0 };                 ///< Tempo for the echoes; 0 takes the sequence's first tempo (or 120)
+    double tail_seconds { -1.0 };       ///< Rendered after the last event; negative uses the plugin's tail length
+    bool trace_chords { false };        ///< Log the chords picked to stdout, as the plugin does by default
+
+    /// Called before prepareToPlay, to set anything else up, e.g. the phaser or reverb mode
+    std::function<void(PluginProcessor&)> configure;
+};
+
+struct Result {
+    juce::AudioBuffer<float> audio;     ///< Empty when rendered straight to a file
+    double sample_rate { 0.0 };
+    juce::int64 num_samples { 0 };
+    double render_seconds { 0.0 };      ///< Wall-clock time spent rendering (and writing, if to a file)
+
+    double get_audio_seconds() const { return static_cast<double>(this->num_samples) / this->sample_rate; }
+
+    /**
+     * @brief Seconds of audio rendered per second of wall-clock time; above 1 is faster than real time.
+     */
+    double get_realtime_factor() const {
+        return this->render_seconds > 0.0 ? this->get_audio_seconds() / this->render_seconds : 0.0;
+    }
+};
+
+/**
+ * @brief Reads a Standard MIDI File, with all tracks merged and timestamps in seconds.
+ *
+ * @throws std::runtime_error if the file can't be read or parsed.
+ */
+juce::MidiMessageSequence load_midi_file(const juce::File& file);
+
+/**
+ * @brief Tempo of the sequence's first tempo event, or 120 BPM if it has none.
+ */
+double get_bpm(const juce::MidiMessageSequence& sequence);
+
+/**
+ * @brief Plays the sequence (timestamps in seconds) through a new PluginProcessor, block by block,
+ * as fast as the machine allows.
+ *
+ * Each call has its own PluginProcessor, so calls on different threads don't affect each other.
+ */
+Result render(const juce::MidiMessageSequence& sequence, const Options& options);
+
+/**
+ * @brief As render(), but streams the audio to a WAV or FLAC file (chosen by its extension)
+ * instead of holding it all in memory.
+ *
+ * @throws std::runtime_error if the format is unknown or the file can't be written.
+ */
+Result render_to_file(const juce::MidiMessageSequence& sequence, const Options& options, const juce::File& file, int bits_per_sample = 24);
+
+/**
+ * @brief Writes audio as WAV or FLAC, chosen by the file's extension.
+ *
+ * @throws std::runtime_error if the format is unknown or the file can't be written.
+ */
+void write_audio_file(const juce::AudioBuffer<float>& audio, double sample_rate, const juce::File& file, int bits_per_sample = 24);
+
+//==============================================================================
+// Batches
+
+struct Job {
+    juce::File input;       ///< Standard MIDI File
+    juce::File output;      ///< .wav or .flac
+    Options options;
+    int bits_per_sample { 24 };
+};
+
+struct JobResult {
+    Job job;
+    bool ok { false };
+    juce::String error;     ///< Why the job failed, if it did
+    Result result;          ///< Its audio is always empty; see render_to_file
+};
+
+struct BatchResult {
+    std::vector<JobResult> jobs;    ///< In the order the jobs were given
+    double wall_seconds { 0.0 };
+    int num_threads { 0 };
+
+    double get_audio_seconds() const;
+
+    /**
+     * @brief Seconds of audio rendered, across all jobs, per second of wall-clock time.
+     */
+    double get_realtime_factor() const;
+
+    /**
+     * @brief Sum of the jobs' render times over the wall-clock time: how many cores were kept busy.
+     */
+    double get_parallelism() const;
+
+    size_t get_num_failed() const;
+};
+
+/**
+ * @brief Renders every job to its output file, num_threads at a time (0 for one per CPU core).
+ *
+ * Every job runs in its own PluginProcessor, sharing only the immutable chord tables (see
+ * ChordTable) and LFO tables. Jobs are started largest input file first, so long renders don't
+ * end up alone at the tail of the batch. A failed job is reported in its JobResult and doesn't stop
+ * the others.
+ *
+ * @param on_job_finished Called as each job finishes, from the thread that rendered it (but never
+ * from two threads at once).
+ */
+BatchResult render_batch(const std::vector<Job>& jobs,
+                         int num_threads = 0,
+                         std::function<void(const JobResult&)> on_job_finished = nullptr);
+
+} // namespace jnickg::audio::ws::offline
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+#include "FastMath.hpp"
+#include "LfoTable.hpp"
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief A chain of first-order allpass stages swept by an LFO, processing Lanes channels at once.
+ *
+ * All per-stage state is laid out [stage][lane], and Phaser<2> processes left and right together
+ * in one pass over the stages. That isn't SIMD in practice: two lanes fill at most half an SSE
+ * register, and each stage depends on the one before, so the compiler keeps the lane loops scalar.
+ * The savings over juce::dsp::Phaser come from elsewhere: each lane's LFO is read from the shared
+ * lfo::SineTable, and allpass coefficients are only recomputed every UPDATE_INTERVAL samples.
+ *
+ * Use StereoPhaser for the global FX chain, and MonoPhaser for the cheap per-voice mode.
+ */
+template <size_t Lanes>
+class Phaser
+{
+public:
+    static inline constexpr size_t MAX_STAGES = 12;
+    static inline constexpr int UPDATE_INTERVAL = 16;
+    static inline constexpr float MIN_FREQUENCY = 20.0f;
+    static inline constexpr float MAX_FREQUENCY = 20000.0f;
+
+    struct Parameters {
+        size_t stages { 6 };                ///< Number of allpass stages, up to MAX_STAGES
+        float rate { 0.5f };                ///< LFO rate, in Hz
+        float depth { 0.7f };               ///< 0..1, sweep width on the normalised log-frequency scale
+        float centre { 0.56f };             ///< 0..1, centre of the sweep on a log scale from 20Hz to 20kHz
+        float feedback { 0.7f };            ///< -1..1
+        float mix { 0.7f };                 ///< 0..1
+        float lane_phase_offset { 0.25f };  ///< LFO phase offset between lanes, in cycles
+    };
+
+    void prepare(double sampleRate) {
+        this->sample_rate = sampleRate;
+        this->set_parameters(this->params);
+        this->reset();
+    }
+
+    void reset() {
+        for (auto& stage : this->state) {
+            stage.fill(0.0f);
+        }
+        this->last_output.fill(0.0f);
+        this->update_countdown = 0;
+        for (size_t l = 0; l < Lanes; ++l) {
+            this->lfo_phase[l] = lfo::wrap(this->phase_offset + static_cast<float>(l) * this->params.lane_phase_offset);
+        }
+    }
+
+    void set_parameters(const Parameters& p) {
+        this->params = p;
+        this->params.stages = std::clamp<size_t>(this->params.stages, 1, MAX_STAGES);
+        this->params.feedback = std::clamp(this->params.feedback, -0.95f, 0.95f);
+        this->params.mix = std::clamp(this->params.mix, 0.0f, 1.0f);
+        this->lfo_increment = static_cast<float>(this->params.rate * UPDATE_INTERVAL / this->sample_rate);
+        this->max_frequency = std::min(MAX_FREQUENCY, static_cast<float>(0.49 * this->sample_rate));
+    }
+
+    const Parameters& get_parameters() const { return this->params; }
+
+    /**
+     * @brief Starting LFO phase of lane 0, in cycles. Lets several phasers move independently.
+     */
+    void set_phase_offset(float offset) { this->phase_offset = lfo::wrap(offset); }
+
+    /**
+     * @brief Processes one sample per lane, in place.
+     */
+    inline void process_frame(float* frame) {
+        if (--this->update_countdown <= 0) {
+            this->update_coefficients();
+        }
+
+        const auto stages = this->params.stages;
+        const auto feedback = this->params.feedback;
+        const auto wet = this->params.mix;
+        const auto dry = 1.0f - wet;
+
+        alignas(16) std::array<float, Lanes> x;
+        for (size_t l = 0; l < Lanes; ++l) {
+            x[l] = frame[l] + feedback * this->last_output[l];
+        }
+        for (size_t s = 0; s < stages; ++s) {
+            for (size_t l = 0; l < Lanes; ++l) {
+                // Transposed direct form II first-order allpass
+                auto y = this->coeff[l] * x[l] + this->state[s][l];
+                this->state[s][l] = x[l] - this->coeff[l] * y;
+                x[l] = y;
+            }
+        }
+        for (size_t l = 0; l < Lanes; ++l) {
+            this->last_output[l] = x[l];
+            frame[l] = dry * frame[l] + wet * x[l];
+        }
+    }
+
+    inline float process_sample(float in) requires (Lanes == 1) {
+        this->process_frame(&in);
+        return in;
+    }
+
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) {
+        auto& output = context.getOutputBlock();
+        if (context.usesSeparateInputAndOutputBlocks()) {
+            output.copyFrom(context.getInputBlock());
+        }
+        if (context.isBypassed) {
+            return;
+        }
+
+        auto num_channels = std::min(output.getNumChannels(), Lanes);
+        auto num_samples = output.getNumSamples();
+        alignas(16) std::array<float, Lanes> frame {};
+        for (size_t i = 0; i < num_samples; ++i) {
+            for (size_t ch = 0; ch < num_channels; ++ch) {
+                frame[ch] = output.getChannelPointer(ch)[i];
+            }
+            this->process_frame(frame.data());
+            for (size_t ch = 0; ch < num_channels; ++ch) {
+                output.getChannelPointer(ch)[i] = frame[ch];
+            }
+        }
+    }
+
+private:
+    void update_coefficients() {
+        this->update_countdown = UPDATE_INTERVAL;
+        const auto& sine = lfo::SineTable::get();
+        const auto log_range = std::log2(this->max_frequency / MIN_FREQUENCY);
+        for (size_t l = 0; l < Lanes; ++l) {
+            this->lfo_phase[l] = lfo::wrap(this->lfo_phase[l] + this->lfo_increment);
+            auto position = std::clamp(this->params.centre + 0.5f * this->params.depth * sine(this->lfo_phase[l]), 0.0f, 1.0f);
+            auto frequency = MIN_FREQUENCY * fastmath::exp2(position * log_range);
+            auto w = std::tan(juce::MathConstants<float>::pi * frequency / static_cast<float>(this->sample_rate));
+            this->coeff[l] = (w - 1.0f) / (w + 1.0f);
+        }
+    }
+
+    Parameters params;
+    double sample_rate { 44100.0 };
+    float max_frequency { MAX_FREQUENCY };
+    float lfo_increment { 0.0f };   ///< Cycles per UPDATE_INTERVAL
+    float phase_offset { 0.0f };
+    int update_countdown { 0 };
+
+    alignas(16) std::array<float, Lanes> lfo_phase {};
+    alignas(16) std::array<float, Lanes> coeff {};
+    alignas(16) std::array<float, Lanes> last_output {};
+    std::array<std::array<float, Lanes>, MAX_STAGES> state {};
+};
+
+using StereoPhaser = Phaser<2>;
+using MonoPhaser = Phaser<1>;
+
+} // namespace jnickg::audio::ws
@@ -18,13 +18,45 @@ PluginEditor::PluginEditor (PluginProcessor& p)
         inspector->setVisible (true);
     };
 
+    addAndMakeVisible (resetProfileButton);
+    resetProfileButton.onClick = [&] { processorRef.get_profiler().reset(); };
+
+    // Traces go to the user's documents folder, for loading into ui.perfetto.dev
+    addAndMakeVisible (traceButton);
+    traceButton.onClick = [&] {
+        if (!processorRef.is_tracing())
+        {
+            processorRef.start_trace();
+            traceButton.setButtonText ("Save trace");
+            return;
+        }
+        processorRef.stop_trace();
+        auto file = juce::File::getSpecialLocation (juce::File::userDocumentsDirectory)
+                        .getNonexistentChildFile ("WabiSonorance-trace-" + juce::Time::getCurrentTime().formatted ("%Y%m%d-%H%M%S"), ".json");
+        processorRef.save_trace (file);
+        traceButton.setButtonText ("Record trace");
+    };
+
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 300);
+    setSize (400, 420);
+
+    // Only time processBlock while there's someone to show the timings to
+    processorRef.get_profiler().set_enabled (true);
+
+    // Refresh the timings a few times a second
+    startTimerHz (4);
 }
 
 PluginEditor::~PluginEditor()
 {
+    stopTimer();
+    processorRef.get_profiler().set_enabled (false);
+}
+
+void PluginEditor::timerCallback()
+{
+    repaint();
 }
 
 void PluginEditor::paint (juce::Graphics& g)
@@ -36,13 +68,69 @@ void PluginEditor::paint (juce::Graphics& g)
     g.setColour (juce::Colours::white);
     g.setFont (16.0f);
     auto helloWorld = juce::String ("Hello from ") + PRODUCT_NAME_WITHOUT_VERSION + " v" VERSION + " running in " + CMAKE_BUILD_TYPE;
-    g.drawText (helloWorld, area.removeFromTop (150), juce::Justification::centred, false);
+    g.drawText (helloWorld, area.removeFromTop (50), juce::Justification::centred, false);
+
+    area.removeFromBottom (50);
+    paintProfile (g, area.reduced (10, 0));
+}
+
+void PluginEditor::paintProfile (juce::Graphics& g, juce::Rectangle<int> area)
+{
+    using jnickg::audio::ws::Stage;
+    auto profile = processorRef.get_profiler().get_snapshot();
+
+    g.setFont (juce::Font (juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain));
+    auto line = [&] (const juce::String& text) {
+        g.drawText (text, area.removeFromTop (16), juce::Justification::centredLeft, false);
+    };
+
+    line (juce::String::formatted ("Callback  %8.1f us mean %8.1f us max", profile.callback.mean_us, profile.callback.max_us));
+    line (juce::String::formatted ("Load      %7.1f %% mean  %7.1f %% max", 100.0 * profile.mean_load, 100.0 * profile.max_load));
+    line (juce::String::formatted ("Blocks %llu, near misses %llu, overruns %llu",
+                                   static_cast<unsigned long long> (profile.blocks),
+                                   static_cast<unsigned long long> (profile.near_misses),
+                                   static_cast<unsigned long long> (profile.overruns)));
+    line (juce::String::formatted ("Voices %d sounding of %d, ceiling %d, %llu shed",
+                                   static_cast<int> (processorRef.get_sounding_voices()),
+                                   static_cast<int> (processorRef.get_max_voices()),
+                                   static_cast<int> (processorRef.get_voice_ceiling()),
+                                   static_cast<unsigned long long> (processorRef.get_voices_shed())));
+    area.removeFromTop (6);
+
+    for (auto i = static_cast<int> (Stage::__FIRST); i < static_cast<int> (Stage::__COUNT); ++i)
+    {
+        auto stage = static_cast<Stage> (i);
+        const auto& t = profile.stage (stage);
+        line (juce::String::formatted ("%-8s %8.1f us mean %8.1f us max", to_string (stage).c_str(), t.mean_us, t.max_us));
+    }
+    area.removeFromTop (6);
+
+    // Histogram of callback load, one bar per bin, with the deadline at the right edge
+    auto histogram_area = area.removeFromTop (60);
+    auto max_count = std::max<uint64_t> (1, *std::max_element (profile.histogram.begin(), profile.histogram.end()));
+    auto bar_width = static_cast<float> (histogram_area.getWidth()) / static_cast<float> (profile.histogram.size());
+    for (size_t i = 0; i < profile.histogram.size(); ++i)
+    {
+        auto height = static_cast<float> (histogram_area.getHeight()) * static_cast<float> (profile.histogram[i]) / static_cast<float> (max_count);
+        auto load = static_cast<double> (i) / static_cast<double> (jnickg::audio::ws::Profiler::NUM_BINS);
+        g.setColour (load >= 1.0 ? juce::Colours::red
+                     : load >= jnickg::audio::ws::Profiler::NEAR_MISS_FRACTION ? juce::Colours::orange
+                                                                               : juce::Colours::lightgreen);
+        g.fillRect (static_cast<float> (histogram_area.getX()) + bar_width * static_cast<float> (i),
+                    static_cast<float> (histogram_area.getBottom()) - height,
+                    bar_width - 1.0f,
+                    height);
+    }
+    g.setColour (juce::Colours::white);
 }
 
 void PluginEditor::resized()
 {
     // layout the positions of your child components here
     auto area = getLocalBounds();
-    area.removeFromBottom(50);
-    inspectButton.setBounds (getLocalBounds().withSizeKeepingCentre(100, 50));
+    auto buttons = area.removeFromBottom (50).reduced (10);
+    auto button_width = buttons.getWidth() / 3;
+    inspectButton.setBounds (buttons.removeFromLeft (button_width).reduced (5, 0));
+    resetProfileButton.setBounds (buttons.removeFromLeft (button_width).reduced (5, 0));
+    traceButton.setBounds (buttons.reduced (5, 0));
 }
@@ -5,7 +5,7 @@
 #include "melatonin_inspector/melatonin_inspector.h"
 
 //==============================================================================
-class PluginEditor : public juce::AudioProcessorEditor
+class PluginEditor : public juce::AudioProcessorEditor, private juce::Timer
 {
 public:
     explicit PluginEditor (PluginProcessor&);
@@ -21,5 +21,11 @@ private:
     PluginProcessor& processorRef;
     std::unique_ptr<melatonin::Inspector> inspector;
     juce::TextButton inspectButton { "Inspect the UI" };
+    juce::TextButton resetProfileButton { "Reset timings" };
+    juce::TextButton traceButton { "Record trace" };
+
+    void timerCallback() override;
+    void paintProfile (juce::Graphics&, juce::Rectangle<int> area);
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginEditor)
 };
@@ -1,5 +1,6 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "FastMath.hpp"
 #include "NotesKeys.hpp"
 
 #include <juce_dsp/juce_dsp.h>
@@ -17,9 +18,13 @@ PluginProcessor::PluginProcessor()
                      #endif
                        )
 {
-    printf("Synth initialized in key: %s\n", key.to_string(true).c_str());
-    for (size_t i = 0; i < NUM_VOICES; i++) {
-        auto* v = synth.addVoice(new jnickg::audio::ws::Voice(key));
+    printf("Synth initialized in key: %s\n", keys.get_key().to_string(true).c_str());
+    profiler.set_tracer(&tracer);
+    // The audio thread isn't running yet, so this one can stand in as the reader
+    key_tables = &keys.read();
+    // All of them, so polyphony can change without allocating
+    for (size_t i = 0; i < MAX_VOICES; i++) {
+        auto* v = synth.addVoice(new jnickg::audio::ws::Voice(key_tables->chords, echo, chord_log, voice_pool, mpe, static_cast<int>(i)));
         if (v == nullptr) {
             throw std::runtime_error("Failed to add voice to synth");
         }
@@ -29,11 +34,30 @@ PluginProcessor::PluginProcessor()
         throw std::runtime_error("Failed to add sound to synth");
     }
 
+    juce::StringArray roots;
+    for (int n = static_cast<int>(jnickg::audio::note::__FIRST); n < static_cast<int>(jnickg::audio::note::__COUNT); ++n) {
+        roots.add(jnickg::audio::to_string(static_cast<jnickg::audio::note>(n)));
+    }
+    juce::StringArray scales;
+    for (int c = static_cast<int>(jnickg::audio::scale::__FIRST); c < static_cast<int>(jnickg::audio::scale::__COUNT); ++c) {
+        scales.add(jnickg::audio::to_string(static_cast<jnickg::audio::scale>(c)));
+    }
+    automated_root = static_cast<int>(DEFAULT_KEY.root);
+    automated_scale = static_cast<int>(DEFAULT_KEY.scale_type);
+    key_root_parameter = new juce::AudioParameterChoice(juce::ParameterID { "key_root", 1 }, "Key", roots, automated_root);
+    key_scale_parameter = new juce::AudioParameterChoice(juce::ParameterID { "key_scale", 1 }, "Scale", scales, automated_scale);
+    addParameter(key_root_parameter);
+    addParameter(key_scale_parameter);
+
     jnickg::audio::init_chords();
+    chord_log.start();
+    keys.start();
 }
 
 PluginProcessor::~PluginProcessor()
 {
+    keys.stop();
+    chord_log.stop();
 }
 
 //==============================================================================
@@ -71,7 +95,14 @@ bool PluginProcessor::isMidiEffect() const
 
 double PluginProcessor::getTailLengthSeconds() const
 {
-    return jnickg::audio::ws::Voice::DEFAULT_RELEASE;
+    return jnickg::audio::ws::Voice::DEFAULT_RELEASE + this->get_reverb_tail_seconds();
+}
+
+double PluginProcessor::get_reverb_tail_seconds() const
+{
+    return this->reverb_mode.load() == ReverbMode::Convolution
+        ? this->impulse_response_seconds.load()
+        : this->reverb.get_tail_length_seconds();
 }
 
 int PluginProcessor::getNumPrograms()
@@ -110,16 +141,29 @@ void PluginProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
     this->spec.numChannels = static_cast<juce::uint32>(outputChannels);
 
     this->synth.setCurrentPlaybackSampleRate(sampleRate);
+    // Echoes are scheduled from note-ons, so those need to land on the exact sample
+    this->synth.setMinimumRenderingSubdivisionSize(1, true);
 
-    float bpm = 120.0f; // TODO parameterize... and actually use this
+    this->voice_pool.prepare(sampleRate);
+    this->voice_settings.reset();
+    this->midi_quantizer.prepare(MIDI_QUANTIZER_BYTES);
+    this->mpe.reset();
 
     for (auto i = 0; i < this->synth.getNumVoices(); ++i) {
         auto* voice = dynamic_cast<jnickg::audio::ws::Voice*>(this->synth.getVoice(i));
         if (voice != nullptr) {
-            voice->prepareToPlay(sampleRate, samplesPerBlock, outputChannels, bpm);
+            voice->prepareToPlay(sampleRate, samplesPerBlock, outputChannels);
+            voice->set_seed(this->seed + i);
+            // Spread the per-voice phasers' LFOs, so overlapping chords move against each other. Steps
+            // of the golden ratio never repeat, and spread the first voices evenly whatever the polyphony.
+            voice->set_phaser_phase_offset(jnickg::audio::ws::lfo::wrap(static_cast<float>(i) * GOLDEN_RATIO_CONJUGATE));
         }
     }
 
+    this->cpu_budget.reset();
+
+    this->echo.prepare(sampleRate, this->key_tables->key);
+
     auto sample_rate = this->spec.sampleRate;
     auto lfo_frequency = this->amplitude_modulation_lfo_frequency;
     auto lfo_period = 1.0 / lfo_frequency;
@@ -128,27 +172,39 @@ void PluginProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
     amplitude_modulation_lfo.resize(lfo_samples);
     // printf("lfo_samples: %zu\n\tvalues: ", lfo_samples);
     for (size_t i = 0; i < lfo_samples; i++) {
-        amplitude_modulation_lfo[i] = static_cast<float>(std::sin(2.0 * M_PI * lfo_frequency * static_cast<double>(i) / sample_rate));
+        amplitude_modulation_lfo[i] = jnickg::audio::ws::fastmath::sin(static_cast<float>(2.0 * M_PI * lfo_frequency * static_cast<double>(i) / sample_rate));
         // printf("%f ", amplitude_modulation_lfo[i]);
     }
     // printf("\n");
 
-    this->phaser.setRate(0.5f); // TODO parameterize
-    this->phaser.setDepth(0.7f); // TODO parameterize
-    this->phaser.setCentreFrequency(0.56f); // TODO parameterize
-    this->phaser.setFeedback(1.0f); // TODO parameterize
-    this->phaser.setMix(0.7f); // TODO parameterize
-    this->phaser.prepare(this->spec);
-
-    this->reverb_params.roomSize = 0.9f; // TODO parameterize
-    this->reverb_params.damping = 0.5f; // TODO parameterize
-    this->reverb_params.wetLevel = 0.7f; // TODO parameterize
-    this->reverb_params.dryLevel = 0.5f; // TODO parameterize
-    this->reverb_params.width = 0.5f; // TODO parameterize
-    this->reverb_params.freezeMode = false;
-    this->reverb.setParameters(this->reverb_params);
+    jnickg::audio::ws::StereoPhaser::Parameters phaser_params;
+    phaser_params.stages = 6; // TODO parameterize
+    phaser_params.rate = 0.5f; // TODO parameterize
+    phaser_params.depth = 0.7f; // TODO parameterize
+    phaser_params.centre = 0.56f; // TODO parameterize
+    phaser_params.feedback = 0.7f; // TODO parameterize
+    phaser_params.mix = 0.7f; // TODO parameterize
+    this->phaser.set_parameters(phaser_params);
+    this->phaser.prepare(sampleRate);
+    this->phaser_gate.prepare(sampleRate, PHASER_MAX_TAIL_SECONDS);
+
+    jnickg::audio::ws::FdnReverb::Parameters reverb_params;
+    reverb_params.decay_seconds = 5.0f; // TODO parameterize
+    reverb_params.damping = 0.5f; // TODO parameterize
+    reverb_params.wet_level = 0.7f; // TODO parameterize
+    reverb_params.dry_level = 0.5f; // TODO parameterize
+    reverb_params.width = 0.5f; // TODO parameterize
+    reverb_params.quality = this->reverb_quality.load();
+    this->reverb.set_parameters(reverb_params);
     this->reverb.prepare(this->spec);
-    this->reverb.reset();
+
+    // juce::dsp::Convolution outputs only the wet signal, so blend the dry one back in
+    this->convolution.prepare(this->spec);
+    this->convolution_mix.prepare(this->spec);
+    this->convolution_mix.setMixingRule(juce::dsp::DryWetMixingRule::balanced);
+    this->convolution_mix.setWetMixProportion(0.6f); // TODO parameterize
+
+    this->reverb_gate.prepare(sampleRate, 2.0 * this->get_reverb_tail_seconds());
 }
 
 void PluginProcessor::releaseResources()
@@ -182,9 +238,12 @@ bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer,
                                               juce::MidiBuffer& midiMessages)
 {
-    juce::ignoreUnused (midiMessages); // TODO: use midiMessages to get notes
-
-    juce::ScopedNoDenormals noDenormals;
+    std::optional<juce::ScopedNoDenormals> noDenormals;
+    if (this->flush_denormals.load()) {
+        noDenormals.emplace();
+    }
+    jnickg::audio::ws::Profiler::ScopedBlock profile(this->profiler, buffer.getNumSamples(), this->spec.sampleRate);
+    jnickg::audio::ws::CpuBudget::ScopedBlock budget(this->cpu_budget, buffer.getNumSamples(), this->spec.sampleRate);
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -192,19 +251,79 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer,
         buffer.clear (i, 0, buffer.getNumSamples());
     }
 
-    // Update all voices with the current parameters
-    for (auto i = 0; i < this->synth.getNumVoices(); ++i) {
-        auto* voice = dynamic_cast<jnickg::audio::ws::Voice*>(this->synth.getVoice(i));
-        if (voice != nullptr) {
-            // Oscillator controlls
-            // ADSR
-            // LFO
-            // Filter
-            // Gain
+    // Follow key automation. The new key's tables are built in the background, and picked up
+    // below in a later block
+    auto root_index = this->key_root_parameter->getIndex();
+    auto scale_index = this->key_scale_parameter->getIndex();
+    if (root_index != this->automated_root || scale_index != this->automated_scale) {
+        this->automated_root = root_index;
+        this->automated_scale = scale_index;
+        this->keys.request_key({
+            .root = static_cast<jnickg::audio::note>(root_index),
+            .scale_type = static_cast<jnickg::audio::scale>(scale_index),
+        });
+    }
+    const auto& tables = this->keys.read();
+    if (&tables != this->key_tables) {
+        this->key_tables = &tables;
+        this->echo.set_scale(tables.scale);
+    }
+
+    this->update_tempo();
+    auto strum_seconds = this->strum_tempo_synced.load()
+        ? this->strum_spacing.load() * 60.0 / this->bpm
+        : this->strum_spacing.load() / 1000.0;
+    auto strum_samples = static_cast<int>(std::lround(std::clamp(strum_seconds, 0.0, MAX_STRUM_SECONDS) * this->spec.sampleRate));
+    auto strum_order = this->strum_order.load();
+
+    // Nothing playing, nothing due and every tail decayed: the block is silence
+    if (midiMessages.isEmpty() && this->is_idle()) {
+        buffer.clear();
+        return;
+    }
+
+    // Update all voices with the current parameters, when they change
+    auto settings = VoiceSettings {
+        .chords = &tables.chords,
+        .phaser_enabled = this->phaser_mode.load() == PhaserMode::PerVoice,
+        .oscillator_type = this->oscillator_type.load(),
+        .max_chord_tones = this->max_chord_tones.load(),
+        .chord_trace = this->chord_trace.load(),
+        .strum_samples = strum_samples,
+        .strum_order = strum_order,
+    };
+    if (settings != this->voice_settings) {
+        this->voice_settings = settings;
+        for (auto i = 0; i < this->synth.getNumVoices(); ++i) {
+            auto* voice = dynamic_cast<jnickg::audio::ws::Voice*>(this->synth.getVoice(i));
+            if (voice != nullptr) {
+                voice->set_chords(*settings.chords);
+                voice->set_phaser_enabled(settings.phaser_enabled);
+                voice->set_oscillator_type(settings.oscillator_type);
+                voice->set_max_chord_tones(settings.max_chord_tones);
+                voice->set_chord_trace_enabled(settings.chord_trace);
+                voice->set_strum(settings.strum_samples, settings.strum_order);
+            }
         }
     }
 
-    this->synth.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
+    // Shed voices before rendering, if the last block ran close to its deadline
+    auto max_voices = this->max_voices.load();
+    auto sounding = this->synth.count_sounding_voices(max_voices);
+    auto ceiling = this->cpu_budget.get_voice_ceiling(sounding, max_voices);
+    this->synth.set_voice_limits(max_voices, ceiling);
+    this->sounding_voices.store(sounding, std::memory_order_relaxed);
+    this->voice_ceiling.store(ceiling, std::memory_order_relaxed);
+    this->voice_pool.set_partial_sharing(this->partial_sharing.load(std::memory_order_relaxed));
+    this->mpe.set_enabled(this->mpe_enabled.load());
+    this->mpe.set_note_bend_range(this->mpe_bend_range.load());
+
+    const auto& midi = this->midi_quantizer.process(midiMessages, tables.quantizer, this->quantizer_mode.load(), this->scale_degree_mapping.load());
+    this->synth.renderNextBlock(buffer, midi, 0, buffer.getNumSamples());
+    {
+        jnickg::audio::ws::Profiler::ScopedStage stage(this->profiler, jnickg::audio::ws::Stage::echo);
+        this->echo.render(buffer, 0, buffer.getNumSamples());
+    }
 
     // Apple post FX
     juce::dsp::AudioBlock<float> block(buffer);
@@ -223,10 +342,141 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     //     }
     // }
 
-    // Apply phaser
-    this->phaser.process(juce::dsp::ProcessContextReplacing<float>(block));
+    // Each FX stage is skipped once its input is silent and its tail has decayed, so idle instances
+    // cost next to nothing. See SilenceGate.
+
+    // Apply phaser (unless the voices already did)
+    if (this->phaser_mode.load() == PhaserMode::Global) {
+        jnickg::audio::ws::Profiler::ScopedStage stage(this->profiler, jnickg::audio::ws::Stage::phaser);
+        if (this->phaser_gate.should_process(block)) {
+            if (this->phaser_gate.is_waking()) {
+                this->phaser.reset();
+            }
+            this->phaser.process(juce::dsp::ProcessContextReplacing<float>(block));
+            this->phaser_gate.observe_output(block);
+        }
+    }
+
     // Apply reverb
-    this->reverb.process(juce::dsp::ProcessContextReplacing<float>(block));
+    jnickg::audio::ws::Profiler::ScopedStage reverb_stage(this->profiler, jnickg::audio::ws::Stage::reverb);
+    auto mode = this->reverb_mode.load();
+    if (mode != this->active_reverb_mode) {
+        // Don't let a stale tail from the last time this engine was active bleed back in
+        if (mode == ReverbMode::Convolution) {
+            this->convolution.reset();
+            this->convolution_mix.reset();
+        } else {
+            this->reverb.reset();
+        }
+        this->active_reverb_mode = mode;
+        this->reverb_gate.reset();
+    }
+
+    // RT60 is relative to the signal level, but the gate's threshold is absolute, so allow for the
+    // tail taking longer than that to reach it. The IR length can also change as IRs load.
+    this->reverb_gate.set_tail_seconds(2.0 * this->get_reverb_tail_seconds());
+
+    if (this->reverb_gate.should_process(block)) {
+        // What the engine held when it went idle, and the history it didn't see, would come back
+        auto waking = this->reverb_gate.is_waking();
+        if (mode == ReverbMode::Convolution) {
+            if (waking) {
+                this->convolution.reset();
+                this->convolution_mix.reset();
+            }
+            this->convolution_mix.pushDrySamples(block);
+            this->convolution.process(juce::dsp::ProcessContextReplacing<float>(block));
+            this->convolution_mix.mixWetSamples(block);
+        } else {
+            if (waking) {
+                this->reverb.reset();
+            }
+            auto quality = this->reverb_quality.load();
+            if (quality != this->reverb.get_parameters().quality) {
+                auto reverb_params = this->reverb.get_parameters();
+                reverb_params.quality = quality;
+                this->reverb.set_parameters(reverb_params);
+            }
+            this->reverb.process(juce::dsp::ProcessContextReplacing<float>(block));
+        }
+        this->reverb_gate.observe_output(block);
+    }
+}
+
+bool PluginProcessor::is_idle() const
+{
+    if (!this->echo.is_idle() || this->synth.is_sounding()) {
+        return false;
+    }
+    if (this->phaser_mode.load() == PhaserMode::Global && !this->phaser_gate.is_idle()) {
+        return false;
+    }
+    return this->reverb_mode.load() == this->active_reverb_mode && this->reverb_gate.is_idle();
+}
+
+void PluginProcessor::set_key(const jnickg::audio::key_info& k)
+{
+    // Parameters first: if processBlock sees them move, it asks for the key being built here
+    *this->key_root_parameter = static_cast<int>(k.root);
+    *this->key_scale_parameter = static_cast<int>(k.scale_type);
+    this->keys.set_key(k);
+}
+
+void PluginProcessor::set_reverb_mode(ReverbMode m)
+{
+    // Built on first use: synthesizing the IR costs every instance that never convolves
+    if (m == ReverbMode::Convolution && !this->impulse_response_requested.load()) {
+        this->load_impulse_response(jnickg::audio::ws::ir::Space::temple_hall);
+    }
+    this->reverb_mode.store(m);
+}
+
+void PluginProcessor::load_impulse_response(const juce::File& file)
+{
+    this->impulse_response_requested.store(true);
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    if (auto reader = std::unique_ptr<juce::AudioFormatReader>(formats.createReaderFor(file))) {
+        this->impulse_response_seconds.store(static_cast<double>(reader->lengthInSamples) / reader->sampleRate);
+    }
+    // juce::dsp::Convolution reads, resamples and partitions the file on its own background thread
+    this->convolution.loadImpulseResponse(file,
+                                          juce::dsp::Convolution::Stereo::yes,
+                                          juce::dsp::Convolution::Trim::yes,
+                                          0,
+                                          juce::dsp::Convolution::Normalise::yes);
+}
+
+void PluginProcessor::load_impulse_response(jnickg::audio::ws::ir::Space space)
+{
+    this->impulse_response_requested.store(true);
+    auto sample_rate = this->spec.sampleRate > 0.0 ? this->spec.sampleRate : 48000.0;
+    this->impulse_response_loader.addJob([this, space, sample_rate]() {
+        auto buffer = jnickg::audio::ws::ir::generate(space, sample_rate);
+        this->impulse_response_seconds.store(jnickg::audio::ws::ir::get_length_seconds(space));
+        this->convolution.loadImpulseResponse(std::move(buffer),
+                                              sample_rate,
+                                              juce::dsp::Convolution::Stereo::yes,
+                                              juce::dsp::Convolution::Trim::no,
+                                              juce::dsp::Convolution::Normalise::yes);
+    });
+}
+
+void PluginProcessor::update_tempo()
+{
+    // Not every host provides a tempo (e.g. the standalone app); keep the last known one if so
+    auto* play_head = this->getPlayHead();
+    if (play_head == nullptr) {
+        return;
+    }
+    auto position = play_head->getPosition();
+    if (!position.hasValue()) {
+        return;
+    }
+    if (auto host_bpm = position->getBpm(); host_bpm && *host_bpm > 0.0) {
+        this->bpm = *host_bpm;
+        this->echo.set_bpm(*host_bpm);
+    }
 }
 
 //==============================================================================
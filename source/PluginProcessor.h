@@ -3,10 +3,27 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_dsp/juce_dsp.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <unordered_map>
 #include <memory>
+#include <optional>
 
+#include "ChordLog.hpp"
+#include "ChordTable.hpp"
+#include "CpuBudget.hpp"
+#include "EchoEngine.hpp"
+#include "FdnReverb.hpp"
+#include "ImpulseResponses.hpp"
+#include "KeySwitcher.hpp"
+#include "Mpe.hpp"
+#include "Phaser.hpp"
+#include "Profiler.hpp"
+#include "ScaleQuantizer.hpp"
+#include "SilenceGate.hpp"
+#include "Tracer.hpp"
+#include "VoicePool.hpp"
 #include "WabiSonoranceSynth.hpp"
 #include "NotesKeys.hpp"
 
@@ -46,20 +63,308 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-private:
-    juce::dsp::ProcessSpec spec;
-    juce::dsp::Phaser<float> phaser;
-    juce::dsp::Reverb::Parameters reverb_params;
-    juce::dsp::Reverb reverb;
-    juce::Synthesiser synth;
+    /**
+     * @brief Selects the reverb's CPU/quality tier. Safe to call from any thread; applied on the
+     * next processBlock.
+     */
+    void set_reverb_quality(jnickg::audio::ws::FdnReverb::Quality q) { this->reverb_quality.store(q); }
+    jnickg::audio::ws::FdnReverb::Quality get_reverb_quality() const { return this->reverb_quality.load(); }
+
+    enum class ReverbMode
+    {
+        Fdn,            ///< Algorithmic; see FdnReverb
+        Convolution,    ///< Convolution with the current impulse response
+    };
+
+    /**
+     * @brief Selects the reverb engine. Safe to call from any thread but the audio thread; applied
+     * on the next processBlock. The first time convolution is selected without an impulse response
+     * loaded, the built-in temple hall is synthesized for it in the background.
+     */
+    void set_reverb_mode(ReverbMode m);
+    ReverbMode get_reverb_mode() const { return this->reverb_mode.load(); }
+
+    /**
+     * @brief Loads an impulse response for the convolution reverb from disk.
+     *
+     * Loading, resampling and partitioning happen on a background thread, and the new IR is swapped
+     * in without locking the audio thread. Until then the previous IR keeps playing.
+     */
+    void load_impulse_response(const juce::File& file);
+
+    /**
+     * @brief Synthesizes (on a background thread) and loads the impulse response of a built-in space.
+     */
+    void load_impulse_response(jnickg::audio::ws::ir::Space space);
 
-    jnickg::audio::key_info key {
+    /**
+     * @brief Whether an impulse response has been loaded, or is loading. None is until convolution
+     * is first selected, so instances that only use the FDN reverb never pay for one.
+     */
+    bool has_impulse_response() const { return this->impulse_response_requested.load(); }
+
+    /**
+     * @brief Whether the post-FX chain was skipped on the last block because the instance is idle.
+     */
+    bool is_fx_idle() const { return this->phaser_gate.is_idle() && this->reverb_gate.is_idle(); }
+
+    enum class PhaserMode
+    {
+        Global,     ///< One stereo phaser on the mixed output
+        PerVoice,   ///< A cheap mono phaser in each voice, with its LFO offset from the others
+    };
+
+    /**
+     * @brief Selects where the phaser runs. Safe to call from any thread; applied on the next processBlock.
+     */
+    void set_phaser_mode(PhaserMode m) { this->phaser_mode.store(m); }
+    PhaserMode get_phaser_mode() const { return this->phaser_mode.load(); }
+
+    static inline constexpr jnickg::audio::key_info DEFAULT_KEY {
         .root = jnickg::audio::note::A,
         .scale_type = jnickg::audio::scale::yonanuki,
     };
+
+    /**
+     * @brief Sets the key the voices pick chords (and echoes pick notes) in, and the key parameters
+     * to match. Builds the key's tables on the calling thread, so not real-time safe; the audio
+     * thread switches to them on the next processBlock. Notes already playing keep their chord.
+     *
+     * Automating the key parameters switches key too, with the tables built in the background.
+     */
+    void set_key(const jnickg::audio::key_info& k);
+    jnickg::audio::key_info get_key() const { return this->keys.get_key(); }
+
+    /**
+     * @brief Snaps incoming notes into the current key (see ScaleQuantizer), before the voices
+     * pick chords for them. Off by default. Safe to call from any thread; takes effect on the next
+     * processBlock, and notes already held are released as they were played.
+     */
+    void set_scale_quantizer(jnickg::audio::ws::ScaleQuantizer::Mode m) { this->quantizer_mode.store(m); }
+    jnickg::audio::ws::ScaleQuantizer::Mode get_scale_quantizer() const { return this->quantizer_mode.load(); }
+
+    /**
+     * @brief Has the white keys play the key's scale degrees in order, with middle C on the root.
+     * Only while the scale quantizer is on. Safe to call from any thread.
+     */
+    void set_scale_degree_mapping(bool enabled) { this->scale_degree_mapping.store(enabled); }
+    bool get_scale_degree_mapping() const { return this->scale_degree_mapping.load(); }
+
+    static inline constexpr double MAX_STRUM_SECONDS = 1.0;  ///< Between two tones' onsets
+
+    /**
+     * @brief Strums chords: each tone starts spacing after the last, in the given order, to the
+     * sample. The spacing is in beats of the host tempo if tempo_synced, else in milliseconds; 0,
+     * the default, starts the tones together. Safe to call from any thread; applies to notes
+     * starting from the next processBlock.
+     */
+    void set_strum(double spacing, bool tempo_synced, jnickg::audio::ws::StrumOrder order) {
+        this->strum_spacing.store(spacing);
+        this->strum_tempo_synced.store(tempo_synced);
+        this->strum_order.store(order);
+    }
+
+    /**
+     * @brief Plays MPE (lower zone): each note's chord follows its own channel's pitch bend, over
+     * note_bend_range semitones, pressure (its gain) and timbre, CC74 (its filter cutoff). The
+     * master channel, 1, bends every note by up to 2 semitones. Off by default, when the pitch
+     * wheel bends the notes on its channel. Safe to call from any thread; takes effect on the next
+     * processBlock.
+     */
+    void set_mpe(bool enabled, float note_bend_range = jnickg::audio::ws::MpeZone::DEFAULT_NOTE_BEND_RANGE) {
+        this->mpe_bend_range.store(note_bend_range);
+        this->mpe_enabled.store(enabled);
+    }
+    bool is_mpe_enabled() const { return this->mpe_enabled.load(); }
+
+    /**
+     * @brief Seeds the voices' chord choices, so the same MIDI renders the same audio. Takes effect
+     * at the next prepareToPlay.
+     */
+    void set_seed(juce::int64 s) { this->seed = s; }
+
+    /**
+     * @brief Selects the voices' oscillator waveform. Safe to call from any thread.
+     */
+    void set_oscillator_type(jnickg::audio::ws::Voice::OscillatorType t) { this->oscillator_type.store(t); }
+
+    /**
+     * @brief Limits each note's chord to at most n tones (1-5). Safe to call from any thread.
+     */
+    void set_max_chord_tones(size_t n) { this->max_chord_tones.store(n); }
+
+    /**
+     * @brief Logs every chord the voices pick (see ChordLog). Safe to call from any thread.
+     */
+    void set_chord_trace_enabled(bool enabled) { this->chord_trace.store(enabled); }
+
+    /**
+     * @brief Whether processBlock flushes denormals to zero (the default). Safe to call from any thread.
+     *
+     * Only the soak test turns this off, to check that the feedback paths decay to zero on their own.
+     */
+    void set_flush_denormals(bool enabled) { this->flush_denormals.store(enabled); }
+
+    /**
+     * @brief Sends the chord trace to a file instead of stdout. Pass juce::File() for stdout.
+     */
+    void set_chord_trace_file(const juce::File& file) { this->chord_log.set_output_file(file); }
+
+    /**
+     * @brief Writes out all chord trace records queued so far.
+     */
+    void flush_chord_trace() { this->chord_log.flush(); }
+
+    /**
+     * @brief Timings of processBlock, per stage and per voice. Off unless enabled (the editor does,
+     * while it's open). Snapshots can be taken, and the profiler reset or toggled, from any thread.
+     */
+    jnickg::audio::ws::Profiler& get_profiler() { return this->profiler; }
+    const jnickg::audio::ws::Profiler& get_profiler() const { return this->profiler; }
+
+    /**
+     * @brief Starts recording a timeline of processBlock, its stages, note-ons/offs and each voice's
+     * rendering. Not real-time safe: the first call allocates the trace buffers.
+     */
+    void start_trace() { this->tracer.start(); }
+    void stop_trace() { this->tracer.stop(); }
+    bool is_tracing() const { return this->tracer.is_recording(); }
+
+    /**
+     * @brief Writes the last trace as Chrome Trace JSON, for chrome://tracing or ui.perfetto.dev.
+     * Call after stop_trace(), off the audio thread.
+     */
+    bool save_trace(const juce::File& file) const { return this->tracer.save_chrome_json(file); }
+
+    static inline constexpr size_t MAX_VOICES = jnickg::audio::ws::VoicePool::MAX_VOICES;
+    static inline constexpr size_t DEFAULT_VOICES = 16;
+    static inline constexpr float GOLDEN_RATIO_CONJUGATE = 0.618034f;   ///< Spreads the voices' phaser LFOs
+
+    /**
+     * @brief Head partition size of the convolution reverb, in samples.
+     *
+     * Small head partitions keep most blocks cheap at 64-sample buffers, but juce::dsp::Convolution
+     * computes the larger tail partitions inside process() too, on the audio thread, on each block
+     * where one of them fills up. Those blocks cost several times the mean; ReverbBenchmarks.cpp
+     * reports the worst one. Moving the tail to a worker thread, a block ahead, would flatten them.
+     */
+    static inline constexpr int CONVOLUTION_HEAD_SIZE = 64;
+
+    /**
+     * @brief Sets the polyphony, up to MAX_VOICES. Safe to call from any thread; voices over the new
+     * limit fade out on the next processBlock. Nothing is allocated: all voices exist up front.
+     */
+    void set_max_voices(size_t n) { this->max_voices.store(std::clamp<size_t>(n, 1, MAX_VOICES)); }
+    size_t get_max_voices() const { return this->max_voices.load(); }
+
+    /**
+     * @brief Caps processBlock at this share of its deadline (e.g. 0.7) by shedding the least audible
+     * voices when it runs close, rather than glitching. 0, the default, turns the cap off. Safe to
+     * call from any thread.
+     */
+    void set_cpu_budget(double fraction) { this->cpu_budget.set_budget(fraction); }
+    double get_cpu_budget() const { return this->cpu_budget.get_budget(); }
+
+    /**
+     * @brief Renders tones that several voices hold at the same pitch once, instead of once per
+     * voice. Notes starting on a pitch that's already sounding join it in phase rather than gliding
+     * to it. Off by default. Safe to call from any thread; takes effect on the next processBlock.
+     */
+    void set_partial_sharing(bool enabled) { this->partial_sharing.store(enabled); }
+    bool get_partial_sharing() const { return this->partial_sharing.load(); }
+
+    /**
+     * @brief Voices sounding in the last block, how many the CPU budget allowed, and how many have
+     * been shed to stay within the limits. Safe to read from any thread.
+     */
+    size_t get_sounding_voices() const { return this->sounding_voices.load(std::memory_order_relaxed); }
+    size_t get_voice_ceiling() const { return this->voice_ceiling.load(std::memory_order_relaxed); }
+    uint64_t get_voices_shed() const { return this->synth.get_voices_shed(); }
+
+private:
+    juce::dsp::ProcessSpec spec {};
+    jnickg::audio::ws::StereoPhaser phaser;
+    std::atomic<PhaserMode> phaser_mode { PhaserMode::Global };
+    jnickg::audio::ws::SilenceGate phaser_gate;
+    static inline constexpr double PHASER_MAX_TAIL_SECONDS = 2.0;
+    jnickg::audio::ws::FdnReverb reverb;
+    std::atomic<jnickg::audio::ws::FdnReverb::Quality> reverb_quality { jnickg::audio::ws::FdnReverb::Quality::Standard };
+
+    juce::dsp::Convolution convolution { juce::dsp::Convolution::NonUniform { CONVOLUTION_HEAD_SIZE } };
+    juce::dsp::DryWetMixer<float> convolution_mix;
+    std::atomic<ReverbMode> reverb_mode { ReverbMode::Fdn };
+    ReverbMode active_reverb_mode { ReverbMode::Fdn };
+    std::atomic<double> impulse_response_seconds { 0.0 };
+    std::atomic<bool> impulse_response_requested { false };
+    jnickg::audio::ws::SilenceGate reverb_gate;
+
+    jnickg::audio::ws::KeySwitcher keys { DEFAULT_KEY };
+    const jnickg::audio::ws::KeyTables* key_tables { nullptr };    ///< What the audio thread last read from keys
+    juce::AudioParameterChoice* key_root_parameter { nullptr };     ///< Owned by the AudioProcessor
+    juce::AudioParameterChoice* key_scale_parameter { nullptr };
+    int automated_root { -1 };  ///< Key parameter indices as of the last block
+    int automated_scale { -1 };
+    static inline constexpr int MIDI_QUANTIZER_BYTES = 4096;    ///< Quantized MIDI per block before allocating
+    jnickg::audio::ws::MidiQuantizer midi_quantizer;
+    std::atomic<jnickg::audio::ws::ScaleQuantizer::Mode> quantizer_mode { jnickg::audio::ws::ScaleQuantizer::Mode::off };
+    std::atomic<bool> scale_degree_mapping { false };
+    std::atomic<double> strum_spacing { 0.0 };
+    std::atomic<bool> strum_tempo_synced { false };
+    std::atomic<jnickg::audio::ws::StrumOrder> strum_order { jnickg::audio::ws::StrumOrder::up };
+    double bpm { 120.0 };   ///< The host's tempo, or the last one it gave
+    std::atomic<bool> mpe_enabled { false };
+    std::atomic<float> mpe_bend_range { jnickg::audio::ws::MpeZone::DEFAULT_NOTE_BEND_RANGE };
+    juce::int64 seed { 1 };
+    jnickg::audio::ws::ChordLog chord_log;
+    jnickg::audio::ws::Tracer tracer;
+    jnickg::audio::ws::Profiler profiler;
+
+    // The voices refer to everything above, so the synth is declared after it
+    jnickg::audio::ws::EchoEngine echo;
+    jnickg::audio::ws::VoicePool voice_pool;    ///< Every voice's render state, in one place
+    jnickg::audio::ws::MpeZone mpe;             ///< Each MIDI channel's expression
+    jnickg::audio::ws::Synth synth { echo, profiler, voice_pool, mpe };
+    std::atomic<size_t> max_voices { DEFAULT_VOICES };
+    jnickg::audio::ws::CpuBudget cpu_budget;
+    std::atomic<bool> partial_sharing { false };
+    std::atomic<size_t> sounding_voices { 0 };
+    std::atomic<size_t> voice_ceiling { DEFAULT_VOICES };
+
     double amplitude_modulation_lfo_frequency = 3.0;
     std::vector<float> amplitude_modulation_lfo;
-    static inline constexpr size_t NUM_VOICES = 16;
+
+    std::atomic<jnickg::audio::ws::Voice::OscillatorType> oscillator_type { jnickg::audio::ws::Voice::OscillatorType::SineWithHarmonics };
+    std::atomic<size_t> max_chord_tones { jnickg::audio::ws::Voice::MAX_CHORD_TONES };
+    std::atomic<bool> chord_trace { true };
+    std::atomic<bool> flush_denormals { true };
+
+    /**
+     * @brief The per-voice settings processBlock pushes to every voice, only when they change.
+     */
+    struct VoiceSettings {
+        const jnickg::audio::ws::ChordTable* chords { nullptr };
+        bool phaser_enabled { false };
+        jnickg::audio::ws::Voice::OscillatorType oscillator_type {};
+        size_t max_chord_tones { 0 };
+        bool chord_trace { false };
+        int strum_samples { 0 };
+        jnickg::audio::ws::StrumOrder strum_order {};
+
+        bool operator==(const VoiceSettings&) const = default;
+    };
+    std::optional<VoiceSettings> voice_settings;    ///< What the voices last got; empty after prepareToPlay
+
+    // Keep last: its destructor waits for pending IR jobs, which use the members above
+    juce::ThreadPool impulse_response_loader { 1 };
+
+    void update_tempo();
+    double get_reverb_tail_seconds() const;
+
+    /**
+     * @brief Whether nothing is left to render: no voice or echo sounding or due, and every FX
+     * stage's tail has decayed.
+     */
+    bool is_idle() const;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginProcessor)
 };
@@ -0,0 +1,114 @@
+#include "Profiler.hpp"
+
+#include <cmath>
+
+namespace jnickg::audio::ws {
+
+void Profiler::begin_block(int num_samples, double sample_rate) {
+    if (this->reset_requested.exchange(false)) {
+        this->clear();
+    }
+    this->block_enabled = this->enabled.load(std::memory_order_relaxed) && sample_rate > 0.0;
+    if (!this->block_enabled) {
+        return;
+    }
+    this->block_deadline_ns = static_cast<int64_t>(1.0e9 * static_cast<double>(num_samples) / sample_rate);
+    this->block_stages.fill(0);
+    this->block_voices.fill(0);
+    this->block_num_voices = 0;
+    this->block_start = clock::now();
+}
+
+void Profiler::end_block() {
+    if (this->block_enabled) {
+        this->end_block(elapsed_ns(this->block_start));
+    }
+}
+
+void Profiler::end_block(int64_t callback_ns) {
+    if (!this->block_enabled) {
+        return;
+    }
+    this->block_enabled = false;
+
+    for (size_t i = 0; i < NUM_STAGES; ++i) {
+        this->stages[i].add(this->block_stages[i]);
+    }
+    for (size_t i = 0; i < this->block_num_voices; ++i) {
+        this->voices[i].add(this->block_voices[i]);
+    }
+    if (this->block_num_voices > this->num_voices.load(std::memory_order_relaxed)) {
+        this->num_voices.store(this->block_num_voices, std::memory_order_relaxed);
+    }
+    if (this->block_num_voices > 0) {
+        increment(this->voice_blocks);
+    }
+
+    this->callback.add(callback_ns);
+    this->deadline_total_ns.store(this->deadline_total_ns.load(std::memory_order_relaxed) + this->block_deadline_ns, std::memory_order_relaxed);
+
+    auto load = this->block_deadline_ns > 0
+        ? static_cast<double>(callback_ns) / static_cast<double>(this->block_deadline_ns)
+        : 0.0;
+    auto load_ppm = static_cast<uint64_t>(std::max(load, 0.0) * 1.0e6);
+    if (load_ppm > this->load_max_ppm.load(std::memory_order_relaxed)) {
+        this->load_max_ppm.store(load_ppm, std::memory_order_relaxed);
+    }
+    auto bin = std::min(static_cast<size_t>(std::max(load, 0.0) * NUM_BINS), NUM_BINS);
+    increment(this->histogram[bin]);
+    if (load > 1.0) {
+        increment(this->overruns);
+    } else if (load > NEAR_MISS_FRACTION) {
+        increment(this->near_misses);
+    }
+
+    // Last, so a reader never sees more blocks than the totals account for
+    this->blocks.store(this->blocks.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void Profiler::clear() {
+    this->blocks.store(0, std::memory_order_relaxed);
+    this->callback.clear();
+    this->deadline_total_ns.store(0, std::memory_order_relaxed);
+    this->load_max_ppm.store(0, std::memory_order_relaxed);
+    this->near_misses.store(0, std::memory_order_relaxed);
+    this->overruns.store(0, std::memory_order_relaxed);
+    for (auto& s : this->stages) {
+        s.clear();
+    }
+    for (auto& v : this->voices) {
+        v.clear();
+    }
+    this->num_voices.store(0, std::memory_order_relaxed);
+    this->voice_blocks.store(0, std::memory_order_relaxed);
+    for (auto& h : this->histogram) {
+        h.store(0, std::memory_order_relaxed);
+    }
+}
+
+Profiler::Snapshot Profiler::get_snapshot() const {
+    Snapshot s;
+    s.blocks = this->blocks.load(std::memory_order_acquire);
+    s.callback = this->callback.get(s.blocks);
+    auto deadline_total = this->deadline_total_ns.load(std::memory_order_relaxed);
+    if (deadline_total > 0) {
+        s.mean_load = static_cast<double>(this->callback.total_ns.load(std::memory_order_relaxed)) / static_cast<double>(deadline_total);
+    }
+    s.max_load = static_cast<double>(this->load_max_ppm.load(std::memory_order_relaxed)) * 1.0e-6;
+    s.near_misses = this->near_misses.load(std::memory_order_relaxed);
+    s.overruns = this->overruns.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < NUM_STAGES; ++i) {
+        s.stages[i] = this->stages[i].get(s.blocks);
+    }
+    s.num_voices = this->num_voices.load(std::memory_order_relaxed);
+    s.voice_blocks = this->voice_blocks.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < s.num_voices; ++i) {
+        s.voices[i] = this->voices[i].get(s.voice_blocks);
+    }
+    for (size_t i = 0; i < s.histogram.size(); ++i) {
+        s.histogram[i] = this->histogram[i].load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+} // namespace jnickg::audio::ws
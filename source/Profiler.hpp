@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "Tracer.hpp"
+#include "VoicePool.hpp"
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief Stages of PluginProcessor::processBlock that the Profiler times separately.
+ */
+enum class Stage
+{
+    __FIRST = 0,
+    midi = __FIRST, ///< Note-on/off handling, including the chord lookup in Voice::startNote
+    voices,         ///< All voices' rendering; see Profiler::Snapshot::voices for each one
+    echo,
+    phaser,
+    reverb,
+    __COUNT
+};
+
+/**
+ * @brief Name of the stage in traces. Static, unlike to_string.
+ */
+inline const char* trace_name(Stage s) {
+    switch (s) {
+        case Stage::midi: return "midi";
+        case Stage::voices: return "voices";
+        case Stage::echo: return "echo";
+        case Stage::phaser: return "phaser";
+        case Stage::reverb: return "reverb";
+        case Stage::__COUNT:
+        default: return "?";
+    }
+}
+
+inline std::string to_string(Stage s) {
+    switch (s) {
+        case Stage::midi: return "MIDI";
+        case Stage::voices: return "Voices";
+        case Stage::echo: return "Echo";
+        case Stage::phaser: return "Phaser";
+        case Stage::reverb: return "Reverb";
+        case Stage::__COUNT:
+        default: throw std::runtime_error("Invalid stage");
+    }
+}
+
+/**
+ * @brief Timing of the audio callback, per stage and per voice. Off until set_enabled(true).
+ *
+ * The audio thread brackets each block with begin_block()/end_block() and reports stage timings in
+ * between (see ScopedStage). Timings accumulate in a per-block scratch area, and are folded into
+ * the totals once per block. The totals are atomics with a single writer (the audio thread), so
+ * any thread can read a Snapshot without locking, and the audio thread never waits.
+ *
+ * Timing each voice on its own costs the voices their shared sweep, so callers only do it on one
+ * block in VOICE_SAMPLE_INTERVAL (see is_voice_block()); each voice's mean is over the blocks that
+ * were sampled.
+ *
+ * Each block's callback time is also measured against its deadline (the block's duration), into a
+ * histogram and counters for near-misses and overruns.
+ *
+ * With a Tracer attached and recording, the same scopes are also recorded as timeline events.
+ */
+class Profiler
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    static inline constexpr size_t NUM_STAGES = static_cast<size_t>(Stage::__COUNT);
+    static inline constexpr size_t MAX_VOICES = VoicePool::MAX_VOICES;  ///< Every voice the pool can hold
+    static inline constexpr size_t NUM_BINS = 20;                   ///< Histogram bins up to the deadline
+    static inline constexpr double NEAR_MISS_FRACTION = 0.8;        ///< Of the deadline
+    static inline constexpr uint64_t VOICE_SAMPLE_INTERVAL = 16;    ///< Blocks per block with voices timed
+
+    struct Timing {
+        double mean_us { 0.0 };     ///< Per block
+        double max_us { 0.0 };      ///< Worst block
+    };
+
+    struct Snapshot {
+        uint64_t blocks { 0 };
+        Timing callback;
+        double mean_load { 0.0 };   ///< Mean callback time, as a fraction of the deadline
+        double max_load { 0.0 };
+        uint64_t near_misses { 0 }; ///< Blocks over NEAR_MISS_FRACTION of the deadline, but within it
+        uint64_t overruns { 0 };    ///< Blocks over the deadline
+        std::array<Timing, NUM_STAGES> stages {};
+        std::array<Timing, MAX_VOICES> voices {};  ///< Per sampled block
+        size_t num_voices { 0 };
+        uint64_t voice_blocks { 0 };    ///< Blocks with voices timed
+        /// Blocks by load; bin i covers [i, i + 1) / NUM_BINS of the deadline, the last bin everything over it
+        std::array<uint64_t, NUM_BINS + 1> histogram {};
+
+        const Timing& stage(Stage s) const { return this->stages[static_cast<size_t>(s)]; }
+    };
+
+    //==============================================================================
+    // Audio thread
+
+    void begin_block(int num_samples, double sample_rate);
+    void end_block();
+
+    /**
+     * @brief Folds the block into the totals, given how long its callback took.
+     */
+    void end_block(int64_t callback_ns);
+
+    void add(Stage s, int64_t ns) {
+        if (this->block_enabled) {
+            this->block_stages[static_cast<size_t>(s)] += ns;
+        }
+    }
+
+    void add_voice(size_t index, int64_t ns) {
+        if (this->block_enabled && index < MAX_VOICES) {
+            this->block_voices[index] += ns;
+            this->block_num_voices = std::max(this->block_num_voices, index + 1);
+        }
+    }
+
+    bool is_block_enabled() const { return this->block_enabled; }
+
+    /**
+     * @brief Whether to time each voice this block, as well as the voices stage as a whole.
+     */
+    bool is_voice_block() const {
+        return this->block_enabled && this->blocks.load(std::memory_order_relaxed) % VOICE_SAMPLE_INTERVAL == 0;
+    }
+
+    /**
+     * @brief Times the enclosing scope as (part of) a stage.
+     */
+    class ScopedStage
+    {
+    public:
+        ScopedStage(Profiler& p, Stage s)
+            : profiler(p)
+            , stage(s)
+            , start(p.block_enabled ? clock::now() : clock::time_point())
+            , trace(p.tracer, trace_name(s))
+        {
+            // no-op
+        }
+        ~ScopedStage() {
+            if (this->profiler.block_enabled) {
+                this->profiler.add(this->stage, elapsed_ns(this->start));
+            }
+        }
+        ScopedStage(const ScopedStage&) = delete;
+        ScopedStage& operator=(const ScopedStage&) = delete;
+    private:
+        Profiler& profiler;
+        Stage stage;
+        clock::time_point start;
+        Tracer::Scope trace;
+    };
+
+    /**
+     * @brief begin_block() and end_block() for the enclosing scope, so early returns are counted too.
+     */
+    class ScopedBlock
+    {
+    public:
+        ScopedBlock(Profiler& p, int num_samples, double sample_rate)
+            : profiler(p)
+            , trace(p.tracer, "processBlock", num_samples)
+        {
+            this->profiler.begin_block(num_samples, sample_rate);
+        }
+        ~ScopedBlock() { this->profiler.end_block(); }
+        ScopedBlock(const ScopedBlock&) = delete;
+        ScopedBlock& operator=(const ScopedBlock&) = delete;
+    private:
+        Profiler& profiler;
+        Tracer::Scope trace;
+    };
+
+    static int64_t elapsed_ns(clock::time_point since) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - since).count();
+    }
+
+    //==============================================================================
+    // Any thread
+
+    /**
+     * @brief Turns timing on or off, from the next block. Off by default.
+     */
+    void set_enabled(bool enabled) { this->enabled.store(enabled); }
+    bool is_enabled() const { return this->enabled.load(); }
+
+    /**
+     * @brief Clears all totals at the start of the next block.
+     */
+    void reset() { this->reset_requested.store(true); }
+
+    Snapshot get_snapshot() const;
+
+    /**
+     * @brief Also records the timed scopes to this tracer, whenever it is recording. Set it before
+     * the audio thread starts.
+     */
+    void set_tracer(Tracer* t) { this->tracer = t; }
+    Tracer* get_tracer() const { return this->tracer; }
+
+private:
+    // Totals for one timed quantity. Only the audio thread writes, so plain load/store suffice.
+    struct Accumulator {
+        std::atomic<int64_t> total_ns { 0 };
+        std::atomic<int64_t> max_ns { 0 };
+
+        void add(int64_t ns) {
+            this->total_ns.store(this->total_ns.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+            if (ns > this->max_ns.load(std::memory_order_relaxed)) {
+                this->max_ns.store(ns, std::memory_order_relaxed);
+            }
+        }
+        void clear() {
+            this->total_ns.store(0, std::memory_order_relaxed);
+            this->max_ns.store(0, std::memory_order_relaxed);
+        }
+        Timing get(uint64_t blocks) const {
+            Timing t;
+            if (blocks > 0) {
+                t.mean_us = static_cast<double>(this->total_ns.load(std::memory_order_relaxed)) / static_cast<double>(blocks) * 1.0e-3;
+            }
+            t.max_us = static_cast<double>(this->max_ns.load(std::memory_order_relaxed)) * 1.0e-3;
+            return t;
+        }
+    };
+
+    static void increment(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void clear();
+
+    std::atomic<bool> enabled { false };
+    std::atomic<bool> reset_requested { false };
+    Tracer* tracer { nullptr };
+
+    // Audio thread only
+    bool block_enabled { false };
+    clock::time_point block_start;
+    int64_t block_deadline_ns { 0 };
+    std::array<int64_t, NUM_STAGES> block_stages {};
+    std::array<int64_t, MAX_VOICES> block_voices {};
+    size_t block_num_voices { 0 };
+
+    // Written by the audio thread, read by anyone
+    std::atomic<uint64_t> blocks { 0 };
+    Accumulator callback;
+    std::atomic<int64_t> deadline_total_ns { 0 };
+    std::atomic<uint64_t> load_max_ppm { 0 };   ///< Worst load, in millionths of the deadline
+    std::atomic<uint64_t> near_misses { 0 };
+    std::atomic<uint64_t> overruns { 0 };
+    std::array<Accumulator, NUM_STAGES> stages;
+    std::array<Accumulator, MAX_VOICES> voices;
+    std::atomic<size_t> num_voices { 0 };
+    std::atomic<uint64_t> voice_blocks { 0 };
+    std::array<std::atomic<uint64_t>, NUM_BINS + 1> histogram {};
+};
+
+} // namespace jnickg::audio::ws
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief Read-copy-update cell for a value the audio thread reads and other threads replace.
+ *
+ * Writers build a new, immutable version and publish() it: one atomic pointer swap. The old
+ * version is retired, not freed, because the reader may still be using it. The reader calls read()
+ * once per block and may use what it returns until its next read(), so every read() is a point
+ * where it provably holds nothing older than the version it just got. A version retired when the
+ * read count was n is therefore unreachable once the count reaches n + 2, and is freed by the next
+ * publish() or collect() after that, always on a writer's thread.
+ *
+ * read() is real-time safe: an atomic load and an atomic increment, with no locks and no frees.
+ * Only one thread may read at a time.
+ */
+template <typename T>
+class Rcu
+{
+public:
+    explicit Rcu(std::shared_ptr<const T> initial)
+        : latest(std::move(initial))
+        , current(this->latest.get())
+    {
+        // no-op
+    }
+
+    Rcu(const Rcu&) = delete;
+    Rcu& operator=(const Rcu&) = delete;
+
+    /**
+     * @brief The version to use until the next read(). Real-time safe; for the reader only.
+     */
+    const T* read() {
+        auto* version = this->current.load();
+        this->reads.fetch_add(1);
+        return version;
+    }
+
+    /**
+     * @brief Makes next what read() returns from now on.
+     *
+     * @note Not real-time safe: takes a lock, and may free versions retired earlier.
+     */
+    void publish(std::shared_ptr<const T> next) {
+        const std::lock_guard<std::mutex> lock(this->write_lock);
+        this->current.store(next.get());
+        this->retired.push_back({ std::move(this->latest), this->reads.load() });
+        this->latest = std::move(next);
+        this->collect_locked();
+    }
+
+    /**
+     * @brief The version last published, for writers. Not real-time safe.
+     */
+    std::shared_ptr<const T> get_latest() const {
+        const std::lock_guard<std::mutex> lock(this->write_lock);
+        return this->latest;
+    }
+
+    /**
+     * @brief Frees retired versions the reader can no longer be using. Not real-time safe.
+     */
+    void collect() {
+        const std::lock_guard<std::mutex> lock(this->write_lock);
+        this->collect_locked();
+    }
+
+    /**
+     * @brief Versions published over but not freed yet.
+     */
+    size_t get_num_retired() const {
+        const std::lock_guard<std::mutex> lock(this->write_lock);
+        return this->retired.size();
+    }
+
+private:
+    struct Retired {
+        std::shared_ptr<const T> version;
+        uint64_t reads { 0 };   ///< The read count when it was replaced
+    };
+
+    void collect_locked() {
+        auto reads_now = this->reads.load();
+        std::erase_if(this->retired, [reads_now](const Retired& r) { return reads_now >= r.reads + 2; });
+    }
+
+    mutable std::mutex write_lock;
+    std::shared_ptr<const T> latest;        ///< Owns what current points to
+    std::vector<Retired> retired;
+    std::atomic<const T*> current;
+    std::atomic<uint64_t> reads { 0 };
+};
+
+} // namespace jnickg::audio::ws
@@ -0,0 +1,163 @@
+#include "ScaleQuantizer.hpp"
+
+namespace jnickg::audio::ws {
+
+namespace {
+
+// Each pitch class's index among the white keys of its octave, or -1 for black keys
+constexpr std::array<int, 12> WHITE_KEY_INDEX { 0, -1, 1, -1, 2, 3, -1, 4, -1, 5, -1, 6 };
+constexpr int MIDDLE_C = 60;
+
+int get_white_key_index(int midi_note) {
+    return (midi_note / 12) * 7 + WHITE_KEY_INDEX[static_cast<size_t>(midi_note % 12)];
+}
+
+} // namespace
+
+void ScaleQuantizer::build(const key_info& key) {
+    std::array<bool, 12> in_key_classes {};
+    for (auto n : key.notes()) {
+        in_key_classes[static_cast<size_t>(n)] = true;
+    }
+    auto is_in_key = [&in_key_classes](int m) { return in_key_classes[static_cast<size_t>(m % 12)]; };
+
+    std::array<int, NUM_NOTES> in_key_notes {};    // Ascending
+    auto num_in_key = 0;
+    for (int m = 0; m < NUM_NOTES; ++m) {
+        if (is_in_key(m)) {
+            in_key_notes[static_cast<size_t>(num_in_key++)] = m;
+        }
+    }
+
+    auto at_or_above = [&](int m) {
+        for (int i = 0; i < num_in_key; ++i) {
+            if (in_key_notes[static_cast<size_t>(i)] >= m) {
+                return in_key_notes[static_cast<size_t>(i)];
+            }
+        }
+        return DROP;
+    };
+    auto at_or_below = [&](int m) {
+        for (int i = num_in_key - 1; i >= 0; --i) {
+            if (in_key_notes[static_cast<size_t>(i)] <= m) {
+                return in_key_notes[static_cast<size_t>(i)];
+            }
+        }
+        return DROP;
+    };
+
+    // Past the ends of the MIDI range, snap the other way rather than drop
+    auto snap = [&](int m, Mode mode) {
+        auto above = at_or_above(m);
+        auto below = at_or_below(m);
+        switch (mode) {
+            case Mode::nearest:
+                if (above == DROP || below == DROP) {
+                    return above == DROP ? below : above;
+                }
+                return m - below <= above - m ? below : above;
+            case Mode::up: return above != DROP ? above : below;
+            case Mode::down: return below != DROP ? below : above;
+            case Mode::drop: return is_in_key(m) ? m : DROP;
+            case Mode::off:
+            case Mode::__COUNT:
+            default: return m;
+        }
+    };
+
+    auto root = note_info(key.root, 4).to_midi();
+    auto root_degree = 0;
+    while (root_degree < num_in_key && in_key_notes[static_cast<size_t>(root_degree)] != root) {
+        ++root_degree;
+    }
+    auto map_degree = [&](int m, Mode mode) {
+        if (mode == Mode::off) {
+            return m;
+        }
+        // Black keys sit between two white keys, so both neighbours exist
+        if (WHITE_KEY_INDEX[static_cast<size_t>(m % 12)] < 0) {
+            if (mode == Mode::drop) {
+                return DROP;
+            }
+            m = mode == Mode::up ? m + 1 : m - 1;
+        }
+        auto degree = root_degree + get_white_key_index(m) - get_white_key_index(MIDDLE_C);
+        return degree >= 0 && degree < num_in_key ? in_key_notes[static_cast<size_t>(degree)] : DROP;
+    };
+
+    for (size_t i = 0; i < static_cast<size_t>(Mode::__COUNT); ++i) {
+        auto mode = static_cast<Mode>(i);
+        for (int m = 0; m < NUM_NOTES; ++m) {
+            this->table[0][i][static_cast<size_t>(m)] = static_cast<int8_t>(snap(m, mode));
+            this->table[1][i][static_cast<size_t>(m)] = static_cast<int8_t>(map_degree(m, mode));
+        }
+    }
+}
+
+void MidiQuantizer::prepare(int max_bytes_per_block) {
+    this->output.ensureSize(static_cast<size_t>(max_bytes_per_block));
+    this->reset();
+}
+
+void MidiQuantizer::reset() {
+    this->output.clear();
+    this->reset_held();
+    this->remapping = false;
+}
+
+const juce::MidiBuffer& MidiQuantizer::process(const juce::MidiBuffer& midi, const ScaleQuantizer& quantizer, ScaleQuantizer::Mode mode, bool degree_mapping) {
+    if (mode == ScaleQuantizer::Mode::off && !this->remapping) {
+        return midi;
+    }
+
+    // Raw bytes rather than juce::MidiMessage, which allocates for long (e.g. SysEx) messages
+    this->output.clear();
+    auto notes_changed = false;
+    for (const auto metadata : midi) {
+        const auto* data = metadata.data;
+        auto status = metadata.numBytes == 3 ? data[0] & 0xf0 : 0;
+        auto is_note_on = status == 0x90 && data[2] > 0;
+        auto is_note_off = status == 0x80 || (status == 0x90 && data[2] == 0);
+        if (!is_note_on && !is_note_off && status != 0xa0) {
+            this->output.addEvent(data, metadata.numBytes, metadata.samplePosition);
+            continue;
+        }
+
+        // Keyed by channel too, so a note-off on another channel can't release it
+        auto in = data[1] & 0x7f;
+        auto& held = this->held_as[static_cast<size_t>(data[0] & 0x0f)][static_cast<size_t>(in)];
+        notes_changed = true;
+        int out = in;
+        if (is_note_on) {
+            out = quantizer.quantize(in, mode, degree_mapping);
+            // Struck again while still held: let go of what it played last time, if that's changed
+            if (held >= 0 && held != out) {
+                const uint8_t note_off[] { static_cast<uint8_t>(0x80 | (data[0] & 0x0f)), static_cast<uint8_t>(held), 0 };
+                this->output.addEvent(note_off, 3, metadata.samplePosition);
+            }
+            held = static_cast<int8_t>(out);
+        } else if (held != NOT_HELD) {
+            out = held;
+            if (is_note_off) {
+                held = NOT_HELD;
+            }
+        }
+        if (out == ScaleQuantizer::DROP) {
+            continue;
+        }
+        const uint8_t bytes[] { data[0], static_cast<uint8_t>(out), data[2] };
+        this->output.addEvent(bytes, 3, metadata.samplePosition);
+    }
+
+    if (notes_changed) {
+        this->remapping = false;
+        for (const auto& channel : this->held_as) {
+            for (size_t n = 0; n < channel.size(); ++n) {
+                this->remapping |= channel[n] != NOT_HELD && channel[n] != static_cast<int8_t>(n);
+            }
+        }
+    }
+    return this->output;
+}
+
+} // namespace jnickg::audio::ws
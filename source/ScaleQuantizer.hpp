@@ -0,0 +1,116 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "NotesKeys.hpp"
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief Snaps MIDI notes into a key, by table lookup.
+ *
+ * build() works out, for every MIDI note, mode and mapping, the note to play instead, so
+ * quantize() is a single array read (key_info::contains_note builds vectors on every call).
+ *
+ * With degree mapping on, the white keys play the key's scale degrees in order, with middle C on
+ * the root in octave 4, so a scale of any size can be played without knowing its shape. Black keys
+ * first move to a neighbouring white key as the mode says. White keys past either end of the key's
+ * range are dropped.
+ */
+class ScaleQuantizer
+{
+public:
+    static inline constexpr int NUM_NOTES = 128;
+    static inline constexpr int DROP = -1;     ///< quantize()'s answer for a note that shouldn't play
+
+    enum class Mode
+    {
+        __FIRST = 0,
+        off = __FIRST,  ///< Notes pass through, mapping or not
+        nearest,        ///< The closest note in key; the lower one on a tie
+        up,             ///< The next note in key at or above
+        down,           ///< The next note in key at or below
+        drop,           ///< Notes out of key don't play
+        __COUNT
+    };
+
+    /**
+     * @note Not real-time safe: key_info builds its note list on the heap.
+     */
+    void build(const key_info& key);
+
+    /**
+     * @brief The note to play for midi_note, or DROP. Real-time safe.
+     */
+    int quantize(int midi_note, Mode mode, bool degree_mapping) const {
+        return this->table[degree_mapping ? 1 : 0][static_cast<size_t>(mode)][static_cast<size_t>(midi_note & 0x7f)];
+    }
+
+private:
+    using NoteTable = std::array<int8_t, NUM_NOTES>;
+    std::array<std::array<NoteTable, static_cast<size_t>(Mode::__COUNT)>, 2> table {};  ///< [mapping][mode][note]
+};
+
+inline std::string to_string(ScaleQuantizer::Mode m) {
+    switch (m) {
+        case ScaleQuantizer::Mode::off: return "Off";
+        case ScaleQuantizer::Mode::nearest: return "Nearest";
+        case ScaleQuantizer::Mode::up: return "Up";
+        case ScaleQuantizer::Mode::down: return "Down";
+        case ScaleQuantizer::Mode::drop: return "Drop";
+        case ScaleQuantizer::Mode::__COUNT:
+        default: throw std::runtime_error("Invalid quantizer mode");
+    }
+}
+
+/**
+ * @brief The MIDI input stage that runs notes through a ScaleQuantizer.
+ *
+ * Each note-off (and polyphonic aftertouch) goes to the note its note-on became, on the channel it
+ * came in on, even if the key, mode or mapping changed in between, so nothing hangs. Notes are
+ * tracked per channel, so the same key held on two MPE channels is two notes. Other messages pass
+ * through untouched.
+ * Nothing is allocated once prepared, unless a block carries more MIDI than prepare() allowed for.
+ */
+class MidiQuantizer
+{
+public:
+    static inline constexpr int NUM_CHANNELS = 16;
+
+    MidiQuantizer() { this->reset_held(); }
+
+    /**
+     * @brief Sizes the output buffer, and forgets held notes. Not real-time safe.
+     */
+    void prepare(int max_bytes_per_block);
+
+    void reset();
+
+    /**
+     * @brief The quantized copy of midi. Valid until the next call. Returns midi itself when the
+     * mode is off and no held note needs remapping.
+     */
+    const juce::MidiBuffer& process(const juce::MidiBuffer& midi, const ScaleQuantizer& quantizer, ScaleQuantizer::Mode mode, bool degree_mapping);
+
+private:
+    static inline constexpr int8_t NOT_HELD = -2;
+
+    void reset_held() {
+        for (auto& channel : this->held_as) {
+            channel.fill(NOT_HELD);
+        }
+    }
+
+    juce::MidiBuffer output;
+    /// What each held input note plays, [channel][note]; DROP or NOT_HELD
+    std::array<std::array<int8_t, ScaleQuantizer::NUM_NOTES>, NUM_CHANNELS> held_as {};
+    bool remapping { false };   ///< Whether any held note plays something other than itself
+};
+
+} // namespace jnickg::audio::ws
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief Peak level of one block, across all channels.
+ */
+struct BlockLevel {
+    float peak { 0.0f };
+
+    static BlockLevel measure(const juce::dsp::AudioBlock<float>& block) {
+        BlockLevel level;
+        auto num_samples = block.getNumSamples();
+        auto num_channels = block.getNumChannels();
+        if (num_samples == 0 || num_channels == 0) {
+            return level;
+        }
+        for (size_t ch = 0; ch < num_channels; ++ch) {
+            const auto* data = block.getChannelPointer(ch);
+            for (size_t i = 0; i < num_samples; ++i) {
+                level.peak = std::max(level.peak, std::abs(data[i]));
+            }
+        }
+        return level;
+    }
+};
+
+/**
+ * @brief Decides whether an effect stage can be skipped because it has nothing left to say.
+ *
+ * A stage is idle once its input has been silent and its own output has stayed below the threshold
+ * for a short hold time, i.e. once its tail has actually decayed. The stage's nominal tail length
+ * is only an upper bound, for stages whose output never quite gets there (e.g. a phaser's feedback
+ * hovering at the noise floor).
+ *
+ * A stage that went idle kept whatever state it had, which isn't always inaudible (the tail may
+ * have been cut off at its maximum length), and history it would have shifted out while idle is
+ * still there. So when the input comes back, is_waking() says so, and the stage should be reset
+ * before it runs again.
+ */
+class SilenceGate
+{
+public:
+    static inline constexpr float DEFAULT_THRESHOLD = 3.16e-5f;    ///< -90 dBFS
+    static inline constexpr double DEFAULT_HOLD_SECONDS = 0.05;
+
+    void prepare(double sampleRate, double tail_seconds) {
+        this->sample_rate = sampleRate;
+        this->hold_samples = static_cast<int64_t>(DEFAULT_HOLD_SECONDS * sampleRate);
+        this->set_tail_seconds(tail_seconds);
+        this->reset();
+    }
+
+    void set_tail_seconds(double tail_seconds) {
+        this->max_tail_samples = static_cast<int64_t>(std::max(tail_seconds, 0.0) * this->sample_rate);
+    }
+
+    void set_threshold(float t) { this->threshold = t; }
+
+    /**
+     * @brief Forces the stage active again, e.g. after its parameters change.
+     */
+    void reset() {
+        this->idle = false;
+        this->waking = false;
+        this->tail_remaining = this->max_tail_samples;
+        this->quiet_samples = 0;
+    }
+
+    /**
+     * @brief Call before the stage would run. Returns whether it needs to.
+     */
+    bool should_process(const juce::dsp::AudioBlock<float>& input) {
+        this->input_level = BlockLevel::measure(input);
+        this->waking = false;
+        if (this->input_level.peak > this->threshold) {
+            this->waking = this->idle;
+            this->idle = false;
+            this->tail_remaining = this->max_tail_samples;
+            this->quiet_samples = 0;
+        }
+        return !this->idle;
+    }
+
+    /**
+     * @brief Call after the stage ran, with its output.
+     */
+    void observe_output(const juce::dsp::AudioBlock<float>& output) {
+        this->output_level = BlockLevel::measure(output);
+        auto num_samples = static_cast<int64_t>(output.getNumSamples());
+        if (this->input_level.peak > this->threshold) {
+            return;
+        }
+        this->tail_remaining -= num_samples;
+        this->quiet_samples = this->output_level.peak > this->threshold ? 0 : this->quiet_samples + num_samples;
+        if (this->quiet_samples >= this->hold_samples || this->tail_remaining <= 0) {
+            this->idle = true;
+        }
+    }
+
+    bool is_idle() const { return this->idle; }
+
+    /**
+     * @brief Whether the last should_process() brought the stage back from idle, i.e. whether to
+     * reset it before it runs.
+     */
+    bool is_waking() const { return this->waking; }
+    BlockLevel get_input_level() const { return this->input_level; }
+    BlockLevel get_output_level() const { return this->output_level; }
+
+private:
+    double sample_rate { 44100.0 };
+    float threshold { DEFAULT_THRESHOLD };
+    int64_t hold_samples { 0 };
+    int64_t max_tail_samples { 0 };
+    int64_t tail_remaining { 0 };
+    int64_t quiet_samples { 0 };
+    bool idle { false };
+    bool waking { false };
+    BlockLevel input_level;
+    BlockLevel output_level;
+};
+
+} // namespace jnickg::audio::ws
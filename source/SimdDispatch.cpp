@@ -0,0 +1,93 @@
+#include "SimdDispatch.hpp"
+
+#include <atomic>
+
+namespace jnickg::audio::ws::simd {
+
+namespace {
+
+Isa detect() {
+#if WABISONORANCE_SIMD_X86_VARIANTS
+    // Needed when this runs before libgcc's own initialiser, as it can during static initialisation.
+    // These also check the OS saves the wider registers.
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq")) {
+        return Isa::avx512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return Isa::avx2;
+    }
+#endif
+    if (is_compiled(Isa::sse2)) {
+        return Isa::sse2;
+    }
+    if (is_compiled(Isa::neon)) {
+        return Isa::neon;
+    }
+    return Isa::scalar;
+}
+
+std::atomic<Isa>& active() {
+    static std::atomic<Isa> isa { get_best() };
+    return isa;
+}
+
+} // namespace
+
+bool is_compiled(Isa isa) {
+    switch (isa) {
+        case Isa::scalar:
+            return true;
+        case Isa::sse2:
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+            return true;
+#else
+            return false;
+#endif
+        case Isa::avx2:
+        case Isa::avx512:
+            return WABISONORANCE_SIMD_X86_VARIANTS != 0;
+        case Isa::neon:
+#if defined(__aarch64__) || defined(_M_ARM64)
+            return true;
+#else
+            return false;
+#endif
+        case Isa::__COUNT:
+        default:
+            return false;
+    }
+}
+
+bool is_supported(Isa isa) {
+    if (!is_compiled(isa)) {
+        return false;
+    }
+    switch (isa) {
+        case Isa::avx2:
+            return get_best() == Isa::avx2 || get_best() == Isa::avx512;
+        case Isa::avx512:
+            return get_best() == Isa::avx512;
+        default:
+            // Baselines run anywhere the build does
+            return true;
+    }
+}
+
+Isa get_best() {
+    static const Isa best = detect();
+    return best;
+}
+
+Isa get_active() {
+    return active().load(std::memory_order_relaxed);
+}
+
+void set_active(Isa isa) {
+    if (!is_supported(isa)) {
+        throw std::runtime_error("Instruction set not supported here: " + to_string(isa));
+    }
+    active().store(isa, std::memory_order_relaxed);
+}
+
+} // namespace jnickg::audio::ws::simd
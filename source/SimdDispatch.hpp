@@ -0,0 +1,125 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+// GCC and Clang can compile single functions for instruction sets beyond the build's baseline
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define WABISONORANCE_SIMD_X86_VARIANTS 1
+#else
+#define WABISONORANCE_SIMD_X86_VARIANTS 0
+#endif
+
+namespace jnickg::audio::ws::simd {
+
+/**
+ * @brief Instruction sets the hot kernels are compiled for.
+ */
+enum class Isa
+{
+    __FIRST = 0,
+    scalar = __FIRST,   ///< No auto-vectorisation (on GCC; elsewhere the same as the baseline). Always available
+    sse2,               ///< The x86-64 baseline the plugin is built for
+    avx2,               ///< AVX2 and FMA: Haswell (2013) and later
+    avx512,             ///< AVX-512 F, VL and DQ: Skylake-SP and later
+    neon,               ///< The AArch64 baseline
+    __COUNT
+};
+
+inline std::string to_string(Isa isa) {
+    switch (isa) {
+        case Isa::scalar: return "Scalar";
+        case Isa::sse2: return "SSE2";
+        case Isa::avx2: return "AVX2";
+        case Isa::avx512: return "AVX-512";
+        case Isa::neon: return "NEON";
+        case Isa::__COUNT:
+        default: throw std::runtime_error("Invalid instruction set");
+    }
+}
+
+/**
+ * @brief Whether this build has kernels for the instruction set.
+ */
+bool is_compiled(Isa isa);
+
+/**
+ * @brief Whether this build has kernels for the instruction set and this CPU (and OS) can run them.
+ */
+bool is_supported(Isa isa);
+
+/**
+ * @brief The fastest supported instruction set, from CPUID. What get_active() starts as.
+ */
+Isa get_best();
+
+/**
+ * @brief The instruction set dispatch() runs kernels with. Safe to read from any thread.
+ */
+Isa get_active();
+
+/**
+ * @brief Overrides the instruction set for every kernel in the process, e.g. to test or compare
+ * each path. Throws if it isn't supported here.
+ */
+void set_active(Isa isa);
+
+namespace detail {
+
+// flatten inlines everything the kernel calls, so all of it is compiled for the variant's target.
+// Out-of-line copies of those callees are still compiled for the baseline, so nothing built for a
+// newer instruction set leaks into code that runs without checking.
+#if defined(__GNUC__)
+template <typename Kernel>
+[[gnu::flatten]] void run_baseline(const Kernel& kernel) { kernel(); }
+#else
+template <typename Kernel>
+void run_baseline(const Kernel& kernel) { kernel(); }
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+template <typename Kernel>
+[[gnu::flatten, gnu::optimize("no-tree-vectorize")]] void run_scalar(const Kernel& kernel) { kernel(); }
+#else
+template <typename Kernel>
+void run_scalar(const Kernel& kernel) { kernel(); }
+#endif
+
+#if WABISONORANCE_SIMD_X86_VARIANTS
+template <typename Kernel>
+[[gnu::target("avx2,fma"), gnu::flatten]] void run_avx2(const Kernel& kernel) { kernel(); }
+
+template <typename Kernel>
+[[gnu::target("avx512f,avx512vl,avx512dq,avx2,fma"), gnu::flatten]] void run_avx512(const Kernel& kernel) { kernel(); }
+#endif
+
+} // namespace detail
+
+/**
+ * @brief Runs the kernel, a callable taking no arguments, compiled for the active instruction set.
+ *
+ * Every call site gets its own copy of the kernel per instruction set, so put it around a whole
+ * block's worth of work rather than anything per sample. Results can differ between instruction
+ * sets in the last bit or so, where FMA is available.
+ */
+template <typename Kernel>
+void dispatch(const Kernel& kernel) {
+    switch (get_active()) {
+        case Isa::scalar:
+            detail::run_scalar(kernel);
+            return;
+#if WABISONORANCE_SIMD_X86_VARIANTS
+        case Isa::avx2:
+            detail::run_avx2(kernel);
+            return;
+        case Isa::avx512:
+            detail::run_avx512(kernel);
+            return;
+#endif
+        default:
+            detail::run_baseline(kernel);
+            return;
+    }
+}
+
+} // namespace jnickg::audio::ws::simd
@@ -0,0 +1,135 @@
+#include "Tracer.hpp"
+
+namespace jnickg::audio::ws {
+
+Tracer::Tracer()
+    : epoch(clock::now())
+{
+    // no-op
+}
+
+void Tracer::start(size_t events_per_thread) {
+    this->stop_and_drain();
+    for (auto& t : this->threads) {
+        if (t.events.empty()) {
+            t.events.resize(events_per_thread);
+        }
+        t.count.store(0, std::memory_order_relaxed);
+        t.owner.store(std::thread::id(), std::memory_order_relaxed);
+    }
+    this->dropped.store(0, std::memory_order_relaxed);
+    this->recording.store(true, std::memory_order_release);
+}
+
+void Tracer::stop() {
+    this->stop_and_drain();
+}
+
+void Tracer::stop_and_drain() {
+    // Sequentially consistent with record(): either it sees recording off, or this sees it in flight
+    this->recording.store(false, std::memory_order_seq_cst);
+    while (this->in_flight.load(std::memory_order_seq_cst) > 0) {
+        std::this_thread::yield();
+    }
+}
+
+Tracer::ThreadBuffer* Tracer::buffer_for_this_thread() {
+    auto me = std::this_thread::get_id();
+    for (auto& t : this->threads) {
+        if (t.owner.load(std::memory_order_acquire) == me) {
+            return &t;
+        }
+    }
+    for (auto& t : this->threads) {
+        auto unclaimed = std::thread::id();
+        if (t.owner.compare_exchange_strong(unclaimed, me, std::memory_order_acq_rel)) {
+            return &t;
+        }
+    }
+    return nullptr;
+}
+
+void Tracer::record(const char* name, clock::time_point start, clock::time_point end, int32_t arg) {
+    if (!this->is_recording()) {
+        return;
+    }
+    this->in_flight.fetch_add(1, std::memory_order_seq_cst);
+    if (this->recording.load(std::memory_order_seq_cst)) {
+        this->record_in_flight(name, start, end, arg);
+    }
+    this->in_flight.fetch_sub(1, std::memory_order_release);
+}
+
+void Tracer::record_in_flight(const char* name, clock::time_point start, clock::time_point end, int32_t arg) {
+    auto* buffer = this->buffer_for_this_thread();
+    if (buffer == nullptr) {
+        this->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    auto index = buffer->count.load(std::memory_order_relaxed);
+    if (index >= buffer->events.size()) {
+        this->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    auto& e = buffer->events[index];
+    e.name = name;
+    e.start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - this->epoch).count();
+    e.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    e.arg = arg;
+    // Publishes the event to write_chrome_json
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+size_t Tracer::get_num_events() const {
+    size_t total = 0;
+    for (const auto& t : this->threads) {
+        total += t.count.load(std::memory_order_acquire);
+    }
+    return total;
+}
+
+void Tracer::write_chrome_json(juce::OutputStream& out) const {
+    // Timestamps are in microseconds; keep nanosecond resolution with three decimals
+    auto us = [](int64_t ns) { return juce::String(static_cast<double>(ns) * 1.0e-3, 3); };
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    auto first = true;
+    for (size_t tid = 0; tid < this->threads.size(); ++tid) {
+        const auto& t = this->threads[tid];
+        auto count = t.count.load(std::memory_order_acquire);
+        if (count == 0) {
+            continue;
+        }
+        auto tid_str = juce::String(static_cast<int>(tid) + 1);
+        if (!first) {
+            out << ",\n";
+        }
+        first = false;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid_str
+            << ",\"args\":{\"name\":\"thread " << tid_str << "\"}}";
+
+        for (size_t i = 0; i < count; ++i) {
+            const auto& e = t.events[i];
+            out << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid_str
+                << ",\"ts\":" << us(e.start_ns) << ",\"dur\":" << us(e.duration_ns);
+            if (e.arg != NO_ARG) {
+                out << ",\"args\":{\"arg\":" << juce::String(e.arg) << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+}
+
+bool Tracer::save_chrome_json(const juce::File& file) const {
+    file.deleteFile();
+    juce::FileOutputStream out(file);
+    if (!out.openedOk()) {
+        return false;
+    }
+    this->write_chrome_json(out);
+    out.flush();
+    return out.getStatus().wasOk();
+}
+
+} // namespace jnickg::audio::ws
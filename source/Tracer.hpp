@@ -0,0 +1,128 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief Records timed events from the audio thread (and any other) for viewing as a timeline.
+ *
+ * Each recording thread claims one of MAX_THREADS preallocated buffers the first time it records,
+ * and appends fixed-size events to it, so record() never allocates, locks or waits. Once stopped,
+ * the events can be written out as Chrome Trace Event JSON, which chrome://tracing and
+ * ui.perfetto.dev open directly.
+ *
+ * Buffers are sized by the first start() and then kept, so a late event from a thread that was
+ * mid-record() when tracing stopped can never land in freed memory. A full buffer drops (and counts)
+ * further events rather than wrapping.
+ *
+ * Every record() counts itself in flight, and start()/stop() wait for that count to drain after
+ * they stop recording, so a record() racing them can't overwrite the cleared buffers or publish an
+ * event after stop() returns. The wait is a few stores long; only the caller of start()/stop() waits.
+ */
+class Tracer
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    static inline constexpr size_t MAX_THREADS = 8;
+    static inline constexpr size_t DEFAULT_EVENTS_PER_THREAD = size_t { 1 } << 16;
+    static inline constexpr int32_t NO_ARG = -1;
+
+    struct Event {
+        const char* name { nullptr };   ///< Must outlive the Tracer, e.g. a string literal
+        int64_t start_ns { 0 };         ///< Since the Tracer was constructed
+        int64_t duration_ns { 0 };
+        int32_t arg { NO_ARG };         ///< E.g. a voice index or MIDI note
+    };
+
+    Tracer();
+
+    //==============================================================================
+    // Not the audio thread
+
+    /**
+     * @brief Clears previous events and starts recording. The first call allocates the buffers.
+     */
+    void start(size_t events_per_thread = DEFAULT_EVENTS_PER_THREAD);
+
+    /**
+     * @brief Stops recording. Returns once every record() already under way has finished.
+     */
+    void stop();
+
+    /**
+     * @brief Writes everything recorded as Chrome Trace Event JSON. Call after stop().
+     */
+    void write_chrome_json(juce::OutputStream& out) const;
+    bool save_chrome_json(const juce::File& file) const;
+
+    size_t get_num_events() const;
+
+    //==============================================================================
+    // Any thread, real-time safe
+
+    bool is_recording() const { return this->recording.load(std::memory_order_acquire); }
+    size_t get_dropped() const { return this->dropped.load(std::memory_order_relaxed); }
+
+    void record(const char* name, clock::time_point start, clock::time_point end, int32_t arg = NO_ARG);
+
+    /**
+     * @brief Records the enclosing scope as one event, if recording.
+     */
+    class Scope
+    {
+    public:
+        Scope(Tracer* t, const char* n, int32_t a = NO_ARG)
+            : tracer(t != nullptr && t->is_recording() ? t : nullptr)
+            , name(n)
+            , arg(a)
+            , start(this->tracer != nullptr ? clock::now() : clock::time_point())
+        {
+            // no-op
+        }
+        ~Scope() {
+            if (this->tracer != nullptr) {
+                this->tracer->record(this->name, this->start, clock::now(), this->arg);
+            }
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        Tracer* tracer;
+        const char* name;
+        int32_t arg;
+        clock::time_point start;
+    };
+
+private:
+    struct ThreadBuffer {
+        std::atomic<std::thread::id> owner {};
+        std::vector<Event> events;
+        std::atomic<size_t> count { 0 };
+    };
+
+    ThreadBuffer* buffer_for_this_thread();
+    void record_in_flight(const char* name, clock::time_point start, clock::time_point end, int32_t arg);
+
+    /**
+     * @brief Stops recording, then waits out every record() that saw it still on.
+     */
+    void stop_and_drain();
+
+    clock::time_point epoch;
+    std::atomic<bool> recording { false };
+    std::atomic<size_t> dropped { 0 };
+    std::atomic<int> in_flight { 0 };      ///< record() calls under way
+    std::array<ThreadBuffer, MAX_THREADS> threads;
+};
+
+} // namespace jnickg::audio::ws
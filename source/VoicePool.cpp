@@ -0,0 +1,418 @@
+#include "VoicePool.hpp"
+
+#include <juce_dsp/juce_dsp.h>
+
+#include "FastMath.hpp"
+#include "SimdDispatch.hpp"
+
+namespace jnickg::audio::ws {
+
+void VoicePool::prepare(double sr) {
+    this->sample_rate = static_cast<float>(sr);
+    this->glide_length = static_cast<int>(std::floor(GLIDE_SECONDS * sr));
+    this->onset_step = 1.0f / std::max(ONSET_FADE_SECONDS * this->sample_rate, 1.0f);
+    this->expression_rate = 1.0f / std::max(EXPRESSION_SECONDS * this->sample_rate, 1.0f);
+
+    // Allocates, but only here
+    auto lowpass = juce::dsp::IIR::Coefficients<float>::makeLowPass(sr, CUTOFF);
+    std::copy_n(lowpass->getRawCoefficients(), this->neutral_coefficients.size(), this->neutral_coefficients.begin());
+
+    for (size_t v = 0; v < MAX_VOICES; ++v) {
+        this->reset(v);
+    }
+}
+
+void VoicePool::reset(size_t voice) {
+    auto first = voice * TONE_STRIDE;
+    std::fill_n(this->phases.begin() + static_cast<std::ptrdiff_t>(first), TONE_STRIDE, 0.0f);
+    std::copy_n(this->targets.begin() + static_cast<std::ptrdiff_t>(first), TONE_STRIDE, this->frequencies.begin() + static_cast<std::ptrdiff_t>(first));
+    std::fill_n(this->glide_left.begin() + static_cast<std::ptrdiff_t>(first), TONE_STRIDE, 0);
+    std::fill_n(this->onset_left.begin() + static_cast<std::ptrdiff_t>(first), TONE_STRIDE, 0);
+    std::fill_n(this->onset_gains.begin() + static_cast<std::ptrdiff_t>(first), TONE_STRIDE, 1.0f);
+    this->filter_s1[voice] = 0.0f;
+    this->filter_s2[voice] = 0.0f;
+    this->levels[voice] = 0.0f;
+    this->expression_gains[voice] = 1.0f;
+    this->gain_targets[voice] = 1.0f;
+    this->gain_steps[voice] = 0.0f;
+    this->cutoffs[voice] = CUTOFF;
+    this->cutoff_targets[voice] = CUTOFF;
+    this->cutoff_countdowns[voice] = 0;
+    this->filter_coefficients[voice] = this->neutral_coefficients;
+    this->held[voice] = false;
+    this->fading[voice] = false;
+    this->envelopes[voice].reset();
+    this->phasers[voice].reset();
+    this->partials_dirty = true;
+}
+
+void VoicePool::set_frequency(size_t voice, size_t tone, float hz) {
+    auto i = voice * TONE_STRIDE + tone;
+    if (hz == this->targets[i]) {
+        return;
+    }
+    this->partials_dirty = true;
+    if (this->partial_sharing) {
+        // Join a partial already sounding at this pitch, in phase, so the two render as one
+        for (size_t v = 0; v < MAX_VOICES; ++v) {
+            if (v == voice || !this->is_active(v) || this->oscillator_types[v] != this->oscillator_types[voice]) {
+                continue;
+            }
+            for (size_t t = 0; t < this->num_tones[v]; ++t) {
+                auto j = v * TONE_STRIDE + t;
+                if (this->targets[j] == hz) {
+                    this->copy_oscillator(j, i);
+                    return;
+                }
+            }
+        }
+    }
+    this->targets[i] = hz;
+    if (this->glide_length <= 0) {
+        this->frequencies[i] = hz;
+        this->glide_left[i] = 0;
+        return;
+    }
+    this->glide_left[i] = this->glide_length;
+    this->glide_steps[i] = (hz - this->frequencies[i]) / static_cast<float>(this->glide_length);
+}
+
+void VoicePool::set_onset(size_t voice, size_t tone, int delay) {
+    auto i = voice * TONE_STRIDE + tone;
+    this->partials_dirty = true;
+    this->onset_left[i] = std::max(delay, 0);
+    this->onset_gains[i] = delay > 0 ? 0.0f : 1.0f;
+}
+
+void VoicePool::set_expression(size_t voice, float gain, float cutoff) {
+    this->gain_targets[voice] = std::max(gain, 0.0f);
+    this->cutoff_targets[voice] = std::clamp(cutoff, MIN_CUTOFF, 0.45f * this->sample_rate);
+    if (!this->is_active(voice)) {
+        this->expression_gains[voice] = this->gain_targets[voice];
+        this->gain_steps[voice] = 0.0f;
+        this->set_lowpass(voice, this->cutoff_targets[voice]);
+    }
+}
+
+void VoicePool::update_controls(size_t voice, int num_samples) {
+    // One-pole smoothing, stepped once per chunk; close enough snaps, so a voice back at rest
+    // renders exactly as one that never moved
+    constexpr float snap = 1.0e-4f;
+    auto amount = std::min(static_cast<float>(num_samples) * this->expression_rate, 1.0f);
+
+    auto gain = this->expression_gains[voice];
+    auto gain_target = this->gain_targets[voice];
+    if (std::abs(gain_target - gain) < snap) {
+        this->expression_gains[voice] = gain_target;
+        this->gain_steps[voice] = 0.0f;
+    } else {
+        this->gain_steps[voice] = amount * (gain_target - gain) / static_cast<float>(num_samples);
+    }
+
+    // New coefficients cost a tan(), so the cutoff steps every SHARED_CHUNK samples of audio, not
+    // every call: blocks split at each MIDI event can be a sample long
+    auto cutoff = this->cutoffs[voice];
+    auto cutoff_target = this->cutoff_targets[voice];
+    auto& countdown = this->cutoff_countdowns[voice];
+    if (cutoff != cutoff_target && countdown <= 0) {
+        auto cutoff_amount = std::min(static_cast<float>(SHARED_CHUNK) * this->expression_rate, 1.0f);
+        auto next = std::abs(cutoff_target - cutoff) < snap * cutoff_target ? cutoff_target : cutoff + cutoff_amount * (cutoff_target - cutoff);
+        this->set_lowpass(voice, next);
+        countdown = SHARED_CHUNK;
+    }
+    countdown = std::max(countdown - num_samples, 0);
+}
+
+void VoicePool::set_lowpass(size_t voice, float cutoff) {
+    this->cutoffs[voice] = cutoff;
+    if (cutoff == CUTOFF) {
+        this->filter_coefficients[voice] = this->neutral_coefficients;
+        return;
+    }
+    // As juce::dsp::IIR::Coefficients::makeLowPass, with Q = 1/sqrt(2)
+    auto n = 1.0 / std::tan(juce::MathConstants<double>::pi * static_cast<double>(cutoff) / static_cast<double>(this->sample_rate));
+    auto n_squared = n * n;
+    auto inv_q = juce::MathConstants<double>::sqrt2;
+    auto c1 = 1.0 / (1.0 + inv_q * n + n_squared);
+    this->filter_coefficients[voice] = {
+        static_cast<float>(c1),
+        static_cast<float>(2.0 * c1),
+        static_cast<float>(c1),
+        static_cast<float>(2.0 * c1 * (1.0 - n_squared)),
+        static_cast<float>(c1 * (1.0 - inv_q * n + n_squared)),
+    };
+}
+
+void VoicePool::fade_out(size_t voice) {
+    auto& envelope = this->envelopes[voice];
+    auto params = envelope.getParameters();
+    params.release = FADE_SECONDS;
+    envelope.setParameters(params);
+    envelope.noteOff();
+    this->held[voice] = false;
+    this->fading[voice] = true;
+}
+
+void VoicePool::render(size_t voice, float* out, int num_samples) {
+    // Steps the voice's tones apart from any partial they're grouped into
+    this->partials_dirty = true;
+    simd::dispatch([&] { this->render_one(voice, out, num_samples); });
+}
+
+void VoicePool::render(float* out, int num_samples) {
+    simd::dispatch([&] { this->render_all(out, num_samples); });
+}
+
+void VoicePool::render_one(size_t voice, float* out, int num_samples) {
+    if (!this->is_active(voice)) {
+        return;
+    }
+
+    const auto first = voice * TONE_STRIDE;
+    const auto tones = this->num_tones[voice];
+    const auto type = this->oscillator_types[voice];
+    for (int start = 0; start < num_samples; start += SHARED_CHUNK) {
+        auto n = std::min(SHARED_CHUNK, num_samples - start);
+        for (size_t t = 0; t < tones; ++t) {
+            this->render_oscillator(first + t, type, &this->tone_bus[t * SHARED_CHUNK], n);
+        }
+        this->update_controls(voice, n);
+        this->render_voice(voice, out + start, n, [this, first](size_t tone, int i) {
+            return this->tone_bus[(tone - first) * SHARED_CHUNK + static_cast<size_t>(i)];
+        });
+    }
+}
+
+void VoicePool::render_all(float* out, int num_samples) {
+    if (!this->partial_sharing) {
+        for (size_t v = 0; v < MAX_VOICES; ++v) {
+            this->render_one(v, out, num_samples);
+        }
+        return;
+    }
+
+    // A voice that ends partway through the block still renders all of it, as it does unshared.
+    // Grouped tones stay in step (see below), so the groups only change when a voice starts or stops,
+    // or its tones are changed.
+    for (size_t v = 0; v < MAX_VOICES; ++v) {
+        auto active = this->is_active(v);
+        if (active != this->rendering[v]) {
+            this->rendering[v] = active;
+            this->partials_dirty = true;
+        }
+    }
+    if (this->partials_dirty) {
+        this->group_partials();
+        this->partials_dirty = false;
+    }
+    for (int start = 0; start < num_samples; start += SHARED_CHUNK) {
+        auto n = std::min(SHARED_CHUNK, num_samples - start);
+        // Each unique partial once...
+        for (size_t p = 0; p < this->num_partials; ++p) {
+            auto leader = this->partial_leaders[p];
+            this->render_oscillator(leader, this->oscillator_types[leader / TONE_STRIDE], &this->partial_bus[p * SHARED_CHUNK], n);
+        }
+        // ...then every voice's envelope and filter over it, in slot order as usual
+        for (size_t v = 0; v < MAX_VOICES; ++v) {
+            if (!this->rendering[v]) {
+                continue;
+            }
+            this->update_controls(v, n);
+            this->render_voice(v, out + start, n, [this](size_t tone, int i) {
+                return this->partial_bus[static_cast<size_t>(this->partial_of[tone]) * SHARED_CHUNK + static_cast<size_t>(i)];
+            });
+        }
+    }
+
+    // Followers' oscillators didn't run, so catch them up with their leaders
+    for (size_t v = 0; v < MAX_VOICES; ++v) {
+        if (!this->rendering[v]) {
+            continue;
+        }
+        for (size_t t = 0; t < this->num_tones[v]; ++t) {
+            auto i = v * TONE_STRIDE + t;
+            auto leader = this->partial_leaders[this->partial_of[i]];
+            if (leader != i) {
+                this->copy_oscillator(leader, i);
+            }
+        }
+    }
+}
+
+void VoicePool::render_oscillator(size_t tone, OscillatorType type, float* bus, int num_samples) {
+    constexpr auto pi = juce::MathConstants<float>::pi;
+    constexpr auto two_pi = juce::MathConstants<float>::twoPi;
+
+    // Silent until its onset, with the oscillator paused, so it starts from where the note left it
+    auto wait = std::min(this->onset_left[tone], num_samples);
+    if (wait > 0) {
+        std::fill_n(bus, wait, 0.0f);
+        this->onset_left[tone] -= wait;
+        bus += wait;
+        num_samples -= wait;
+    }
+
+    // The phase and glide are a recurrence, so they're stepped one sample at a time; the waveform
+    // over the phases isn't, and vectorises
+    auto phase = this->phases[tone];
+    for (int i = 0; i < num_samples; ++i) {
+        auto increment = two_pi * this->next_frequency(tone) / this->sample_rate;
+        bus[i] = phase - pi;
+        phase += increment;
+        while (phase >= two_pi) {
+            phase -= two_pi;
+        }
+    }
+    this->phases[tone] = phase;
+
+    this->shape(type, bus, num_samples);
+
+    auto gain = this->onset_gains[tone];
+    if (gain < 1.0f) {
+        const auto step = this->onset_step;
+        for (int i = 0; i < num_samples; ++i) {
+            gain = std::min(gain + step, 1.0f);
+            bus[i] *= gain;
+        }
+        this->onset_gains[tone] = gain;
+    }
+}
+
+void VoicePool::shape(OscillatorType type, float* t, int num_samples) const {
+    constexpr auto pi = juce::MathConstants<float>::pi;
+    switch (type) {
+        case OscillatorType::Sine:
+            for (int i = 0; i < num_samples; ++i) {
+                t[i] = fastmath::sin(t[i]);
+            }
+            break;
+        case OscillatorType::SineWithHarmonics:
+            // We assume harmonic weights add to one and DO NOT CHECK THAT HERE
+            for (int i = 0; i < num_samples; ++i) {
+                auto val = 0.0f;
+                for (size_t h = 0; h < HARMONIC_WEIGHTS.size(); ++h) {
+                    val += HARMONIC_WEIGHTS[h] * fastmath::sin(HARMONIC_FACTORS[h] * t[i]);
+                }
+                t[i] = val;
+            }
+            break;
+        case OscillatorType::Saw:
+            for (int i = 0; i < num_samples; ++i) {
+                t[i] = t[i] / pi;
+            }
+            break;
+        case OscillatorType::Square:
+            for (int i = 0; i < num_samples; ++i) {
+                t[i] = t[i] < 0.0f ? -1.0f : 1.0f;
+            }
+            break;
+        case OscillatorType::Triangle:
+            for (int i = 0; i < num_samples; ++i) {
+                t[i] = 2.0f * std::abs(t[i] - std::round(t[i])) - 1.0f;
+            }
+            break;
+        default:
+            std::fill_n(t, num_samples, 0.0f);
+            return;
+    }
+    const auto clip = this->clip;
+    for (int i = 0; i < num_samples; ++i) {
+        t[i] = std::clamp(t[i], -clip, clip);
+    }
+}
+
+template <typename ToneSource>
+void VoicePool::render_voice(size_t voice, float* out, int num_samples, ToneSource&& next_tone) {
+    // Only the tones in use, with the tone loop unrolled for each chord size
+    static_assert(MAX_TONES == 5, "render_voice needs a case for each chord size");
+    switch (this->num_tones[voice]) {
+        case 0: return this->render_tones<0>(voice, out, num_samples, next_tone);
+        case 1: return this->render_tones<1>(voice, out, num_samples, next_tone);
+        case 2: return this->render_tones<2>(voice, out, num_samples, next_tone);
+        case 3: return this->render_tones<3>(voice, out, num_samples, next_tone);
+        case 4: return this->render_tones<4>(voice, out, num_samples, next_tone);
+        default: return this->render_tones<5>(voice, out, num_samples, next_tone);
+    }
+}
+
+template <size_t TONES, typename ToneSource>
+void VoicePool::render_tones(size_t voice, float* out, int num_samples, ToneSource& next_tone) {
+    const auto first = voice * TONE_STRIDE;
+    const auto phaser_on = this->phaser_enabled[voice];
+    const auto& c = this->filter_coefficients[voice];
+    const auto gain_step = this->gain_steps[voice];
+    auto& envelope = this->envelopes[voice];
+    auto s1 = this->filter_s1[voice];
+    auto s2 = this->filter_s2[voice];
+    auto level = this->levels[voice];
+    auto expression = this->expression_gains[voice];
+
+    for (int i = 0; i < num_samples; ++i) {
+        expression += gain_step;
+        const auto g = this->gain * expression;
+        auto voice_sample = 0.0f;
+        // The envelope and the filter step once per tone, as the per-voice juce::dsp objects did
+        for (size_t t = 0; t < TONES; ++t) {
+            auto x = next_tone(first + t, i);
+            level = envelope.getNextSample();
+            x *= level;
+            x *= g;
+            auto y = c[0] * x + s1;
+            s1 = c[1] * x - c[3] * y + s2;
+            s2 = c[2] * x - c[4] * y;
+            voice_sample += y;
+        }
+        if (phaser_on) {
+            voice_sample = this->phasers[voice].process_sample(voice_sample);
+        }
+        out[i] += voice_sample;
+    }
+
+    this->filter_s1[voice] = s1;
+    this->filter_s2[voice] = s2;
+    this->levels[voice] = level;
+    this->expression_gains[voice] = expression;
+}
+
+bool VoicePool::is_same_oscillator(size_t a, size_t b) const {
+    return this->oscillator_types[a / TONE_STRIDE] == this->oscillator_types[b / TONE_STRIDE]
+        && this->phases[a] == this->phases[b]
+        && this->frequencies[a] == this->frequencies[b]
+        && this->targets[a] == this->targets[b]
+        && this->glide_left[a] == this->glide_left[b]
+        && (this->glide_left[a] == 0 || this->glide_steps[a] == this->glide_steps[b])
+        && this->onset_left[a] == this->onset_left[b]
+        && this->onset_gains[a] == this->onset_gains[b];
+}
+
+void VoicePool::copy_oscillator(size_t from, size_t to) {
+    this->phases[to] = this->phases[from];
+    this->frequencies[to] = this->frequencies[from];
+    this->targets[to] = this->targets[from];
+    this->glide_steps[to] = this->glide_steps[from];
+    this->glide_left[to] = this->glide_left[from];
+    this->onset_left[to] = this->onset_left[from];
+    this->onset_gains[to] = this->onset_gains[from];
+}
+
+void VoicePool::group_partials() {
+    this->num_partials = 0;
+    for (size_t v = 0; v < MAX_VOICES; ++v) {
+        if (!this->rendering[v]) {
+            continue;
+        }
+        for (size_t t = 0; t < this->num_tones[v]; ++t) {
+            auto i = v * TONE_STRIDE + t;
+            size_t p = 0;
+            while (p < this->num_partials && !this->is_same_oscillator(this->partial_leaders[p], i)) {
+                ++p;
+            }
+            if (p == this->num_partials) {
+                this->partial_leaders[this->num_partials++] = static_cast<uint16_t>(i);
+            }
+            this->partial_of[i] = static_cast<uint16_t>(p);
+        }
+    }
+}
+
+} // namespace jnickg::audio::ws
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "ChordTable.hpp"
+#include "Phaser.hpp"
+
+namespace jnickg::audio::ws {
+
+/**
+ * @brief The render state of every voice, in contiguous, cache-line-aligned arrays.
+ *
+ * Oscillator state is laid out [voice][tone], with each voice's tones padded to TONE_STRIDE, so a
+ * voice's tones share a cache line and rendering all voices is one linear sweep through memory.
+ * Each voice renders only the tones its chord uses, with a loop specialised for each chord size.
+ * Oscillators render SHARED_CHUNK samples at a time, and rendering runs through simd::dispatch.
+ * Envelopes, filter state and per-voice phasers sit in arrays indexed by voice. Nothing is
+ * allocated after construction.
+ *
+ * A Voice owns one slot (its index) and writes it from note events; render() reads it.
+ *
+ * With partial sharing on, tones in different voices that would produce the same waveform (same
+ * pitch, phase, glide and oscillator type) are computed once, and each voice applies its own
+ * envelope and filter to the shared result. To make that common, a tone started on a pitch another
+ * voice is already holding takes over that tone's phase and glide, instead of gliding from its last
+ * pitch. Otherwise the output is the same as rendering each voice on its own. Tones are grouped into
+ * partials only when a voice starts or stops or its tones change, not on every render.
+ *
+ * Each tone can be given an onset: a number of samples it stays silent for after the note starts,
+ * before fading in over ONSET_FADE_SECONDS. That's how chords are strummed. Onsets count rendered
+ * samples, so they land on the same sample however the blocks are split.
+ *
+ * Each voice also has an expression gain and low-pass cutoff (e.g. from MPE pressure and timbre).
+ * They're control-rate: the gain moves towards its target once per chunk, ramped across the chunk,
+ * and while the cutoff moves, the voice's filter coefficients are recomputed at most once per
+ * SHARED_CHUNK samples, however small the blocks.
+ */
+class VoicePool
+{
+public:
+    static inline constexpr size_t MAX_VOICES = 64;
+    static inline constexpr size_t MAX_TONES = ChordTable::MAX_TONES;
+    static inline constexpr size_t TONE_STRIDE = 8;     ///< Floats per voice in the oscillator arrays
+    static inline constexpr double GLIDE_SECONDS = 0.05; ///< Time a tone takes to slide to a new pitch
+    static inline constexpr float FADE_SECONDS = 0.005f; ///< Release time of a voice being shed
+    static inline constexpr int SHARED_CHUNK = 32;      ///< Samples of each shared partial rendered at a time
+    static inline constexpr float ONSET_FADE_SECONDS = 0.002f; ///< Fade-in of a tone starting after its voice
+    static inline constexpr float CUTOFF = 500.0f;      ///< The voices' low-pass cutoff, in Hz, without expression
+    static inline constexpr float MIN_CUTOFF = 20.0f;
+    static inline constexpr float EXPRESSION_SECONDS = 0.01f;  ///< Time constant of the gain and cutoff
+
+    static_assert(MAX_TONES <= TONE_STRIDE);
+
+    enum class OscillatorType
+    {
+        Sine,
+        Saw,
+        Square,
+        Triangle,
+        SineWithHarmonics
+    };
+
+    VoicePool() {
+        this->oscillator_types.fill(OscillatorType::SineWithHarmonics);
+        this->onset_gains.fill(1.0f);
+        this->expression_gains.fill(1.0f);
+        this->gain_targets.fill(1.0f);
+        this->cutoffs.fill(CUTOFF);
+        this->cutoff_targets.fill(CUTOFF);
+    }
+
+    /**
+     * @brief Sets up the state shared by all voices, and silences every slot.
+     */
+    void prepare(double sample_rate);
+
+    /**
+     * @brief Silences one voice, and snaps its tones to their current pitch.
+     */
+    void reset(size_t voice);
+
+    /**
+     * @brief How many of the voice's tones are in use. Only those are rendered.
+     */
+    void set_num_tones(size_t voice, size_t n) {
+        this->num_tones[voice] = std::min(n, MAX_TONES);
+        this->partials_dirty = true;
+    }
+    size_t get_num_tones(size_t voice) const { return this->num_tones[voice]; }
+
+    /**
+     * @brief Slides the tone to a new frequency, over GLIDE_SECONDS.
+     */
+    void set_frequency(size_t voice, size_t tone, float hz);
+
+    /**
+     * @brief Holds the tone silent, with its phase and glide paused, for the next delay samples the
+     * voice renders, then fades it in. 0 starts it straight away, with the voice. Call after
+     * set_frequency, when starting a note.
+     */
+    void set_onset(size_t voice, size_t tone, int delay);
+
+    /**
+     * @brief Where the voice's gain (a factor on its level) and low-pass cutoff (in Hz) should go.
+     * A sounding voice moves there over about EXPRESSION_SECONDS; an idle one jumps there.
+     */
+    void set_expression(size_t voice, float gain, float cutoff);
+
+    void set_oscillator_type(size_t voice, OscillatorType t) {
+        this->partials_dirty |= t != this->oscillator_types[voice];
+        this->oscillator_types[voice] = t;
+    }
+    OscillatorType get_oscillator_type(size_t voice) const { return this->oscillator_types[voice]; }
+
+    void set_phaser_enabled(size_t voice, bool enabled) { this->phaser_enabled[voice] = enabled; }
+
+    void set_partial_sharing(bool enabled) {
+        this->partials_dirty |= enabled != this->partial_sharing;
+        this->partial_sharing = enabled;
+    }
+    bool is_partial_sharing() const { return this->partial_sharing; }
+
+    /**
+     * @brief Distinct oscillators computed in the last shared render(out, num_samples).
+     */
+    size_t get_num_shared_partials() const { return this->num_partials; }
+
+    /**
+     * @brief Whether the voice's note is held. Released voices keep sounding until their envelope ends.
+     */
+    void set_held(size_t voice, bool h) {
+        this->held[voice] = h;
+        this->fading[voice] = false;
+        this->partials_dirty = true;
+    }
+    bool is_held(size_t voice) const { return this->held[voice]; }
+
+    bool is_active(size_t voice) const { return this->held[voice] || this->envelopes[voice].isActive(); }
+
+    /**
+     * @brief Releases the voice over FADE_SECONDS, to free it without a click.
+     */
+    void fade_out(size_t voice);
+    bool is_fading(size_t voice) const { return this->fading[voice] && this->is_active(voice); }
+
+    /**
+     * @brief How audible stealing the voice would be, in O(1) from its envelope: 0 for idle or
+     * fading voices, then released voices by level (deepest in release first), then held voices by
+     * level. Always under 2.
+     */
+    float get_steal_cost(size_t voice) const {
+        if (!this->is_active(voice) || this->fading[voice]) {
+            return 0.0f;
+        }
+        return this->levels[voice] + (this->held[voice] ? 1.0f : 0.0f);
+    }
+
+    juce::ADSR& get_envelope(size_t voice) { return this->envelopes[voice]; }
+    MonoPhaser& get_phaser(size_t voice) { return this->phasers[voice]; }
+
+    /**
+     * @brief Adds num_samples of one voice to out.
+     */
+    void render(size_t voice, float* out, int num_samples);
+
+    /**
+     * @brief Adds num_samples of every active voice to out, in slot order, sharing partials if enabled.
+     */
+    void render(float* out, int num_samples);
+
+private:
+    void render_one(size_t voice, float* out, int num_samples);
+    void render_all(float* out, int num_samples);
+
+    /**
+     * @brief The next num_samples of one tone's waveform, into bus.
+     */
+    void render_oscillator(size_t tone, OscillatorType type, float* bus, int num_samples);
+
+    template <typename ToneSource>
+    void render_voice(size_t voice, float* out, int num_samples, ToneSource&& next_tone);
+
+    template <size_t TONES, typename ToneSource>
+    void render_tones(size_t voice, float* out, int num_samples, ToneSource& next_tone);
+
+    /**
+     * @brief Steps the voice's gain and cutoff towards their targets, for the next num_samples.
+     */
+    void update_controls(size_t voice, int num_samples);
+
+    /**
+     * @brief The voice's filter coefficients for a cutoff, without allocating.
+     */
+    void set_lowpass(size_t voice, float cutoff);
+
+    // Tones are indexed voice * TONE_STRIDE + tone
+    bool is_same_oscillator(size_t a, size_t b) const;
+    void copy_oscillator(size_t from, size_t to);
+    /**
+     * @brief Finds which tones compute the same partial. O(tones x partials), so only run when
+     * partials_dirty.
+     */
+    void group_partials();
+
+    inline float next_frequency(size_t i) {
+        // Linear, like juce::SmoothedValue
+        if (this->glide_left[i] <= 0) {
+            return this->targets[i];
+        }
+        --this->glide_left[i];
+        this->frequencies[i] = this->glide_left[i] > 0 ? this->frequencies[i] + this->glide_steps[i] : this->targets[i];
+        return this->frequencies[i];
+    }
+
+    static inline constexpr std::array<float, 4> HARMONIC_WEIGHTS { 0.8f, 0.16f, 0.032f, 0.008f };
+    static inline constexpr std::array<float, 4> HARMONIC_FACTORS { 1.0f, 2.0f, 4.0f, 8.0f };
+
+    /**
+     * @brief Replaces each t, in [-pi, pi), with the waveform at t.
+     */
+    void shape(OscillatorType type, float* t, int num_samples) const;
+
+    float sample_rate { 44100.0f };
+    int glide_length { 0 };     ///< In samples
+    float onset_step { 1.0f };  ///< Fade-in per sample after an onset
+    float expression_rate { 1.0f }; ///< Share of the gap to its target the expression closes per sample
+    float clip { 0.6f };        ///< Pre-gain clipping value for the waveform
+    float gain { 0.1f };        // TODO parameterize
+
+    // Oscillators, [voice][tone]
+    alignas(64) std::array<float, MAX_VOICES * TONE_STRIDE> phases {};        ///< In [0, 2pi)
+    alignas(64) std::array<float, MAX_VOICES * TONE_STRIDE> frequencies {};   ///< Current, in Hz
+    alignas(64) std::array<float, MAX_VOICES * TONE_STRIDE> targets {};       ///< Where the glide ends, in Hz
+    alignas(64) std::array<float, MAX_VOICES * TONE_STRIDE> glide_steps {};   ///< Hz per sample
+    alignas(64) std::array<int, MAX_VOICES * TONE_STRIDE> glide_left {};      ///< Samples
+    alignas(64) std::array<int, MAX_VOICES * TONE_STRIDE> onset_left {};      ///< Samples until the tone starts
+    alignas(64) std::array<float, MAX_VOICES * TONE_STRIDE> onset_gains {};   ///< Fade-in since the onset, to 1
+
+    // Per voice
+    alignas(64) std::array<size_t, MAX_VOICES> num_tones {};
+    alignas(64) std::array<float, MAX_VOICES> filter_s1 {};    ///< Low-pass state, transposed direct form II
+    alignas(64) std::array<float, MAX_VOICES> filter_s2 {};
+    alignas(64) std::array<float, MAX_VOICES> levels {};       ///< Envelope after the last rendered sample
+    alignas(64) std::array<float, MAX_VOICES> expression_gains {};
+    alignas(64) std::array<float, MAX_VOICES> gain_targets {};
+    alignas(64) std::array<float, MAX_VOICES> gain_steps {};   ///< Per sample, over the current chunk
+    alignas(64) std::array<float, MAX_VOICES> cutoffs {};      ///< In Hz
+    alignas(64) std::array<float, MAX_VOICES> cutoff_targets {};
+    alignas(64) std::array<int, MAX_VOICES> cutoff_countdowns {};  ///< Samples until the cutoff may move again
+    std::array<std::array<float, 5>, MAX_VOICES> filter_coefficients {};   ///< b0, b1, b2, a1, a2
+    std::array<OscillatorType, MAX_VOICES> oscillator_types {};
+    std::array<bool, MAX_VOICES> held {};
+    std::array<bool, MAX_VOICES> fading {};
+    std::array<bool, MAX_VOICES> phaser_enabled {};
+    std::array<juce::ADSR, MAX_VOICES> envelopes {};
+    std::array<MonoPhaser, MAX_VOICES> phasers {};
+
+    std::array<float, 5> neutral_coefficients {};   ///< At CUTOFF, from juce::dsp::IIR
+
+    // Partial sharing
+    bool partial_sharing { false };
+    bool partials_dirty { true };   ///< Tones changed since group_partials() last ran
+    size_t num_partials { 0 };
+    std::array<uint16_t, MAX_VOICES * MAX_TONES> partial_leaders {};  ///< The tone computing each partial
+    std::array<uint16_t, MAX_VOICES * TONE_STRIDE> partial_of {};     ///< Each tone's partial
+    alignas(64) std::array<float, MAX_VOICES * MAX_TONES * SHARED_CHUNK> partial_bus {};
+    std::array<bool, MAX_VOICES> rendering {};  ///< Voices active at the start of the block
+
+    alignas(64) std::array<float, MAX_TONES * SHARED_CHUNK> tone_bus {};    ///< One voice's tones, unshared
+};
+
+} // namespace jnickg::audio::ws
@@ -12,82 +12,140 @@ void Voice::startNote (int midiNoteNumber, float velocity, juce::SynthesiserSoun
         return;
     }
 
-    note_info n(midiNoteNumber);
-
-    auto chords_in_key = get_chords(n, key, true);
-    // Filter out chords that don't sound so good
-    std::vector<chord_info> good_chords;
-    std::copy_if(chords_in_key.begin(), chords_in_key.end(), std::back_inserter(good_chords), [](const chord_info& c) {
-        #pragma clang diagnostic push
-        #pragma clang diagnostic ignored "-Wswitch-enum"
-        switch (c.chord_type) {
-            case chord::_unison:
-            case chord::_5:
-            case chord::_maj:
-            case chord::_min:
-            case chord::_7:
-            case chord::_maj7:
-            case chord::_min7:
-            case chord::_11:
-            case chord::_min11:
-            case chord::_maj11:
-                return true;
-            default:
-                return false;
-        }
-        #pragma clang diagnostic pop
-    });
+    // Everything below runs on the audio thread, so chords come from the prebuilt table
+    auto max_tones = this->max_chord_tones;
+    auto num_choices = this->chords->count(midiNoteNumber, max_tones);
     // Fallback to the struck note if we couldn't find a good chord
-    auto found_chord = true;
-    if (good_chords.empty()) {
-        auto& unison = good_chords.emplace_back();
-        unison.root = n;
-        unison.chord_type = chord::_unison;
-        unison.inv = inversion::root;
-        found_chord = false;
+    auto found_chord = num_choices > 0;
+    ChordTable::Choice unison;
+    if (!found_chord) {
+        unison.chord.root = note_info(midiNoteNumber);
+        unison.chord.chord_type = chord::_unison;
+        unison.chord.inv = inversion::root;
+        unison.midi_notes[0] = midiNoteNumber;
+        unison.size = 1;
     }
     // Next step, do something with circle of fifths to filter out chords that should not be played
     // For now, just pick a random chord
-    auto idx = static_cast<size_t>(std::rand() % static_cast<int>(good_chords.size()));
-    jnickg::audio::chord_info& current_chord = good_chords[idx];
-    auto chord_str = current_chord.to_string(true, true);
-    printf("Note %s -> Playing chord: %s%s\n", n.to_string().c_str(), chord_str.c_str(), !found_chord ? " (fallback)" : "");
-    auto midi_notes = current_chord.get_midi_notes();
+    const auto& current_chord = found_chord
+        ? this->chords->get(midiNoteNumber, max_tones, static_cast<size_t>(this->random.nextInt(static_cast<int>(num_choices))))
+        : unison;
+    if (this->trace_chords) {
+        ChordLog::Record record;
+        record.ticks = juce::Time::getHighResolutionTicks();
+        record.voice = this->index;
+        record.midi_note = midiNoteNumber;
+        record.chord = current_chord.chord;
+        record.fallback = !found_chord;
+        this->log.push(record);
+    }
 
-    std::vector<double> new_bases;
-    for (auto note : midi_notes) {
-        new_bases.push_back(juce::MidiMessage::getMidiNoteInHertz(note));
+    this->num_chord_tones = current_chord.size;
+    this->pool.set_num_tones(this->slot(), current_chord.size);
+    for (size_t i = 0; i < current_chord.size; ++i) {
+        this->chord_bases[i] = juce::MidiMessage::getMidiNoteInHertz(current_chord.midi_notes[i]);
     }
-    auto bend = this->pitch_wheel_pos_to_bend_factor(currentPitchWheelPosition);
-    this->update_pitches(new_bases, bend);
+    // juce doesn't say which channel the note is on, only whether it's a given one
+    this->channel = MpeZone::MASTER_CHANNEL;
+    for (int c = 1; c <= MpeZone::NUM_CHANNELS; ++c) {
+        if (this->isPlayingChannel(c)) {
+            this->channel = c;
+            break;
+        }
+    }
+    if (this->mpe.is_enabled()) {
+        this->apply_expression();
+    } else {
+        auto bend = this->pitch_wheel_pos_to_bend_factor(currentPitchWheelPosition);
+        this->update_pitches(bend);
+        this->pool.set_expression(this->slot(), 1.0f, VoicePool::CUTOFF);
+    }
+    this->schedule_onsets(current_chord);
 
-    auto params = this->adsr.getParameters();
+    this->echo.trigger(current_chord.midi_notes.data(), current_chord.size, velocity);
+
+    auto& envelope = this->pool.get_envelope(this->slot());
+    auto params = envelope.getParameters();
     params.attack = velocity_to_attack(velocity);
-    this->adsr.setParameters(params);
-    this->adsr.noteOn();
+    envelope.setParameters(params);
+    envelope.noteOn();
+
+    this->pool.set_held(this->slot(), true);
+}
 
-    this->isActive = true;
+void Voice::schedule_onsets(const ChordTable::Choice& chord) {
+    // Tones by pitch, lowest first, then in strum order
+    std::array<size_t, MAX_CHORD_TONES> order {};
+    for (size_t i = 0; i < chord.size; ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(chord.size), [&chord](size_t a, size_t b) {
+        return chord.midi_notes[a] < chord.midi_notes[b];
+    });
+    if (this->strum_spacing > 0) {
+        switch (this->strum_order) {
+            case StrumOrder::down:
+                std::reverse(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(chord.size));
+                break;
+            case StrumOrder::random:
+                for (auto i = chord.size; i > 1; --i) {
+                    std::swap(order[i - 1], order[static_cast<size_t>(this->random.nextInt(static_cast<int>(i)))]);
+                }
+                break;
+            case StrumOrder::up:
+            case StrumOrder::__COUNT:
+            default:
+                break;
+        }
+    }
+    // Always, so nothing pending from a strum this voice was stolen from carries over
+    for (size_t k = 0; k < chord.size; ++k) {
+        this->pool.set_onset(this->slot(), order[k], static_cast<int>(k) * this->strum_spacing);
+    }
 }
 
 void Voice::stopNote (float velocity, bool allowTailOff) {
     juce::ignoreUnused(allowTailOff);
 
-    auto params = this->adsr.getParameters();
+    auto& envelope = this->pool.get_envelope(this->slot());
+    auto params = envelope.getParameters();
     params.release = velocity_to_release(velocity);
-    this->adsr.setParameters(params);
-    this->adsr.noteOff();
+    envelope.setParameters(params);
+    envelope.noteOff();
 
-    this->isActive = false;
+    this->pool.set_held(this->slot(), false);
 }
 
 void Voice::pitchWheelMoved (int newPitchWheelValue) {
+    if (this->mpe.is_enabled()) {
+        this->apply_expression();
+        return;
+    }
     auto bend = this->pitch_wheel_pos_to_bend_factor(newPitchWheelValue);
-    this->update_pitches(std::nullopt, bend);
+    this->update_pitches(bend);
 }
 
 void Voice::controllerMoved (int controllerNumber, int newControllerValue) {
-    juce::ignoreUnused(controllerNumber);
     juce::ignoreUnused(newControllerValue);
+    if (this->mpe.is_enabled() && controllerNumber == MpeZone::TIMBRE_CONTROLLER) {
+        this->apply_expression();
+    }
+}
+
+void Voice::channelPressureChanged (int newChannelPressureValue) {
+    juce::ignoreUnused(newChannelPressureValue);
+    if (this->mpe.is_enabled()) {
+        this->apply_expression();
+    }
+}
+
+void Voice::apply_expression() {
+    // The Synth has already put the new value in the MpeZone
+    auto expression = this->mpe.get_expression(this->channel);
+    this->update_pitches(static_cast<double>(fastmath::semitones_to_ratio(expression.bend)));
+    auto gain = 1.0f + PRESSURE_GAIN * expression.pressure;
+    auto cutoff = VoicePool::CUTOFF * fastmath::exp2(TIMBRE_OCTAVES * expression.timbre);
+    this->pool.set_expression(this->slot(), gain, cutoff);
 }
 
 void Voice::renderNextBlock (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) {
@@ -96,54 +154,171 @@ void Voice::renderNextBlock (juce::AudioBuffer<float>& outputBuffer, int startSa
     if (numSamples == 0) {
         return;
     }
+    this->pool.render(this->slot(), outputBuffer.getWritePointer(0, startSample), numSamples);
+}
+
+void Voice::prepareToPlay(double sampleRate, int samplesPerBlock, int outputChannels) {
+    juce::ignoreUnused(samplesPerBlock, outputChannels);
+
+    this->pool.reset(this->slot());
+
+    auto& envelope = this->pool.get_envelope(this->slot());
+    envelope.setSampleRate(sampleRate);
+    juce::ADSR::Parameters params;
+    params.attack = DEFAULT_ATTACK;
+    params.decay = DEFAULT_DECAY;
+    params.sustain = DEFAULT_SUSTAIN;
+    params.release = DEFAULT_RELEASE;
+    envelope.setParameters(params);
+
+    // Cheaper than the global phaser: fewer stages, and only one channel
+    MonoPhaser::Parameters phaser_params;
+    phaser_params.stages = 4; // TODO parameterize
+    phaser_params.rate = 0.3f; // TODO parameterize
+    phaser_params.feedback = 0.5f; // TODO parameterize
+    phaser_params.mix = 0.5f; // TODO parameterize
+    auto& phaser = this->pool.get_phaser(this->slot());
+    phaser.set_parameters(phaser_params);
+    phaser.prepare(sampleRate);
+
+    this->isPrepared = true;
+}
 
-    if (!this->is_active()) {
+void Synth::handlePitchWheel (int midiChannel, int wheelValue) {
+    this->mpe.set_pitch_wheel(midiChannel, wheelValue);
+    juce::Synthesiser::handlePitchWheel(midiChannel, wheelValue);
+    if (!this->mpe.is_enabled() || !MpeZone::is_master(midiChannel)) {
         return;
     }
+    // The master channel bends the whole zone, not only its own notes
+    for (int i = 0; i < this->voices.size(); ++i) {
+        auto* voice = this->voices.getUnchecked(i);
+        if (voice->getCurrentlyPlayingNote() >= 0 && !voice->isPlayingChannel(midiChannel)) {
+            voice->pitchWheelMoved(wheelValue);
+        }
+    }
+}
+
+void Synth::handleController (int midiChannel, int controllerNumber, int controllerValue) {
+    if (controllerNumber == MpeZone::TIMBRE_CONTROLLER) {
+        this->mpe.set_timbre(midiChannel, controllerValue);
+    }
+    juce::Synthesiser::handleController(midiChannel, controllerNumber, controllerValue);
+}
+
+void Synth::handleChannelPressure (int midiChannel, int channelPressureValue) {
+    this->mpe.set_pressure(midiChannel, channelPressureValue);
+    juce::Synthesiser::handleChannelPressure(midiChannel, channelPressureValue);
+}
+
+int Synth::find_least_audible(size_t n) const {
+    // Keep the lowest and highest held notes (the bass line and the melody), as JUCE's default does
+    auto lowest = 128;
+    auto highest = -1;
+    for (size_t i = 0; i < n; ++i) {
+        if (this->pool.is_held(i)) {
+            auto note = this->voices.getUnchecked(static_cast<int>(i))->getCurrentlyPlayingNote();
+            lowest = std::min(lowest, note);
+            highest = std::max(highest, note);
+        }
+    }
 
-    for (int sample = startSample; sample < startSample + numSamples; ++sample) {
-        for (size_t i = 0; i < this->chord_bases.size(); ++i) {
-            auto osc_sample = this->chord_oscillators[i]->processSample(0.0f);
-            osc_sample *= this->adsr.getNextSample();
-            osc_sample *= this->gain.getGainLinear();
-            osc_sample = this->filter.processSample(osc_sample);
-            outputBuffer.addSample(0, sample, osc_sample);
+    auto best = -1;
+    auto best_cost = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        if (!this->pool.is_active(i) || this->pool.is_fading(i)) {
+            continue;
+        }
+        auto cost = this->pool.get_steal_cost(i);
+        auto note = this->voices.getUnchecked(static_cast<int>(i))->getCurrentlyPlayingNote();
+        if (this->pool.is_held(i) && lowest < highest && (note == lowest || note == highest)) {
+            cost += 2.0f;
+        }
+        if (best < 0 || cost < best_cost) {
+            best = static_cast<int>(i);
+            best_cost = cost;
         }
     }
+    return best;
 }
 
-void Voice::prepareToPlay(double sampleRate, int samplesPerBlock, int outputChannels, float bpm) {
-    juce::dsp::ProcessSpec spec;
-    spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = static_cast<juce::uint32>(samplesPerBlock);
-    spec.numChannels = static_cast<juce::uint32>(outputChannels);
+void Synth::set_voice_limits(size_t max, size_t c) {
+    this->max_voices = std::clamp<size_t>(max, 1, VoicePool::MAX_VOICES);
+    this->ceiling = std::max<size_t>(c, 1);
 
-    for (auto& osc : this->chord_oscillators) {
-        osc->prepare(spec);
+    size_t shed = 0;
+    for (int i = 0; i < this->voices.size(); ++i) {
+        auto slot = static_cast<size_t>(i);
+        static_cast<Voice*>(this->voices.getUnchecked(i))->finish_if_silent();
+        if (slot >= this->max_voices && this->pool.is_active(slot) && !this->pool.is_fading(slot)) {
+            this->pool.fade_out(slot);
+            ++shed;
+        }
     }
 
-    this->gain.prepare(spec);
-    this->gain.setGainLinear(0.1f); // TODO parameterize
+    auto n = this->get_num_usable_voices();
+    for (auto sounding = this->count_sounding_voices(n); sounding > this->ceiling; --sounding) {
+        auto voice = this->find_least_audible(n);
+        if (voice < 0) {
+            break;
+        }
+        this->pool.fade_out(static_cast<size_t>(voice));
+        ++shed;
+    }
 
-    this->filter.coefficients = juce::dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, 500.0f); // TODO parameterize
-    this->filter.reset();
-    this->filter.prepare(spec);
+    if (shed > 0) {
+        this->voices_shed.store(this->voices_shed.load(std::memory_order_relaxed) + shed, std::memory_order_relaxed);
+    }
+}
 
-    this->adsr.setSampleRate(sampleRate);
-    juce::ADSR::Parameters params;
-    params.attack = DEFAULT_ATTACK;
-    params.decay = DEFAULT_DECAY;
-    params.sustain = DEFAULT_SUSTAIN;
-    params.release = DEFAULT_RELEASE;
-    this->adsr.setParameters(params);
+size_t Synth::count_sounding_voices(size_t n) const {
+    n = std::min(n, static_cast<size_t>(this->voices.size()));
+    size_t sounding = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sounding += this->pool.is_active(i) && !this->pool.is_fading(i) ? 1 : 0;
+    }
+    return sounding;
+}
 
-    this->_bpm = bpm;
+bool Synth::is_sounding() const {
+    for (size_t i = 0; i < static_cast<size_t>(this->voices.size()); ++i) {
+        if (this->pool.is_active(i)) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    //
-    //
-    //
+juce::SynthesiserVoice* Synth::findFreeVoice (juce::SynthesiserSound* sound, int midiChannel, int midiNoteNumber, bool stealIfNoneAvailable) const {
+    auto n = this->get_num_usable_voices();
+    size_t sounding = 0;
+    juce::SynthesiserVoice* free = nullptr;
+    for (size_t i = 0; i < n; ++i) {
+        auto* voice = this->voices.getUnchecked(static_cast<int>(i));
+        if (this->pool.is_active(i)) {
+            sounding += this->pool.is_fading(i) ? 0 : 1;
+        } else if (free == nullptr && voice->canPlaySound(sound)) {
+            free = voice;
+        }
+    }
+    if (free != nullptr && sounding < this->ceiling) {
+        return free;
+    }
+    return stealIfNoneAvailable ? this->findVoiceToSteal(sound, midiChannel, midiNoteNumber) : nullptr;
+}
 
-    this->isPrepared = true;
+juce::SynthesiserVoice* Synth::findVoiceToSteal (juce::SynthesiserSound* sound, int midiChannel, int midiNoteNumber) const {
+    auto n = this->get_num_usable_voices();
+    // A voice already fading out costs nothing, and one ringing on the same note is the natural one to retrigger
+    for (size_t i = 0; i < n; ++i) {
+        auto* voice = this->voices.getUnchecked(static_cast<int>(i));
+        if (voice->canPlaySound(sound) && (this->pool.is_fading(i)
+            || (voice->getCurrentlyPlayingNote() == midiNoteNumber && voice->isPlayingChannel(midiChannel)))) {
+            return voice;
+        }
+    }
+    auto best = this->find_least_audible(n);
+    return best >= 0 ? this->voices.getUnchecked(best) : nullptr;
 }
 
 } // namespace jnickg::audio::ws
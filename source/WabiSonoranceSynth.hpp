@@ -5,12 +5,25 @@
 #include <juce_dsp/juce_dsp.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <optional>
+#include <stdexcept>
+#include <string>
 #include <unordered_map>
 #include <memory>
 
+#include "ChordLog.hpp"
+#include "ChordTable.hpp"
+#include "EchoEngine.hpp"
+#include "FastMath.hpp"
+#include "Mpe.hpp"
 #include "NotesKeys.hpp"
+#include "Phaser.hpp"
+#include "Profiler.hpp"
+#include "VoicePool.hpp"
 
 namespace jnickg::audio::ws {
 
@@ -33,23 +46,64 @@ public:
     }
 };
 
+/**
+ * @brief Which chord tone a strum starts from.
+ */
+enum class StrumOrder
+{
+    __FIRST = 0,
+    up = __FIRST,   ///< Lowest tone first
+    down,           ///< Highest tone first
+    random,         ///< A new order on every note
+    __COUNT
+};
+
+inline std::string to_string(StrumOrder o) {
+    switch (o) {
+        case StrumOrder::up: return "Up";
+        case StrumOrder::down: return "Down";
+        case StrumOrder::random: return "Random";
+        case StrumOrder::__COUNT:
+        default: throw std::runtime_error("Invalid strum order");
+    }
+}
+
 /**
  * @brief A voice for the WabiSonoranceSynth.
+ *
+ * Picks a chord on each note-on and drives its slot of the VoicePool, which holds everything the
+ * render loop touches. Chords can be strummed: each tone's onset is scheduled in the pool, to the
+ * sample, when the note starts.
+ *
+ * With MPE on, the whole chord follows its note's channel: pitch bend moves its pitch, pressure
+ * its gain and timbre (CC74) its filter cutoff, through the pool's control-rate expression.
  */
 class Voice : public juce::SynthesiserVoice
 {
-    jnickg::audio::key_info& key;
+    const ChordTable* chords;
+    EchoEngine& echo;
+    ChordLog& log;
+    VoicePool& pool;
+    const MpeZone& mpe;
+    int index;
 public:
     inline static const float DEFAULT_ATTACK { 2.0f };
     inline static const float DEFAULT_DECAY { 1.0f };
     inline static const float DEFAULT_SUSTAIN { 0.8f };
     inline static const float DEFAULT_RELEASE { 4.0f };
 
-    Voice(jnickg::audio::key_info& k)
-        : key(k)
-        , filter()
+    static inline constexpr float PRESSURE_GAIN = 1.0f;    ///< Gain added at full pressure, i.e. up to +6dB
+    static inline constexpr float TIMBRE_OCTAVES = 3.0f;   ///< Cutoff range either side of VoicePool::CUTOFF
+
+    Voice(const ChordTable& c, EchoEngine& e, ChordLog& l, VoicePool& p, const MpeZone& m, int i)
+        : chords(&c)
+        , echo(e)
+        , log(l)
+        , pool(p)
+        , mpe(m)
+        , index(i)
     {
-        // no-op
+        jassert(static_cast<size_t>(i) < VoicePool::MAX_VOICES);
     }
     ~Voice() override {}
 
@@ -58,6 +112,20 @@ public:
         return sound != nullptr;
     }
 
+    /**
+     * @brief Sounding, including the release tail.
+     */
+    bool isVoiceActive() const override { return this->pool.is_active(this->slot()); }
+
+    /**
+     * @brief Frees the voice for new notes once its release has ended.
+     */
+    void finish_if_silent() {
+        if (this->getCurrentlyPlayingNote() >= 0 && !this->pool.is_active(this->slot())) {
+            this->clearCurrentNote();
+        }
+    }
+
     virtual void startNote (
         int midiNoteNumber,
         float velocity,
@@ -70,115 +138,106 @@ public:
 
     virtual void controllerMoved (int controllerNumber, int newControllerValue) override;
 
+    virtual void channelPressureChanged (int newChannelPressureValue) override;
+
     virtual void renderNextBlock (
         juce::AudioBuffer<float>& outputBuffer,
         int startSample,
         int numSamples) override;
 
-    void prepareToPlay(double sampleRate, int samplesPerBlock, int outputChannels, float bpm);
-
-private:
-    using osc_t = juce::dsp::Oscillator<float>;
-    enum class OscillatorType
-    {
-        Sine,
-        Saw,
-        Square,
-        Triangle,
-        SineWithHarmonics
-    };
-
-    OscillatorType selected_osc { OscillatorType::SineWithHarmonics };
-
-    float clip { 0.6f }; ///< Pre-gain clipping value for the waveform.
-
-    float sine_wave_with_harmonics(float t, std::vector<float> harmonic_weights) const {
-        auto val = 0.0f;
-        // We assume harmonic weights add to one and DO NOT CHECK THAT HERE
-        for (size_t i = 0; i < harmonic_weights.size(); ++i) {
-            float factor = std::pow(2.0f, static_cast<float>(i));
-            val += harmonic_weights[i] * std::sin(factor * t);
-        }
-        return std::clamp(val, -clip, clip);
+    /**
+     * @brief Prepares this voice's slot. Call after VoicePool::prepare.
+     */
+    void prepareToPlay(double sampleRate, int samplesPerBlock, int outputChannels);
+
+    /**
+     * @brief Enables this voice's own phaser (see PluginProcessor::PhaserMode::PerVoice).
+     */
+    void set_phaser_enabled(bool enabled) { this->pool.set_phaser_enabled(this->slot(), enabled); }
+
+    /**
+     * @brief Offsets this voice's phaser LFO, in cycles, relative to the other voices.
+     */
+    void set_phaser_phase_offset(float offset) {
+        auto& phaser = this->pool.get_phaser(this->slot());
+        phaser.set_phase_offset(offset);
+        phaser.reset();
     }
 
-    float sine_wave(float t) const{
-        auto val = std::sin(t);
-        return std::clamp(val, -clip, clip);
-    }
+    using OscillatorType = VoicePool::OscillatorType;
 
-    float saw_wave(float t) const{
-        auto val = t / juce::MathConstants<float>::pi;
-        return std::clamp(val, -clip, clip);
-    }
+    void set_oscillator_type(OscillatorType t) { this->pool.set_oscillator_type(this->slot(), t); }
+    OscillatorType get_oscillator_type() const { return this->pool.get_oscillator_type(this->slot()); }
 
-    float square_wave(float t) const{
-        auto val = t < 0.0f ? -1.0f : 1.0f;
-        return std::clamp(val, -clip, clip);
-    }
+    static inline constexpr size_t MAX_CHORD_TONES = ChordTable::MAX_TONES;
 
-    float triangle_wave(float t) const{
-        auto val = 2.0f * std::abs(t - std::round(t)) - 1.0f;
-        return std::clamp(val, -clip, clip);
-    }
+    /**
+     * @brief Limits the chords picked in startNote to at most this many tones.
+     */
+    void set_max_chord_tones(size_t n) { this->max_chord_tones = std::clamp<size_t>(n, 1, MAX_CHORD_TONES); }
+    size_t get_max_chord_tones() const { return this->max_chord_tones; }
 
-    float custom_wave(float t) const {
-        switch(selected_osc) {
-            case OscillatorType::Sine:
-                return this->sine_wave(t);
-            case OscillatorType::SineWithHarmonics:
-                return this->sine_wave_with_harmonics(t, {0.8f, 0.16f, 0.032f, 0.008f});
-            case OscillatorType::Saw:
-                return this->saw_wave(t);
-            case OscillatorType::Square:
-                return this->square_wave(t);
-            case OscillatorType::Triangle:
-                return this->triangle_wave(t);
-            default:
-                return 0.0f;
-        }
+    /**
+     * @brief Staggers the tones of the chords startNote plays by spacing samples each, starting
+     * from the tone order picks. 0 starts them together.
+     */
+    void set_strum(int spacing, StrumOrder order) {
+        this->strum_spacing = std::max(spacing, 0);
+        this->strum_order = order;
     }
 
-    std::vector<std::shared_ptr<osc_t>> chord_oscillators = {
-        std::make_shared<osc_t>([this](float t){ return this->custom_wave(t); }),
-        std::make_shared<osc_t>([this](float t){ return this->custom_wave(t); }),
-        std::make_shared<osc_t>([this](float t){ return this->custom_wave(t); }),
-        std::make_shared<osc_t>([this](float t){ return this->custom_wave(t); }),
-        std::make_shared<osc_t>([this](float t){ return this->custom_wave(t); }),
-        std::make_shared<osc_t>([this](float t){ return this->custom_wave(t); }),
-        std::make_shared<osc_t>([this](float t){ return this->custom_wave(t); }),
-        std::make_shared<osc_t>([this](float t){ return this->custom_wave(t); }),
-        std::make_shared<osc_t>([this](float t){ return this->custom_wave(t); }),
-        std::make_shared<osc_t>([this](float t){ return this->custom_wave(t); }),
-        std::make_shared<osc_t>([this](float t){ return this->custom_wave(t); })
-    };
+    /**
+     * @brief Switches the table startNote picks chords from, e.g. on a key change. The table must
+     * outlive its use; notes already playing keep their chord.
+     */
+    void set_chords(const ChordTable& c) { this->chords = &c; }
+
+    /**
+     * @brief Logs each chord startNote picks to the ChordLog.
+     */
+    void set_chord_trace_enabled(bool enabled) { this->trace_chords = enabled; }
+
+    /**
+     * @brief Reseeds the random chord choices, so the same notes pick the same chords again.
+     */
+    void set_seed(juce::int64 seed) { this->random.setSeed(seed); }
+
+private:
+    size_t max_chord_tones { MAX_CHORD_TONES };
+    bool trace_chords { true };
+    juce::Random random;    ///< Per voice, unlike std::rand, so instances don't disturb each other
+
+    std::array<double, MAX_CHORD_TONES> chord_bases {};
+    size_t num_chord_tones { 0 };
 
-    std::vector<double> chord_bases;
+    int strum_spacing { 0 };    ///< Samples between tone onsets
+    StrumOrder strum_order { StrumOrder::up };
 
-    juce::dsp::IIR::Filter<float> filter;
-    juce::dsp::Gain<float> gain;
-    juce::ADSR adsr;
+    /**
+     * @brief Schedules the onsets of the chord's tones in the pool, per the strum settings.
+     */
+    void schedule_onsets(const ChordTable::Choice& chord);
 
     double pitch_bend { 1.0 }; ///< Factor by which to bend the pitch.
-    float _bpm { 120.0f };
+
+    int channel { MpeZone::MASTER_CHANNEL };   ///< The MIDI channel of the note playing
+
+    /**
+     * @brief Bends, and sets the pool's gain and cutoff for, the note's channel in the MpeZone.
+     */
+    void apply_expression();
 
     bool isPrepared { false };
-    bool isActive { false };
 
-    inline bool is_active() const {
-        return this->isActive || this->adsr.isActive();
-    }
+    inline size_t slot() const { return static_cast<size_t>(this->index); }
 
-    void update_pitches(std::optional<std::vector<double>> bases = std::nullopt, std::optional<double> bend = std::nullopt) {
-        if (bases) {
-            this->chord_bases = *bases;
-        }
+    void update_pitches(std::optional<double> bend = std::nullopt) {
         if (bend) {
             this->pitch_bend = *bend;
         }
-        for (size_t i = 0; i < this->chord_oscillators.size(); ++i) {
+        for (size_t i = 0; i < this->num_chord_tones; ++i) {
             auto freq = this->chord_bases[i] * this->pitch_bend;
-            this->chord_oscillators[i]->setFrequency(static_cast<float>(freq));
+            this->pool.set_frequency(this->slot(), i, static_cast<float>(freq));
         }
     }
 
@@ -186,8 +245,8 @@ private:
         // pitch wheel value is a 14-bit value, allowing for 16,384 possible values
         // We want to map this to a range of +- 2 semitones
         auto semitones = 2.0 *  std::clamp(static_cast<double>(pos) / 16384.0, -1.0, 1.0);
-        auto bend = std::pow(2.0, semitones / 12.0);
-        return bend;
+        auto bend = fastmath::semitones_to_ratio(static_cast<float>(semitones));
+        return static_cast<double>(bend);
     }
 
     inline float velocity_to_attack(float velocity) const {
@@ -207,4 +266,122 @@ private:
     }
 };
 
+/**
+ * @brief The synthesiser that drives WabiSonorance voices.
+ *
+ * Tells the EchoEngine where in the block each MIDI event lands, so that echoes scheduled by
+ * Voice::startNote line up with the note-on to the sample. Also reports MIDI handling and the
+ * voices' rendering to the Profiler, and note-ons/offs and voice renders to its Tracer.
+ *
+ * All voices render in one sweep of the VoicePool. Only without partial sharing, on the blocks the
+ * Profiler samples each voice's time (see Profiler::is_voice_block()) and while tracing, are they
+ * rendered one at a time.
+ *
+ * Polyphony can change at runtime: all voices are created up front, and set_voice_limits() picks
+ * how many are used and how many may sound at once. Voices are stolen, and shed when over the
+ * limits, by how little it would be heard (see VoicePool::get_steal_cost()).
+ *
+ * Every channel's pitch bend, pressure and timbre go into the MpeZone as they arrive; juce's
+ * per-channel routing then tells the voices playing that channel, which read it back when MPE is
+ * on. The master channel's pitch bend goes to every voice.
+ */
+class Synth : public juce::Synthesiser
+{
+    EchoEngine& echo;
+    Profiler& profiler;
+    VoicePool& pool;
+    MpeZone& mpe;
+    size_t max_voices { VoicePool::MAX_VOICES };
+    size_t ceiling { VoicePool::MAX_VOICES };
+    std::atomic<uint64_t> voices_shed { 0 };
+
+    size_t get_num_usable_voices() const { return std::min(this->max_voices, static_cast<size_t>(this->voices.size())); }
+
+    // The voice among the first n sounding ones that would be missed least, or -1
+    int find_least_audible(size_t n) const;
+public:
+    Synth(EchoEngine& e, Profiler& p, VoicePool& vp, MpeZone& m)
+        : echo(e)
+        , profiler(p)
+        , pool(vp)
+        , mpe(m)
+    {
+        // no-op
+    }
+
+    void noteOn (int midiChannel, int midiNoteNumber, float velocity) override {
+        Tracer::Scope trace(this->profiler.get_tracer(), "noteOn", midiNoteNumber);
+        juce::Synthesiser::noteOn(midiChannel, midiNoteNumber, velocity);
+    }
+
+    void noteOff (int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff) override {
+        Tracer::Scope trace(this->profiler.get_tracer(), "noteOff", midiNoteNumber);
+        juce::Synthesiser::noteOff(midiChannel, midiNoteNumber, velocity, allowTailOff);
+    }
+
+    void handlePitchWheel (int midiChannel, int wheelValue) override;
+    void handleController (int midiChannel, int controllerNumber, int controllerValue) override;
+    void handleChannelPressure (int midiChannel, int channelPressureValue) override;
+
+    /**
+     * @brief Uses only the first max_voices voices, and lets at most ceiling of them sound. Fades out
+     * the least audible voices over either limit. Call from the audio thread, before rendering.
+     */
+    void set_voice_limits(size_t max_voices, size_t ceiling);
+
+    /**
+     * @brief Voices sounding and not being faded out, among the first max_voices.
+     */
+    size_t count_sounding_voices(size_t max_voices) const;
+
+    /**
+     * @brief Whether any voice is sounding, including ones being faded out.
+     */
+    bool is_sounding() const;
+
+    /**
+     * @brief Voices faded out to stay within the limits, so far. Safe to read from any thread.
+     */
+    uint64_t get_voices_shed() const { return this->voices_shed.load(std::memory_order_relaxed); }
+
+protected:
+    juce::SynthesiserVoice* findFreeVoice (juce::SynthesiserSound* sound, int midiChannel, int midiNoteNumber, bool stealIfNoneAvailable) const override;
+    juce::SynthesiserVoice* findVoiceToSteal (juce::SynthesiserSound* sound, int midiChannel, int midiNoteNumber) const override;
+
+    void handleMidiEvent (const juce::MidiMessage& m) override {
+        Profiler::ScopedStage stage(this->profiler, Stage::midi);
+        // juce::Synthesiser stamps each message with its sample position within the block
+        this->echo.set_block_position(static_cast<int>(m.getTimeStamp()));
+        juce::Synthesiser::handleMidiEvent(m);
+    }
+
+    void renderVoices (juce::AudioBuffer<float>& buffer, int startSample, int numSamples) override {
+        auto profiling = this->profiler.is_voice_block();
+        auto* tracer = this->profiler.get_tracer();
+        auto tracing = tracer != nullptr && tracer->is_recording();
+        // Shared partials can't be pinned on one voice, and rendering voices one at a time would unshare them
+        if ((!profiling && !tracing) || this->pool.is_partial_sharing()) {
+            // Same as the loop below, without the per-voice timing; voices only write the first channel
+            Profiler::ScopedStage stage(this->profiler, Stage::voices);
+            this->pool.render(buffer.getWritePointer(0, startSample), numSamples);
+            return;
+        }
+        // Same as juce::Synthesiser::renderVoices, with each voice timed
+        Profiler::ScopedStage stage(this->profiler, Stage::voices);
+        for (int i = 0; i < this->voices.size(); ++i) {
+            auto* voice = this->voices.getUnchecked(i);
+            auto voice_start = Profiler::clock::now();
+            voice->renderNextBlock(buffer, startSample, numSamples);
+            auto voice_end = Profiler::clock::now();
+            if (profiling) {
+                this->profiler.add_voice(static_cast<size_t>(i), std::chrono::duration_cast<std::chrono::nanoseconds>(voice_end - voice_start).count());
+            }
+            // Idle voices would only fill the trace with empty slices
+            if (tracing && voice->isVoiceActive()) {
+                tracer->record("renderNextBlock", voice_start, voice_end, i);
+            }
+        }
+    }
+};
+
 } // namespace jnickg::audio::ws
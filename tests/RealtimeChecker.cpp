@@ -0,0 +1,327 @@
+#include "helpers/realtime_checker.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+    #define REALTIME_CHECKER_SYSTEM_HOOKS 1
+    #include <dlfcn.h>
+    #include <pthread.h>
+    #include <sched.h>
+    #include <time.h>
+    #include <unistd.h>
+#else
+    #define REALTIME_CHECKER_SYSTEM_HOOKS 0
+    #if defined(_MSC_VER)
+        #include <malloc.h>
+    #endif
+#endif
+
+namespace {
+
+// Plain data, so that touching it from inside malloc never allocates
+struct ThreadState {
+    bool active;
+    realtime_checker::Report report;
+};
+thread_local ThreadState state {};
+
+inline void count_allocation() {
+    if (state.active) {
+        ++state.report.allocations;
+    }
+}
+
+inline void count_deallocation(const void* p) {
+    if (state.active && p != nullptr) {
+        ++state.report.deallocations;
+    }
+}
+
+inline void count_syscall() {
+    if (state.active) {
+        ++state.report.syscalls;
+    }
+}
+
+} // namespace
+
+namespace realtime_checker {
+
+bool has_system_hooks() {
+    return REALTIME_CHECKER_SYSTEM_HOOKS != 0;
+}
+
+ScopedAudioThread::ScopedAudioThread() {
+    state.report = {};
+    state.active = true;
+}
+
+ScopedAudioThread::~ScopedAudioThread() {
+    state.active = false;
+}
+
+Report ScopedAudioThread::get_report() const {
+    return state.report;
+}
+
+} // namespace realtime_checker
+
+//==============================================================================
+// malloc and friends. glibc exports its allocator under these names too, so forwarding to them
+// never recurses.
+#if REALTIME_CHECKER_SYSTEM_HOOKS
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void __libc_free(void* p);
+
+void* malloc(size_t size) noexcept {
+    count_allocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+    count_allocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* p, size_t size) noexcept {
+    count_allocation();
+    count_deallocation(p);
+    return __libc_realloc(p, size);
+}
+
+void free(void* p) noexcept {
+    count_deallocation(p);
+    __libc_free(p);
+}
+} // extern "C"
+#endif
+
+//==============================================================================
+// operator new/delete. With glibc these skip the malloc hooks above, so each allocation counts once.
+namespace {
+
+void* raw_alloc(size_t size) {
+#if REALTIME_CHECKER_SYSTEM_HOOKS
+    return __libc_malloc(size == 0 ? 1 : size);
+#else
+    return std::malloc(size == 0 ? 1 : size);
+#endif
+}
+
+void* raw_aligned_alloc(size_t size, std::align_val_t al) {
+    auto alignment = static_cast<size_t>(al);
+    size = (size + alignment - 1) / alignment * alignment;
+#if defined(_MSC_VER)
+    return _aligned_malloc(size == 0 ? alignment : size, alignment);
+#else
+    return std::aligned_alloc(alignment, size == 0 ? alignment : size);
+#endif
+}
+
+void raw_free(void* p) {
+#if REALTIME_CHECKER_SYSTEM_HOOKS
+    __libc_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void raw_aligned_free(void* p) {
+#if defined(_MSC_VER)
+    _aligned_free(p);
+#else
+    raw_free(p);
+#endif
+}
+
+void* counted_new(size_t size) {
+    count_allocation();
+    if (auto* p = raw_alloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc {};
+}
+
+void* counted_aligned_new(size_t size, std::align_val_t al) {
+    count_allocation();
+    if (auto* p = raw_aligned_alloc(size, al)) {
+        return p;
+    }
+    throw std::bad_alloc {};
+}
+
+void counted_delete(void* p) {
+    count_deallocation(p);
+    raw_free(p);
+}
+
+void counted_aligned_delete(void* p) {
+    count_deallocation(p);
+    raw_aligned_free(p);
+}
+
+} // namespace
+
+void* operator new(size_t size) { return counted_new(size); }
+void* operator new[](size_t size) { return counted_new(size); }
+void* operator new(size_t size, std::align_val_t al) { return counted_aligned_new(size, al); }
+void* operator new[](size_t size, std::align_val_t al) { return counted_aligned_new(size, al); }
+
+void operator delete(void* p) noexcept { counted_delete(p); }
+void operator delete[](void* p) noexcept { counted_delete(p); }
+void operator delete(void* p, size_t) noexcept { counted_delete(p); }
+void operator delete[](void* p, size_t) noexcept { counted_delete(p); }
+void operator delete(void* p, std::align_val_t) noexcept { counted_aligned_delete(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { counted_aligned_delete(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { counted_aligned_delete(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { counted_aligned_delete(p); }
+
+//==============================================================================
+// Locks, stdio and syscalls. These forward to the next definition in link order, i.e. libc's.
+#if REALTIME_CHECKER_SYSTEM_HOOKS
+namespace {
+
+template <typename Fn>
+Fn next(Fn& cached, const char* name) {
+    if (cached == nullptr) {
+        cached = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+    }
+    return cached;
+}
+
+using mutex_fn = int (*)(pthread_mutex_t*);
+using puts_fn = int (*)(const char*);
+using fputs_fn = int (*)(const char*, FILE*);
+using fwrite_fn = size_t (*)(const void*, size_t, size_t, FILE*);
+using write_fn = ssize_t (*)(int, const void*, size_t);
+using read_fn = ssize_t (*)(int, void*, size_t);
+using nanosleep_fn = int (*)(const timespec*, timespec*);
+using usleep_fn = int (*)(useconds_t);
+using yield_fn = int (*)();
+
+mutex_fn next_mutex_lock = nullptr;
+mutex_fn next_mutex_trylock = nullptr;
+puts_fn next_puts = nullptr;
+fputs_fn next_fputs = nullptr;
+fwrite_fn next_fwrite = nullptr;
+write_fn next_write = nullptr;
+read_fn next_read = nullptr;
+nanosleep_fn next_nanosleep = nullptr;
+usleep_fn next_usleep = nullptr;
+yield_fn next_sched_yield = nullptr;
+
+// Resolve everything up front, as dlsym itself may allocate
+[[maybe_unused]] const bool resolved = [] {
+    next(next_mutex_lock, "pthread_mutex_lock");
+    next(next_mutex_trylock, "pthread_mutex_trylock");
+    next(next_puts, "puts");
+    next(next_fputs, "fputs");
+    next(next_fwrite, "fwrite");
+    next(next_write, "write");
+    next(next_read, "read");
+    next(next_nanosleep, "nanosleep");
+    next(next_usleep, "usleep");
+    next(next_sched_yield, "sched_yield");
+    return true;
+}();
+
+} // namespace
+
+extern "C" {
+
+int pthread_mutex_lock(pthread_mutex_t* m) noexcept {
+    if (state.active) {
+        ++state.report.locks;
+        if (next(next_mutex_trylock, "pthread_mutex_trylock")(m) == 0) {
+            return 0;
+        }
+        ++state.report.contended_locks;
+    }
+    return next(next_mutex_lock, "pthread_mutex_lock")(m);
+}
+
+int printf(const char* format, ...) {
+    count_syscall();
+    va_list args;
+    va_start(args, format);
+    auto result = vprintf(format, args);
+    va_end(args);
+    return result;
+}
+
+// What printf becomes with _FORTIFY_SOURCE
+int __printf_chk(int, const char* format, ...) {
+    count_syscall();
+    va_list args;
+    va_start(args, format);
+    auto result = vprintf(format, args);
+    va_end(args);
+    return result;
+}
+
+int fprintf(FILE* stream, const char* format, ...) {
+    count_syscall();
+    va_list args;
+    va_start(args, format);
+    auto result = vfprintf(stream, format, args);
+    va_end(args);
+    return result;
+}
+
+int __fprintf_chk(FILE* stream, int, const char* format, ...) {
+    count_syscall();
+    va_list args;
+    va_start(args, format);
+    auto result = vfprintf(stream, format, args);
+    va_end(args);
+    return result;
+}
+
+int puts(const char* s) {
+    count_syscall();
+    return next(next_puts, "puts")(s);
+}
+
+int fputs(const char* s, FILE* stream) {
+    count_syscall();
+    return next(next_fputs, "fputs")(s, stream);
+}
+
+size_t fwrite(const void* data, size_t size, size_t count, FILE* stream) {
+    count_syscall();
+    return next(next_fwrite, "fwrite")(data, size, count, stream);
+}
+
+ssize_t write(int fd, const void* data, size_t size) {
+    count_syscall();
+    return next(next_write, "write")(fd, data, size);
+}
+
+ssize_t read(int fd, void* data, size_t size) {
+    count_syscall();
+    return next(next_read, "read")(fd, data, size);
+}
+
+int nanosleep(const timespec* duration, timespec* remaining) {
+    count_syscall();
+    return next(next_nanosleep, "nanosleep")(duration, remaining);
+}
+
+int usleep(useconds_t usec) {
+    count_syscall();
+    return next(next_usleep, "usleep")(usec);
+}
+
+int sched_yield() noexcept {
+    count_syscall();
+    return next(next_sched_yield, "sched_yield")();
+}
+
+} // extern "C"
+#endif
@@ -0,0 +1,79 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <ChordLog.hpp>
+
+#include "helpers/realtime_checker.h"
+
+using jnickg::audio::ws::ChordLog;
+using namespace jnickg::audio;
+
+namespace {
+
+ChordLog::Record make_record(int voice, int midi_note) {
+    ChordLog::Record r;
+    r.ticks = juce::Time::getHighResolutionTicks();
+    r.voice = voice;
+    r.midi_note = midi_note;
+    r.chord = chord_info { note_info(midi_note), chord::_min, inversion::root };
+    return r;
+}
+
+} // namespace
+
+TEST_CASE("jnickg::audio::ws::ChordLog") {
+    auto trace = juce::TemporaryFile(".log");
+    ChordLog log;
+    log.set_output_file(trace.getFile());
+
+    SECTION("writes one line per record, in order") {
+        REQUIRE(log.push(make_record(3, 57)));
+        REQUIRE(log.push(make_record(4, 60)));
+        log.flush();
+
+        auto lines = juce::StringArray::fromLines(trace.getFile().loadFileAsString().trim());
+        REQUIRE(lines.size() == 2);
+        REQUIRE(lines[0].contains("voice  3"));
+        REQUIRE(lines[0].contains("Note A3 -> Playing chord: A3"));
+        REQUIRE(lines[1].contains("voice  4"));
+    }
+
+    SECTION("drops and counts records when the ring is full") {
+        for (int i = 0; i < ChordLog::CAPACITY; ++i) {
+            REQUIRE(log.push(make_record(0, 57)));
+        }
+        REQUIRE_FALSE(log.push(make_record(0, 57)));
+        REQUIRE(log.get_dropped() == 1);
+
+        log.flush();
+        auto lines = juce::StringArray::fromLines(trace.getFile().loadFileAsString().trim());
+        REQUIRE(lines.size() == ChordLog::CAPACITY + 1);
+        REQUIRE(lines[ChordLog::CAPACITY] == "1 chord log records dropped");
+
+        // Room again once drained
+        REQUIRE(log.push(make_record(0, 57)));
+    }
+
+    SECTION("drains on its own thread") {
+        log.start();
+        REQUIRE(log.push(make_record(1, 64)));
+        auto deadline = juce::Time::getMillisecondCounter() + 2000;
+        while (trace.getFile().getSize() == 0 && juce::Time::getMillisecondCounter() < deadline) {
+            juce::Thread::sleep(ChordLog::DRAIN_INTERVAL_MS);
+        }
+        log.stop();
+        REQUIRE(trace.getFile().loadFileAsString().contains("voice  1"));
+    }
+
+    SECTION("push is real-time safe") {
+        auto record = make_record(2, 69);
+        realtime_checker::Report report;
+        {
+            realtime_checker::ScopedAudioThread audio_thread;
+            for (int i = 0; i < 100; ++i) {
+                log.push(record);
+            }
+            report = audio_thread.get_report();
+        }
+        REQUIRE(report.is_realtime_safe());
+    }
+}
@@ -0,0 +1,98 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <ChordTable.hpp>
+
+#include <thread>
+#include <vector>
+
+#include "helpers/realtime_checker.h"
+
+using jnickg::audio::ws::ChordTable;
+using namespace jnickg::audio;
+
+TEST_CASE("jnickg::audio::ws::ChordTable") {
+    auto key = key_info { note::A, scale::yonanuki };
+    ChordTable table;
+    table.build(key);
+    REQUIRE(table.is_built_for(key));
+    REQUIRE_FALSE(table.is_built_for(key_info { note::C, scale::major }));
+
+    SECTION("only offers playable, in-key chords on in-key notes") {
+        for (int m = 0; m < ChordTable::NUM_NOTES; ++m) {
+            auto count = table.count(m, ChordTable::MAX_TONES);
+            if (!key.contains_note(note_info(m).n)) {
+                REQUIRE(count == 0);
+                continue;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                const auto& choice = table.get(m, ChordTable::MAX_TONES, i);
+                REQUIRE(choice.chord.root.to_midi() == m);
+                REQUIRE(ChordTable::is_playable(choice.chord.chord_type));
+                REQUIRE(chord_fits_key(choice.chord, key));
+                REQUIRE(choice.size == choice.chord.get_midi_notes().size());
+            }
+        }
+        REQUIRE(table.count(57, ChordTable::MAX_TONES) > 0);
+    }
+
+    SECTION("matches the chord search it replaces") {
+        for (int m : { 45, 57, 60, 64, 69 }) {
+            size_t expected = 0;
+            for (const auto& c : get_chords(note_info(m), key, true)) {
+                if (ChordTable::is_playable(c.chord_type)) {
+                    ++expected;
+                }
+            }
+            REQUIRE(table.count(m, ChordTable::MAX_TONES) == expected);
+        }
+    }
+
+    SECTION("limits chords to max_tones") {
+        for (size_t max_tones = 1; max_tones <= ChordTable::MAX_TONES; ++max_tones) {
+            auto count = table.count(57, max_tones);
+            for (size_t i = 0; i < count; ++i) {
+                REQUIRE(table.get(57, max_tones, i).size <= max_tones);
+            }
+        }
+    }
+
+    SECTION("has nothing for notes outside the chord search's range") {
+        REQUIRE(table.count(-1, ChordTable::MAX_TONES) == 0);
+        REQUIRE(table.count(9, ChordTable::MAX_TONES) == 0);
+        REQUIRE(table.count(128, ChordTable::MAX_TONES) == 0);
+    }
+
+    SECTION("tables built for the same key share one copy, across threads") {
+        ChordTable other_key;
+        other_key.build(key_info { note::C, scale::major });
+        std::vector<ChordTable> tables(4);
+        std::vector<std::thread> threads;
+        for (auto& t : tables) {
+            threads.emplace_back([&t, key] { t.build(key); });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        for (const auto& t : tables) {
+            REQUIRE(&t.get(57, ChordTable::MAX_TONES, 0) == &table.get(57, ChordTable::MAX_TONES, 0));
+        }
+        REQUIRE(&other_key.get(60, ChordTable::MAX_TONES, 0) != &table.get(57, ChordTable::MAX_TONES, 0));
+    }
+
+    SECTION("lookups don't allocate") {
+        realtime_checker::Report report;
+        size_t total = 0;
+        {
+            realtime_checker::ScopedAudioThread audio_thread;
+            for (int m = 0; m < ChordTable::NUM_NOTES; ++m) {
+                auto count = table.count(m, 3);
+                for (size_t i = 0; i < count; ++i) {
+                    total += table.get(m, 3, i).size;
+                }
+            }
+            report = audio_thread.get_report();
+        }
+        REQUIRE(total > 0);
+        REQUIRE(report.is_realtime_safe());
+    }
+}
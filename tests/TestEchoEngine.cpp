@@ -0,0 +1,129 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include <EchoEngine.hpp>
+
+#include "helpers/test_helpers.h"
+
+using jnickg::audio::ws::EchoEngine;
+
+TEST_CASE("jnickg::audio::ws::EchoEngine") {
+    constexpr double sample_rate = 48000.0;
+    constexpr int block_size = 256;
+
+    auto key = jnickg::audio::key_info {
+        jnickg::audio::note::A,
+        jnickg::audio::scale::yonanuki
+    };
+
+    EchoEngine echo;
+    echo.prepare(sample_rate, key);
+    echo.set_bpm(120.0);
+
+    juce::AudioBuffer<float> buffer(2, block_size);
+
+    SECTION("is silent until the first repeat is due") {
+        int chord[] = { 57, 60, 64 };
+        REQUIRE(echo.is_idle());
+        echo.trigger(chord, 3, 1.0f);
+        REQUIRE(echo.pending_events() > 0);
+        REQUIRE_FALSE(echo.is_idle());
+
+        // One beat at 120bpm is 24000 samples
+        auto first_repeat = static_cast<int>(sample_rate / 2.0);
+        auto rendered = 0;
+        while (rendered + block_size <= first_repeat) {
+            buffer.clear();
+            echo.render(buffer, 0, block_size);
+            REQUIRE(buffer.getMagnitude(0, 0, block_size) == 0.0f);
+            rendered += block_size;
+        }
+
+        buffer.clear();
+        echo.render(buffer, 0, block_size);
+        auto offset = first_repeat - rendered;
+        REQUIRE(buffer.getMagnitude(0, 0, offset) == 0.0f);
+        REQUIRE(echo.active_voices() == 3);
+    }
+
+    SECTION("fires on the sample it was triggered on, one beat later") {
+        constexpr int note_on = 100;
+        int note[] = { 57 };
+        echo.set_block_position(note_on);
+        echo.trigger(note, 1, 1.0f);
+
+        auto due = note_on + static_cast<int>(sample_rate / 2.0);
+        auto rendered = 0;
+        while (rendered + block_size <= due) {
+            buffer.clear();
+            echo.render(buffer, 0, block_size);
+            rendered += block_size;
+        }
+        buffer.clear();
+        echo.render(buffer, 0, block_size);
+
+        // The oscillator starts at phase zero, so the first non-zero sample follows the onset
+        auto offset = due - rendered;
+        REQUIRE(buffer.getMagnitude(0, 0, offset + 1) == 0.0f);
+        REQUIRE(buffer.getMagnitude(0, offset + 1, 1) > 0.0f);
+    }
+
+    SECTION("dense trails stay within the preallocated pools") {
+        int chord[] = { 45, 57, 60, 64, 67 };
+        for (int i = 0; i < 1000; ++i) {
+            echo.set_block_position(i % block_size);
+            echo.trigger(chord, 5, 1.0f);
+            REQUIRE(echo.pending_events() <= EchoEngine::MAX_EVENTS);
+
+            buffer.clear();
+            echo.render(buffer, 0, block_size);
+            REQUIRE(echo.active_voices() <= EchoEngine::MAX_VOICES);
+        }
+    }
+
+    SECTION("a stolen voice fades out instead of clicking") {
+        auto params = echo.get_parameters();
+        params.repeats = 1;
+        params.decay_seconds = 10.0f;
+        echo.set_parameters(params);
+
+        // Fill the voice bank a sample apart, then fire one more a while later so it steals the
+        // first (quietest) voice mid-cycle
+        int note[] = { 33 };
+        for (int i = 0; i < static_cast<int>(EchoEngine::MAX_VOICES); ++i) {
+            echo.set_block_position(i);
+            echo.trigger(note, 1, 1.0f);
+        }
+        echo.set_block_position(100);
+        echo.trigger(note, 1, 1.0f);
+
+        auto max_step = 0.0f;
+        auto previous = 0.0f;
+        for (int b = 0; b < static_cast<int>(sample_rate) / block_size; ++b) {
+            buffer.clear();
+            echo.render(buffer, 0, block_size);
+            for (int i = 0; i < block_size; ++i) {
+                auto x = buffer.getSample(0, i);
+                max_step = std::max(max_step, std::abs(x - previous));
+                previous = x;
+            }
+        }
+        REQUIRE(echo.active_voices() == EchoEngine::MAX_VOICES);
+        REQUIRE(echo.shedding_voices() == 0);
+
+        // Twenty-four in-phase voices at 44Hz move by under 0.02 per sample. Cutting one off
+        // ~100 samples into its cycle would jump by ~0.04.
+        REQUIRE(max_step < 0.025f);
+    }
+
+    SECTION("reset() clears all pending echoes") {
+        int chord[] = { 57, 60, 64 };
+        echo.trigger(chord, 3, 1.0f);
+        echo.reset();
+        REQUIRE(echo.pending_events() == 0);
+        REQUIRE(echo.active_voices() == 0);
+        REQUIRE(echo.is_idle());
+    }
+}
@@ -0,0 +1,76 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <FastMath.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace fastmath = jnickg::audio::ws::fastmath;
+
+namespace {
+
+/**
+ * @brief Worst difference from the double-precision reference over [lo, hi], sampled densely.
+ */
+template <typename Fast, typename Reference>
+double max_error(Fast fast, Reference reference, double lo, double hi, bool relative = false) {
+    constexpr int steps = 1'000'000;
+    auto worst = 0.0;
+    for (int i = 0; i <= steps; ++i) {
+        auto x = static_cast<float>(lo + (hi - lo) * i / steps);
+        auto expected = reference(static_cast<double>(x));
+        auto error = std::abs(static_cast<double>(fast(x)) - expected);
+        worst = std::max(worst, relative ? error / std::abs(expected) : error);
+    }
+    return worst;
+}
+
+} // namespace
+
+TEST_CASE("jnickg::audio::ws::fastmath") {
+    constexpr double pi = 3.14159265358979323846;
+
+    SECTION("sin_half_pi is within 2e-7 of sin on [-pi/2, pi/2]") {
+        auto e = max_error(fastmath::sin_half_pi, [](double x) { return std::sin(x); }, -pi / 2, pi / 2);
+        INFO(e);
+        REQUIRE(e < 2e-7);
+    }
+
+    SECTION("sin is within 2.5e-7 of sin on [-256 pi, 256 pi]") {
+        auto e = max_error(fastmath::sin, [](double x) { return std::sin(x); }, -256 * pi, 256 * pi);
+        INFO(e);
+        REQUIRE(e < 2.5e-7);
+
+        // Where the reduction and the fold meet
+        for (auto x : { 0.0f, fastmath::HALF_PI, fastmath::PI, -fastmath::PI, fastmath::TWO_PI, 3.0f * fastmath::PI }) {
+            INFO(x);
+            REQUIRE(std::abs(fastmath::sin(x) - std::sin(static_cast<double>(x))) < 2.5e-7);
+        }
+    }
+
+    SECTION("exp2 is within 2.5e-7 of 2^x, relatively, on [-126, 126]") {
+        auto e = max_error(fastmath::exp2, [](double x) { return std::exp2(x); }, -126.0, 126.0, true);
+        INFO(e);
+        REQUIRE(e < 2.5e-7);
+        for (int i = -126; i <= 126; ++i) {
+            REQUIRE(fastmath::exp2(static_cast<float>(i)) == std::ldexp(1.0f, i));
+        }
+        REQUIRE(std::isfinite(fastmath::exp2(1000.0f)));
+        REQUIRE(fastmath::exp2(-1000.0f) > 0.0f);
+    }
+
+    SECTION("semitones_to_ratio covers the pitch wheel's range") {
+        auto e = max_error(fastmath::semitones_to_ratio, [](double s) { return std::exp2(s / 12.0); }, -24.0, 24.0, true);
+        INFO(e);
+        REQUIRE(e < 2.5e-7);
+    }
+
+    SECTION("tanh is within 5e-7 of tanh, and saturates") {
+        auto e = max_error(fastmath::tanh, [](double x) { return std::tanh(x); }, -20.0, 20.0);
+        INFO(e);
+        REQUIRE(e < 5e-7);
+        REQUIRE(fastmath::tanh(0.0f) == 0.0f);
+        REQUIRE(fastmath::tanh(50.0f) == 1.0f);
+        REQUIRE(fastmath::tanh(-50.0f) == -1.0f);
+    }
+}
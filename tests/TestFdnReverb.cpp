@@ -0,0 +1,142 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <FdnReverb.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "helpers/test_helpers.h"
+
+using jnickg::audio::ws::FdnReverb;
+
+namespace {
+
+constexpr double sample_rate = 48000.0;
+
+float peak(const std::vector<float>& v, size_t from, size_t to) {
+    auto p = 0.0f;
+    for (size_t i = from; i < to; ++i) {
+        p = std::max(p, std::abs(v[i]));
+    }
+    return p;
+}
+
+void prepare(FdnReverb& reverb, FdnReverb::Quality quality) {
+    FdnReverb::Parameters params;
+    params.decay_seconds = 2.0f;
+    params.dry_level = 0.0f;
+    params.quality = quality;
+    reverb.set_parameters(params);
+    reverb.prepare({ sample_rate, 512, 2 });
+}
+
+} // namespace
+
+TEST_CASE("jnickg::audio::ws::FdnReverb") {
+    const auto qualities = {
+        FdnReverb::Quality::Eco,
+        FdnReverb::Quality::Standard,
+        FdnReverb::Quality::High,
+    };
+    auto length = static_cast<size_t>(sample_rate * 3.0);
+
+    SECTION("impulse produces a tail on both channels, decaying ~60dB over decay_seconds") {
+        for (auto quality : qualities) {
+            FdnReverb reverb;
+            prepare(reverb, quality);
+
+            std::vector<float> left(length, 0.0f);
+            std::vector<float> right(length, 0.0f);
+            left[0] = 1.0f;
+            right[0] = 1.0f;
+            reverb.process(left.data(), right.data(), static_cast<int>(length));
+
+            REQUIRE(peak(left, 1, 24000) > 0.0f);
+            REQUIRE(peak(right, 1, 24000) > 0.0f);
+
+            auto early = peak(left, 0, 9600);
+            auto late = peak(left, 96000, 105600);
+            REQUIRE(std::isfinite(late));
+            REQUIRE(late < early * 0.01f);
+        }
+    }
+
+    SECTION("reset() silences the tail") {
+        for (auto quality : qualities) {
+            FdnReverb reverb;
+            prepare(reverb, quality);
+
+            std::vector<float> noise(4096);
+            for (size_t i = 0; i < noise.size(); ++i) {
+                noise[i] = std::sin(static_cast<float>(i) * 0.1f);
+            }
+            reverb.process(noise.data(), nullptr, static_cast<int>(noise.size()));
+            reverb.reset();
+
+            std::vector<float> silence(4096, 0.0f);
+            reverb.process(silence.data(), nullptr, static_cast<int>(silence.size()));
+            REQUIRE(peak(silence, 0, silence.size()) == 0.0f);
+        }
+    }
+
+    SECTION("lines brought back by a quality change start out silent") {
+        FdnReverb reverb;
+        prepare(reverb, FdnReverb::Quality::High);
+        std::vector<float> noise(4096);
+        for (size_t i = 0; i < noise.size(); ++i) {
+            noise[i] = std::sin(static_cast<float>(i) * 0.1f);
+        }
+        reverb.process(noise.data(), nullptr, static_cast<int>(noise.size()));
+
+        // Long enough for the 8 lines still in use to ring out
+        auto params = reverb.get_parameters();
+        params.quality = FdnReverb::Quality::Standard;
+        reverb.set_parameters(params);
+        std::vector<float> silence(length);
+        for (int i = 0; i < 2; ++i) {
+            std::fill(silence.begin(), silence.end(), 0.0f);
+            reverb.process(silence.data(), nullptr, static_cast<int>(silence.size()));
+        }
+
+        params.quality = FdnReverb::Quality::High;
+        reverb.set_parameters(params);
+        std::vector<float> block(64);
+        for (size_t i = 0; i < length; i += block.size()) {
+            std::fill(block.begin(), block.end(), 0.0f);
+            reverb.process(block.data(), nullptr, static_cast<int>(block.size()));
+            REQUIRE(peak(block, 0, block.size()) < 1.0e-6f);
+        }
+        REQUIRE(reverb.get_num_lines() == FdnReverb::MAX_LINES);
+    }
+
+    SECTION("clears returning lines a slice per block, then runs them") {
+        FdnReverb reverb;
+        prepare(reverb, FdnReverb::Quality::Standard);
+        REQUIRE(reverb.get_num_lines() == 8);
+
+        auto params = reverb.get_parameters();
+        params.quality = FdnReverb::Quality::High;
+        reverb.set_parameters(params);
+        REQUIRE(reverb.get_num_lines() == 8);
+
+        std::vector<float> block(64, 0.0f);
+        auto blocks = 0;
+        while (reverb.get_num_lines() != FdnReverb::MAX_LINES && blocks < 1000) {
+            reverb.process(block.data(), nullptr, static_cast<int>(block.size()));
+            ++blocks;
+        }
+        REQUIRE(reverb.get_num_lines() == FdnReverb::MAX_LINES);
+        REQUIRE(blocks > 1);
+
+        // Going back down is immediate
+        params.quality = FdnReverb::Quality::Eco;
+        reverb.set_parameters(params);
+        REQUIRE(reverb.get_num_lines() == 8);
+    }
+
+    SECTION("reports its tail length from any thread") {
+        FdnReverb reverb;
+        prepare(reverb, FdnReverb::Quality::Eco);
+        REQUIRE(reverb.get_tail_length_seconds() == 2.0);
+    }
+}
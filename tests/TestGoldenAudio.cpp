@@ -0,0 +1,267 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <OfflineRenderer.hpp>
+#include <PluginProcessor.h>
+
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+/*
+ * Renders fixed MIDI scenarios with a fixed seed, and null-tests them against the reference WAVs in
+ * tests/golden: the reference minus the render has to stay within a tolerance. A scenario with no
+ * reference is skipped (or fails, with WABISONORANCE_REQUIRE_GOLDEN=1), never recorded on the fly:
+ * a reference has to come from a build known to sound right.
+ *
+ * Each scenario's render speed can also be checked against the baseline in
+ * tests/golden/cpu_budgets.json. Timings are too noisy to share the machine with a parallel ctest
+ * run, so that test is hidden, and only runs when asked for by its tag: `Tests "[budget]"`.
+ *
+ * After an intended change in sound or speed, run the tests with WABISONORANCE_UPDATE_GOLDEN=1 to
+ * re-record the references and the baseline, and commit them.
+ */
+
+#ifndef GOLDEN_AUDIO_DIR
+#define GOLDEN_AUDIO_DIR "tests/golden"
+#endif
+
+namespace offline = jnickg::audio::ws::offline;
+
+namespace {
+
+constexpr double SAMPLE_RATE = 48000.0;
+constexpr int BLOCK_SIZE = 256;
+constexpr double TAIL_SECONDS = 0.5;
+
+constexpr float MAX_PEAK_DIFFERENCE = 1.0e-4f;  ///< -80 dBFS
+constexpr double MAX_RESIDUAL_DB = -80.0;       ///< Energy of the difference, relative to the reference
+
+constexpr double DEFAULT_CPU_TOLERANCE = 1.25;  ///< Slowdown over the baseline that still passes
+constexpr int CPU_RUNS = 3;                     ///< Best of, to ride out scheduler noise
+
+struct Scenario {
+    const char* name;
+    std::function<juce::MidiMessageSequence()> midi;
+    std::function<void(PluginProcessor&)> configure;
+};
+
+void add_note(juce::MidiMessageSequence& sequence, int note, double on, double off, float velocity = 0.8f) {
+    sequence.addEvent(juce::MidiMessage::noteOn(1, note, velocity), on);
+    sequence.addEvent(juce::MidiMessage::noteOff(1, note), off);
+}
+
+juce::MidiMessageSequence cluster() {
+    juce::MidiMessageSequence sequence;
+    for (auto note : { 48, 52, 55, 57, 60, 64, 67, 69 }) {
+        add_note(sequence, note, 0.0, 1.0, 0.6f);
+    }
+    sequence.updateMatchedPairs();
+    return sequence;
+}
+
+std::vector<Scenario> get_scenarios() {
+    using OscillatorType = jnickg::audio::ws::Voice::OscillatorType;
+    return {
+        { "single_note",
+          [] {
+              juce::MidiMessageSequence sequence;
+              add_note(sequence, 57, 0.0, 1.0);
+              sequence.updateMatchedPairs();
+              return sequence;
+          },
+          nullptr },
+        { "chord_cluster", cluster, nullptr },
+        { "retrigger_storm",
+          [] {
+              // More notes than voices, so voices get stolen mid-release
+              juce::MidiMessageSequence sequence;
+              for (int i = 0; i < 40; ++i) {
+                  auto on = 0.025 * i;
+                  add_note(sequence, 45 + (i * 7) % 36, on, on + 0.02, 0.3f + 0.015f * static_cast<float>(i));
+              }
+              sequence.updateMatchedPairs();
+              return sequence;
+          },
+          nullptr },
+        { "pitch_bend_sweep",
+          [] {
+              juce::MidiMessageSequence sequence;
+              add_note(sequence, 60, 0.0, 1.0);
+              for (int i = 0; i <= 50; ++i) {
+                  auto position = static_cast<int>(8192.0 + 8191.0 * std::sin(juce::MathConstants<double>::twoPi * i / 50.0));
+                  sequence.addEvent(juce::MidiMessage::pitchWheel(1, position), 0.02 * i);
+              }
+              sequence.updateMatchedPairs();
+              return sequence;
+          },
+          nullptr },
+        { "per_voice_phaser_saw",
+          cluster,
+          [](PluginProcessor& p) {
+              p.set_phaser_mode(PluginProcessor::PhaserMode::PerVoice);
+              p.set_oscillator_type(OscillatorType::Saw);
+          } },
+        { "eco_reverb_three_tones",
+          cluster,
+          [](PluginProcessor& p) {
+              p.set_reverb_quality(jnickg::audio::ws::FdnReverb::Quality::Eco);
+              p.set_max_chord_tones(3);
+          } },
+    };
+}
+
+offline::Result render(const Scenario& scenario) {
+    offline::Options options;
+    options.sample_rate = SAMPLE_RATE;
+    options.block_size = BLOCK_SIZE;
+    options.seed = 1;
+    options.bpm = 120.0;
+    options.tail_seconds = TAIL_SECONDS;
+    options.configure = scenario.configure;
+    return offline::render(scenario.midi(), options);
+}
+
+juce::File get_golden_dir() {
+    return juce::File::getCurrentWorkingDirectory().getChildFile(GOLDEN_AUDIO_DIR);
+}
+
+bool is_updating() {
+    return juce::SystemStats::getEnvironmentVariable("WABISONORANCE_UPDATE_GOLDEN", {}) == "1";
+}
+
+/**
+ * @brief Whether a missing reference fails the test instead of skipping it, e.g. in CI once the
+ * references are committed.
+ */
+bool is_required() {
+    return juce::SystemStats::getEnvironmentVariable("WABISONORANCE_REQUIRE_GOLDEN", {}) == "1";
+}
+
+std::unique_ptr<juce::AudioBuffer<float>> read_wav(const juce::File& file) {
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatReader> reader(wav.createReaderFor(file.createInputStream().release(), true));
+    if (reader == nullptr) {
+        return nullptr;
+    }
+    auto audio = std::make_unique<juce::AudioBuffer<float>>(static_cast<int>(reader->numChannels), static_cast<int>(reader->lengthInSamples));
+    reader->read(audio.get(), 0, audio->getNumSamples(), 0, true, true);
+    return audio;
+}
+
+struct NullTest {
+    float peak_difference { 0.0f };
+    double residual_db { -std::numeric_limits<double>::infinity() };
+};
+
+NullTest null_test(const juce::AudioBuffer<float>& rendered, const juce::AudioBuffer<float>& reference) {
+    NullTest result;
+    double residual_energy = 0.0;
+    double reference_energy = 0.0;
+    for (int ch = 0; ch < reference.getNumChannels(); ++ch) {
+        for (int i = 0; i < reference.getNumSamples(); ++i) {
+            auto ref = reference.getSample(ch, i);
+            auto diff = rendered.getSample(ch, i) - ref;
+            result.peak_difference = std::max(result.peak_difference, std::abs(diff));
+            residual_energy += static_cast<double>(diff) * diff;
+            reference_energy += static_cast<double>(ref) * ref;
+        }
+    }
+    if (residual_energy > 0.0) {
+        result.residual_db = reference_energy > 0.0
+            ? 10.0 * std::log10(residual_energy / reference_energy)
+            : std::numeric_limits<double>::infinity();
+    }
+    return result;
+}
+
+double get_cpu_tolerance() {
+    auto tolerance = juce::SystemStats::getEnvironmentVariable("WABISONORANCE_CPU_TOLERANCE", {});
+    return tolerance.isNotEmpty() ? tolerance.getDoubleValue() : DEFAULT_CPU_TOLERANCE;
+}
+
+bool is_release_build() {
+#ifdef CMAKE_BUILD_TYPE
+    return juce::String(CMAKE_BUILD_TYPE) == "Release";
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+TEST_CASE("Golden audio", "[golden]") {
+    auto gui = juce::ScopedJuceInitialiser_GUI {};
+    auto dir = get_golden_dir();
+
+    for (const auto& scenario : get_scenarios()) {
+        DYNAMIC_SECTION(scenario.name) {
+            auto rendered = render(scenario);
+            auto file = dir.getChildFile(juce::String(scenario.name) + ".wav");
+
+            if (is_updating()) {
+                REQUIRE(dir.createDirectory());
+                offline::write_audio_file(rendered.audio, rendered.sample_rate, file, 32);
+                WARN("Recorded " << file.getFullPathName());
+                continue;
+            }
+            if (!file.existsAsFile()) {
+                if (is_required()) {
+                    FAIL("No reference at " << file.getFullPathName() << ", and WABISONORANCE_REQUIRE_GOLDEN is set");
+                }
+                SKIP("No reference at " << file.getFullPathName() << "; record one from a known-good build with WABISONORANCE_UPDATE_GOLDEN=1 and commit it");
+            }
+
+            auto reference = read_wav(file);
+            REQUIRE(reference != nullptr);
+            REQUIRE(reference->getNumChannels() == rendered.audio.getNumChannels());
+            REQUIRE(reference->getNumSamples() == rendered.audio.getNumSamples());
+
+            auto result = null_test(rendered.audio, *reference);
+            INFO("Peak difference " << result.peak_difference << ", residual " << result.residual_db << " dB");
+            CHECK(result.peak_difference <= MAX_PEAK_DIFFERENCE);
+            CHECK(result.residual_db <= MAX_RESIDUAL_DB);
+        }
+    }
+}
+
+// Hidden ("[.]"): not discovered by ctest, so it never runs alongside other tests
+TEST_CASE("CPU budgets", "[.][golden][budget]") {
+    auto gui = juce::ScopedJuceInitialiser_GUI {};
+    auto file = get_golden_dir().getChildFile("cpu_budgets.json");
+    auto baseline = juce::JSON::parse(file);
+    auto tolerance = get_cpu_tolerance();
+
+    auto* updated = new juce::DynamicObject();
+    juce::var updated_var(updated);
+    for (const auto& scenario : get_scenarios()) {
+        double best_ns_per_sample = std::numeric_limits<double>::max();
+        for (int run = 0; run < CPU_RUNS; ++run) {
+            auto result = render(scenario);
+            auto ns_per_sample = result.render_seconds * 1.0e9 / static_cast<double>(result.num_samples);
+            best_ns_per_sample = std::min(best_ns_per_sample, ns_per_sample);
+        }
+        updated->setProperty(scenario.name, best_ns_per_sample);
+
+        auto budget = baseline.getProperty(scenario.name, {});
+        if (is_updating() || budget.isVoid()) {
+            continue;
+        }
+        INFO(scenario.name << ": " << best_ns_per_sample << " ns/sample, baseline " << static_cast<double>(budget) << " x " << tolerance);
+        // Timings only mean something with optimizations on
+        if (is_release_build()) {
+            CHECK(best_ns_per_sample <= static_cast<double>(budget) * tolerance);
+        }
+    }
+
+    if (is_updating()) {
+        REQUIRE(file.getParentDirectory().createDirectory());
+        REQUIRE(file.replaceWithText(juce::JSON::toString(updated_var)));
+    } else if (baseline.isVoid()) {
+        WARN("No CPU baseline at " << file.getFullPathName() << "; run a Release build with WABISONORANCE_UPDATE_GOLDEN=1 and commit it");
+    }
+}
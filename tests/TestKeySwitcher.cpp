@@ -0,0 +1,153 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <KeySwitcher.hpp>
+#include <Rcu.hpp>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "helpers/realtime_checker.h"
+
+using jnickg::audio::key_info;
+using jnickg::audio::note;
+using jnickg::audio::scale;
+using jnickg::audio::ws::KeySwitcher;
+using jnickg::audio::ws::Rcu;
+
+namespace {
+
+/**
+ * @brief Counts how many of its kind are alive.
+ */
+struct Tracked {
+    explicit Tracked(int v) : value(v) { ++alive; }
+    ~Tracked() { --alive; }
+    int value;
+    static inline int alive = 0;
+};
+
+bool is_same_key(const key_info& a, const key_info& b) {
+    return a.root == b.root && a.scale_type == b.scale_type;
+}
+
+/**
+ * @brief Reads, as the audio thread would once per block, until the key shows up or time runs out.
+ */
+bool wait_for_key(KeySwitcher& keys, const key_info& key) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (is_same_key(keys.read().key, key)) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+} // namespace
+
+TEST_CASE("jnickg::audio::ws::Rcu") {
+    SECTION("reads see the latest version") {
+        Rcu<Tracked> cell(std::make_shared<const Tracked>(1));
+        REQUIRE(cell.read()->value == 1);
+        cell.publish(std::make_shared<const Tracked>(2));
+        REQUIRE(cell.read()->value == 2);
+        REQUIRE(cell.get_latest()->value == 2);
+    }
+
+    SECTION("frees a replaced version only once the reader has moved past it") {
+        {
+            Rcu<Tracked> cell(std::make_shared<const Tracked>(1));
+            const auto* held = cell.read();
+            cell.publish(std::make_shared<const Tracked>(2));
+            // The reader may still be using version 1 until its next read
+            cell.collect();
+            REQUIRE(Tracked::alive == 2);
+            REQUIRE(held->value == 1);
+
+            REQUIRE(cell.read()->value == 2);
+            cell.collect();
+            REQUIRE(cell.get_num_retired() == 1);
+            cell.read();
+            cell.collect();
+            REQUIRE(cell.get_num_retired() == 0);
+            REQUIRE(Tracked::alive == 1);
+        }
+        REQUIRE(Tracked::alive == 0);
+    }
+
+    SECTION("reading doesn't allocate, lock or free") {
+        Rcu<Tracked> cell(std::make_shared<const Tracked>(1));
+        cell.publish(std::make_shared<const Tracked>(2));
+        realtime_checker::Report report;
+        {
+            realtime_checker::ScopedAudioThread audio_thread;
+            for (int i = 0; i < 4; ++i) {
+                REQUIRE(cell.read()->value == 2);
+            }
+            report = audio_thread.get_report();
+        }
+        INFO(report.to_string());
+        REQUIRE(report.is_realtime_safe());
+        REQUIRE(report.locks == 0);
+    }
+}
+
+TEST_CASE("jnickg::audio::ws::KeySwitcher") {
+    const key_info initial { .root = note::A, .scale_type = scale::yonanuki };
+    const key_info other { .root = note::C, .scale_type = scale::major };
+    KeySwitcher keys(initial);
+
+    SECTION("starts with tables built for the initial key") {
+        const auto& tables = keys.read();
+        REQUIRE(is_same_key(tables.key, initial));
+        REQUIRE(tables.chords.is_built_for(initial));
+        REQUIRE(tables.scale.size > 0);
+    }
+
+    SECTION("set_key switches the reader on its next read") {
+        const auto* before = &keys.read();
+        keys.set_key(other);
+        REQUIRE(is_same_key(keys.get_key(), other));
+        const auto& after = keys.read();
+        REQUIRE(&after != before);
+        REQUIRE(after.chords.is_built_for(other));
+        // C major has every white key, and nothing else
+        REQUIRE(after.scale.size == 75);
+        REQUIRE(after.scale.notes[0] == 0);
+        REQUIRE(after.scale.notes[1] == 2);
+
+        // Setting the same key again changes nothing
+        keys.set_key(other);
+        REQUIRE(&keys.read() == &after);
+    }
+
+    SECTION("request_key builds in the background, without the requester allocating") {
+        keys.start();
+        realtime_checker::Report report;
+        {
+            realtime_checker::ScopedAudioThread audio_thread;
+            keys.request_key(other);
+            REQUIRE(wait_for_key(keys, other));
+            report = audio_thread.get_report();
+        }
+        INFO(report.to_string());
+        REQUIRE(report.allocations == 0);
+        REQUIRE(report.deallocations == 0);
+        REQUIRE(report.contended_locks == 0);
+        REQUIRE(is_same_key(keys.get_key(), other));
+    }
+
+    SECTION("the background thread frees old tables once the reader has moved on") {
+        keys.start();
+        keys.set_key(other);
+        keys.read();
+        keys.read();
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (keys.get_num_retired() > 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(KeySwitcher::POLL_INTERVAL_MS));
+        }
+        REQUIRE(keys.get_num_retired() == 0);
+    }
+}
@@ -0,0 +1,131 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <LoadGenerator.hpp>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "helpers/realtime_checker.h"
+
+using jnickg::audio::ws::load::Generator;
+using jnickg::audio::ws::load::Pattern;
+
+namespace {
+
+constexpr double SAMPLE_RATE = 48000.0;
+constexpr int BLOCK_SIZE = 256;
+
+juce::MidiMessageSequence generate(const Generator::Settings& settings, double seconds) {
+    Generator generator(settings, SAMPLE_RATE);
+    return generator.next_sequence(seconds, BLOCK_SIZE);
+}
+
+// The most note-ons in any window of the given length
+int max_note_ons_within(const juce::MidiMessageSequence& sequence, double window) {
+    std::vector<double> times;
+    for (const auto* event : sequence) {
+        if (event->message.isNoteOn()) {
+            times.push_back(event->message.getTimeStamp());
+        }
+    }
+    int max_count = 0;
+    size_t first = 0;
+    for (size_t last = 0; last < times.size(); ++last) {
+        while (times[last] - times[first] > window) {
+            ++first;
+        }
+        max_count = std::max(max_count, static_cast<int>(last - first + 1));
+    }
+    return max_count;
+}
+
+} // namespace
+
+TEST_CASE("jnickg::audio::ws::load::Generator") {
+    Generator::Settings settings;
+
+    SECTION("is reproducible from the seed") {
+        auto first = generate(settings, 30.0);
+        auto second = generate(settings, 30.0);
+        REQUIRE(first.getNumEvents() > 0);
+        REQUIRE(first.getNumEvents() == second.getNumEvents());
+        for (int i = 0; i < first.getNumEvents(); ++i) {
+            const auto& a = first.getEventPointer(i)->message;
+            const auto& b = second.getEventPointer(i)->message;
+            REQUIRE(a.getTimeStamp() == b.getTimeStamp());
+            REQUIRE(a.getDescription() == b.getDescription());
+        }
+
+        settings.seed = 2;
+        REQUIRE(generate(settings, 30.0).getNumEvents() != first.getNumEvents());
+    }
+
+    SECTION("ends every note it starts, and never restrikes a held note") {
+        auto sequence = generate(settings, 60.0);
+        std::array<bool, 128> held {};
+        for (const auto* event : sequence) {
+            const auto& m = event->message;
+            if (m.isNoteOn()) {
+                REQUIRE_FALSE(held[static_cast<size_t>(m.getNoteNumber())]);
+                held[static_cast<size_t>(m.getNoteNumber())] = true;
+            } else if (m.isNoteOff()) {
+                held[static_cast<size_t>(m.getNoteNumber())] = false;
+            }
+        }
+
+        // Only notes struck in the last 30 seconds (the longest pad) may still be sounding
+        for (int i = 0; i < sequence.getNumEvents(); ++i) {
+            const auto* event = sequence.getEventPointer(i);
+            if (event->message.isNoteOn() && event->noteOffObject == nullptr) {
+                REQUIRE(event->message.getTimeStamp() >= 30.0);
+            }
+        }
+    }
+
+    SECTION("retrigger storms hold more notes than the plugin has voices") {
+        auto sequence = generate(settings.only(Pattern::retrigger_storm), 10.0);
+        // Even with 20 ms notes, that many still ring out in release and force voice stealing
+        REQUIRE(max_note_ons_within(sequence, 0.5) > 16);
+    }
+
+    SECTION("pitch sweeps cover the whole wheel") {
+        auto sequence = generate(settings.only(Pattern::pitch_sweeps), 5.0);
+        int lowest = 16383;
+        int highest = 0;
+        for (const auto* event : sequence) {
+            REQUIRE(event->message.isPitchWheel());
+            lowest = std::min(lowest, event->message.getPitchWheelValue());
+            highest = std::max(highest, event->message.getPitchWheelValue());
+        }
+        REQUIRE(lowest < 100);
+        REQUIRE(highest > 16283);
+    }
+
+    SECTION("key changes come as text events parse_key() reads") {
+        auto sequence = generate(settings.only(Pattern::key_changes), 120.0);
+        REQUIRE(sequence.getNumEvents() >= 3);
+        for (const auto* event : sequence) {
+            auto text = event->message.getTextFromTextMetaEvent();
+            REQUIRE(text.startsWith(Generator::KEY_CHANGE_PREFIX));
+            REQUIRE_NOTHROW(jnickg::audio::parse_key(text.fromFirstOccurrenceOf(Generator::KEY_CHANGE_PREFIX, false, false).toStdString()));
+        }
+    }
+
+    SECTION("makes blocks without allocating") {
+        Generator generator(settings, SAMPLE_RATE);
+        juce::MidiBuffer midi;
+        midi.ensureSize(4096);
+        realtime_checker::Report report;
+        {
+            realtime_checker::ScopedAudioThread audio_thread;
+            for (int i = 0; i < 1000; ++i) {
+                midi.clear();
+                generator.next_block(midi, BLOCK_SIZE);
+            }
+            report = audio_thread.get_report();
+        }
+        INFO(report.to_string());
+        REQUIRE(report.is_realtime_safe());
+    }
+}
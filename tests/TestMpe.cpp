@@ -0,0 +1,97 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+#include <Mpe.hpp>
+#include <PluginProcessor.h>
+
+using jnickg::audio::ws::MpeZone;
+
+namespace {
+
+constexpr double SAMPLE_RATE = 48000.0;
+constexpr int BLOCK_SIZE = 256;
+
+void process(PluginProcessor& plugin, juce::MidiBuffer& midi, int blocks = 1) {
+    juce::AudioBuffer<float> buffer(2, BLOCK_SIZE);
+    for (int i = 0; i < blocks; ++i) {
+        buffer.clear();
+        plugin.processBlock(buffer, midi);
+        midi.clear();
+    }
+}
+
+} // namespace
+
+TEST_CASE("jnickg::audio::ws::MpeZone") {
+    MpeZone zone;
+
+    SECTION("starts every channel at rest") {
+        for (int channel = 1; channel <= MpeZone::NUM_CHANNELS; ++channel) {
+            auto e = zone.get_expression(channel);
+            REQUIRE(e.bend == 0.0f);
+            REQUIRE(e.pressure == 0.0f);
+            REQUIRE(e.timbre == 0.0f);
+        }
+    }
+
+    SECTION("keeps each channel's expression to itself") {
+        zone.set_pitch_wheel(2, 16383);
+        zone.set_pressure(3, 127);
+        zone.set_timbre(4, 0);
+
+        REQUIRE(zone.get_expression(2).bend == Catch::Approx(MpeZone::DEFAULT_NOTE_BEND_RANGE).margin(0.01));
+        REQUIRE(zone.get_expression(2).pressure == 0.0f);
+        REQUIRE(zone.get_expression(3).pressure == 1.0f);
+        REQUIRE(zone.get_expression(3).bend == 0.0f);
+        REQUIRE(zone.get_expression(4).timbre == -1.0f);
+        REQUIRE(zone.get_expression(5).timbre == 0.0f);
+
+        zone.reset();
+        REQUIRE(zone.get_expression(2).bend == 0.0f);
+        REQUIRE(zone.get_expression(3).pressure == 0.0f);
+        REQUIRE(zone.get_expression(4).timbre == 0.0f);
+    }
+
+    SECTION("bends member channels over their range, and every channel by the master's") {
+        zone.set_note_bend_range(12.0f);
+        zone.set_pitch_wheel(2, 0);
+        REQUIRE(zone.get_expression(2).bend == -12.0f);
+
+        zone.set_pitch_wheel(MpeZone::MASTER_CHANNEL, 0);
+        REQUIRE(zone.get_expression(2).bend == -12.0f - MpeZone::MASTER_BEND_RANGE);
+        REQUIRE(zone.get_expression(7).bend == -MpeZone::MASTER_BEND_RANGE);
+    }
+
+    SECTION("clamps what it's sent") {
+        zone.set_pressure(0, 500);
+        zone.set_timbre(99, 200);
+        REQUIRE(zone.get_expression(1).pressure == 1.0f);
+        REQUIRE(zone.get_expression(MpeZone::NUM_CHANNELS).timbre == 1.0f);
+    }
+}
+
+TEST_CASE("PluginProcessor MPE with the scale quantizer") {
+    auto gui = juce::ScopedJuceInitialiser_GUI {};
+    PluginProcessor plugin;
+    plugin.set_chord_trace_enabled(false);
+    plugin.set_mpe(true);
+    plugin.set_scale_quantizer(jnickg::audio::ws::ScaleQuantizer::Mode::nearest);
+    plugin.prepareToPlay(SAMPLE_RATE, BLOCK_SIZE);
+
+    SECTION("releases a key held on two channels at once, channel by channel") {
+        // D isn't in the default key (A Yonanuki), so both channels' D becomes C
+        juce::MidiBuffer midi;
+        midi.addEvent(juce::MidiMessage::channelPressureChange(2, 100), 0);
+        midi.addEvent(juce::MidiMessage::noteOn(2, 62, 0.8f), 0);
+        midi.addEvent(juce::MidiMessage::noteOn(3, 62, 0.8f), 1);
+        process(plugin, midi, 2);
+        REQUIRE(plugin.get_sounding_voices() == 2);
+
+        midi.addEvent(juce::MidiMessage::noteOff(2, 62, 1.0f), 0);
+        process(plugin, midi);
+        midi.addEvent(juce::MidiMessage::noteOff(3, 62, 1.0f), 0);
+        // Longer than the release
+        process(plugin, midi, static_cast<int>(2.0 * SAMPLE_RATE / BLOCK_SIZE));
+        REQUIRE(plugin.get_sounding_voices() == 0);
+    }
+}
@@ -258,6 +258,18 @@ TEST_CASE("jnickg::audio::key_info") {
 
         REQUIRE(test_key.contains_all_chord_notes(test_chord));
     }
+
+    SECTION("parse_key(to_string()) round-trips") {
+        REQUIRE(jnickg::audio::parse_key(test_key.to_string()).root == test_key.root);
+        REQUIRE(jnickg::audio::parse_key(test_key.to_string()).scale_type == test_key.scale_type);
+
+        auto parsed = jnickg::audio::parse_key("bb_harmonic_minor");
+        REQUIRE(parsed.root == jnickg::audio::note::Asharp);
+        REQUIRE(parsed.scale_type == jnickg::audio::scale::harmonic_minor);
+
+        REQUIRE_THROWS(jnickg::audio::parse_key("H major"));
+        REQUIRE_THROWS(jnickg::audio::parse_key("C"));
+    }
 }
 
 TEST_CASE("jnickg::audio::get_chords(key_info, include_inversions)") {
@@ -0,0 +1,154 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <OfflineRenderer.hpp>
+
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace offline = jnickg::audio::ws::offline;
+
+namespace {
+
+juce::MidiMessageSequence make_sequence() {
+    juce::MidiMessageSequence sequence;
+    sequence.addEvent(juce::MidiMessage::tempoMetaEvent(500000), 0.0);     // 120 BPM
+    sequence.addEvent(juce::MidiMessage::noteOn(1, 57, 0.8f), 0.0);
+    sequence.addEvent(juce::MidiMessage::noteOff(1, 57), 0.25);
+    sequence.addEvent(juce::MidiMessage::noteOn(1, 60, 0.8f), 0.25);
+    sequence.addEvent(juce::MidiMessage::noteOff(1, 60), 0.5);
+    sequence.updateMatchedPairs();
+    return sequence;
+}
+
+} // namespace
+
+TEST_CASE("jnickg::audio::ws::offline", "[offline]") {
+    auto gui = juce::ScopedJuceInitialiser_GUI {};
+    auto sequence = make_sequence();
+    offline::Options options;
+    options.sample_rate = 44100.0;
+    options.block_size = 300;
+    options.tail_seconds = 0.5;
+
+    SECTION("renders the whole sequence plus the tail") {
+        auto result = offline::render(sequence, options);
+        REQUIRE(result.audio.getNumSamples() == 44100);
+        REQUIRE(result.audio.getNumChannels() == 2);
+        REQUIRE(result.audio.getMagnitude(0, 0, 44100 / 2) > 0.0f);
+        REQUIRE(result.get_realtime_factor() > 0.0);
+    }
+
+    SECTION("the same seed renders the same audio") {
+        auto first = offline::render(sequence, options);
+        auto second = offline::render(sequence, options);
+        auto differing = 0;
+        for (int ch = 0; ch < first.audio.getNumChannels(); ++ch) {
+            for (int i = 0; i < first.audio.getNumSamples(); ++i) {
+                differing += first.audio.getSample(ch, i) != second.audio.getSample(ch, i) ? 1 : 0;
+            }
+        }
+        REQUIRE(differing == 0);
+    }
+
+    SECTION("reads the tempo from the sequence") {
+        REQUIRE(offline::get_bpm(sequence) == 120.0);
+        REQUIRE(offline::get_bpm(juce::MidiMessageSequence()) == 120.0);
+    }
+
+    SECTION("round-trips MIDI and WAV files") {
+        auto midi_file = juce::TemporaryFile(".mid");
+        {
+            juce::MidiFile midi;
+            midi.setTicksPerQuarterNote(960);
+            auto in_ticks = make_sequence();
+            for (auto* event : in_ticks) {
+                event->message.setTimeStamp(event->message.getTimeStamp() * 2.0 * 960.0);
+            }
+            midi.addTrack(in_ticks);
+            juce::FileOutputStream out(midi_file.getFile());
+            REQUIRE(midi.writeTo(out));
+        }
+        auto loaded = offline::load_midi_file(midi_file.getFile());
+        REQUIRE(loaded.getNumEvents() >= 5);
+        REQUIRE(std::abs(loaded.getEndTime() - 0.5) < 1.0e-9);
+
+        auto result = offline::render(loaded, options);
+        auto wav_file = juce::TemporaryFile(".wav");
+        offline::write_audio_file(result.audio, result.sample_rate, wav_file.getFile(), 24);
+
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+        std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(wav_file.getFile()));
+        REQUIRE(reader != nullptr);
+        REQUIRE(reader->sampleRate == 44100.0);
+        REQUIRE(reader->lengthInSamples == result.audio.getNumSamples());
+        REQUIRE(reader->bitsPerSample == 24);
+
+        REQUIRE_THROWS(offline::write_audio_file(result.audio, result.sample_rate, juce::File::createTempFile(".ogg"), 24));
+        REQUIRE_THROWS(offline::load_midi_file(wav_file.getFile()));
+    }
+
+    SECTION("renders batches in parallel, each job as it would render alone") {
+        auto dir = juce::File::createTempFile("batch");
+        REQUIRE(dir.createDirectory());
+        auto midi_file = dir.getChildFile("in.mid");
+        {
+            juce::MidiFile midi;
+            midi.setTicksPerQuarterNote(960);
+            auto in_ticks = make_sequence();
+            for (auto* event : in_ticks) {
+                event->message.setTimeStamp(event->message.getTimeStamp() * 2.0 * 960.0);
+            }
+            midi.addTrack(in_ticks);
+            juce::FileOutputStream out(midi_file);
+            REQUIRE(midi.writeTo(out));
+        }
+
+        std::vector<offline::Job> jobs;
+        for (int i = 0; i < 4; ++i) {
+            offline::Job job;
+            job.input = midi_file;
+            job.output = dir.getChildFile("out" + juce::String(i) + ".wav");
+            job.options = options;
+            job.options.seed = i;
+            job.bits_per_sample = 32;
+            jobs.push_back(job);
+        }
+        jobs[2].input = dir.getChildFile("missing.mid");
+
+        size_t reported = 0;
+        auto batch = offline::render_batch(jobs, 3, [&reported](const offline::JobResult&) { ++reported; });
+        REQUIRE(reported == jobs.size());
+        REQUIRE(batch.jobs.size() == jobs.size());
+        REQUIRE(batch.get_num_failed() == 1);
+        REQUIRE_FALSE(batch.jobs[2].ok);
+        REQUIRE(batch.jobs[2].error.isNotEmpty());
+        REQUIRE(batch.get_realtime_factor() > 0.0);
+
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+        for (auto i : { 0, 1, 3 }) {
+            REQUIRE(batch.jobs[static_cast<size_t>(i)].ok);
+            auto alone_options = options;
+            alone_options.seed = i;
+            auto alone = offline::render(offline::load_midi_file(midi_file), alone_options);
+
+            std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(jobs[static_cast<size_t>(i)].output));
+            REQUIRE(reader != nullptr);
+            REQUIRE(reader->lengthInSamples == alone.audio.getNumSamples());
+            juce::AudioBuffer<float> written(static_cast<int>(reader->numChannels), static_cast<int>(reader->lengthInSamples));
+            reader->read(&written, 0, written.getNumSamples(), 0, true, true);
+            auto differing = 0;
+            for (int ch = 0; ch < written.getNumChannels(); ++ch) {
+                for (int n = 0; n < written.getNumSamples(); ++n) {
+                    differing += written.getSample(ch, n) != alone.audio.getSample(ch, n) ? 1 : 0;
+                }
+            }
+            REQUIRE(differing == 0);
+        }
+        dir.deleteRecursively();
+    }
+}
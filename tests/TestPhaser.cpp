@@ -0,0 +1,98 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <Phaser.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+using jnickg::audio::ws::MonoPhaser;
+using jnickg::audio::ws::StereoPhaser;
+
+namespace {
+
+constexpr double sample_rate = 48000.0;
+constexpr size_t length = 48000;
+
+std::vector<float> tone(float hz) {
+    std::vector<float> samples(length);
+    for (size_t i = 0; i < length; ++i) {
+        samples[i] = 0.5f * std::sin(juce::MathConstants<float>::twoPi * hz * static_cast<float>(i) / static_cast<float>(sample_rate));
+    }
+    return samples;
+}
+
+// Runs both lanes of a stereo phaser over the same input
+std::vector<std::array<float, 2>> process(StereoPhaser& phaser, const std::vector<float>& input) {
+    std::vector<std::array<float, 2>> frames(input.size());
+    for (size_t i = 0; i < input.size(); ++i) {
+        frames[i] = { input[i], input[i] };
+        phaser.process_frame(frames[i].data());
+    }
+    return frames;
+}
+
+} // namespace
+
+TEST_CASE("jnickg::audio::ws::Phaser") {
+    StereoPhaser phaser;
+    phaser.prepare(sample_rate);
+    auto input = tone(440.0f);
+
+    SECTION("stays silent on silence, and bounded on a tone") {
+        std::vector<float> silence(length, 0.0f);
+        for (const auto& frame : process(phaser, silence)) {
+            REQUIRE(frame[0] == 0.0f);
+            REQUIRE(frame[1] == 0.0f);
+        }
+
+        auto peak = 0.0f;
+        for (const auto& frame : process(phaser, input)) {
+            REQUIRE(std::isfinite(frame[0]));
+            REQUIRE(std::isfinite(frame[1]));
+            peak = std::max({ peak, std::abs(frame[0]), std::abs(frame[1]) });
+        }
+        REQUIRE(peak > 0.0f);
+        REQUIRE(peak < 4.0f);
+    }
+
+    SECTION("passes the input through untouched with the mix at 0") {
+        auto params = phaser.get_parameters();
+        params.mix = 0.0f;
+        phaser.set_parameters(params);
+        auto output = process(phaser, input);
+        for (size_t i = 0; i < length; ++i) {
+            REQUIRE(output[i][0] == input[i]);
+        }
+    }
+
+    SECTION("sweeps the lanes apart by their phase offset") {
+        auto offset = process(phaser, input);
+        auto differs = std::any_of(offset.begin(), offset.end(), [](const auto& f) { return f[0] != f[1]; });
+        REQUIRE(differs);
+
+        auto params = phaser.get_parameters();
+        params.lane_phase_offset = 0.0f;
+        phaser.set_parameters(params);
+        phaser.reset();
+        for (const auto& frame : process(phaser, input)) {
+            REQUIRE(frame[0] == frame[1]);
+        }
+    }
+
+    SECTION("starts over after reset") {
+        auto first = process(phaser, input);
+        phaser.reset();
+        REQUIRE(process(phaser, input) == first);
+    }
+
+    SECTION("processes one lane as a sample at a time") {
+        MonoPhaser mono;
+        mono.prepare(sample_rate);
+        auto stereo = process(phaser, input);
+        for (size_t i = 0; i < length; ++i) {
+            REQUIRE(mono.process_sample(input[i]) == stereo[i][0]);
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <CpuBudget.hpp>
+#include <PluginProcessor.h>
+
+#include "helpers/realtime_checker.h"
+
+using jnickg::audio::ws::CpuBudget;
+
+namespace {
+
+constexpr double SAMPLE_RATE = 48000.0;
+constexpr int BLOCK_SIZE = 256;
+
+void process(PluginProcessor& plugin, juce::MidiBuffer& midi, int blocks = 1) {
+    juce::AudioBuffer<float> buffer(2, BLOCK_SIZE);
+    for (int i = 0; i < blocks; ++i) {
+        buffer.clear();
+        plugin.processBlock(buffer, midi);
+        midi.clear();
+    }
+}
+
+juce::MidiBuffer chord(int first_note, int num_notes) {
+    juce::MidiBuffer midi;
+    for (int i = 0; i < num_notes; ++i) {
+        midi.addEvent(juce::MidiMessage::noteOn(1, first_note + i, 0.8f), i);
+    }
+    return midi;
+}
+
+int64_t ns_for_load(double load) {
+    return static_cast<int64_t>(load * 1.0e9 * BLOCK_SIZE / SAMPLE_RATE);
+}
+
+} // namespace
+
+TEST_CASE("PluginProcessor polyphony") {
+    auto gui = juce::ScopedJuceInitialiser_GUI {};
+    PluginProcessor plugin;
+    plugin.set_chord_trace_enabled(false);
+    plugin.prepareToPlay(SAMPLE_RATE, BLOCK_SIZE);
+    juce::MidiBuffer empty;
+
+    SECTION("sounds no more voices than the limit") {
+        plugin.set_max_voices(4);
+        auto midi = chord(48, 12);
+        process(plugin, midi);
+        process(plugin, empty);
+        REQUIRE(plugin.get_sounding_voices() <= 4);
+    }
+
+    SECTION("goes past the default voice count when allowed") {
+        plugin.set_max_voices(PluginProcessor::MAX_VOICES);
+        auto midi = chord(36, 40);
+        process(plugin, midi);
+        process(plugin, empty);
+        REQUIRE(plugin.get_sounding_voices() == 40);
+    }
+
+    SECTION("fades out voices over a lowered limit") {
+        auto midi = chord(48, 8);
+        process(plugin, midi);
+        process(plugin, empty);
+        REQUIRE(plugin.get_sounding_voices() == 8);
+
+        plugin.set_max_voices(2);
+        process(plugin, empty, 4);
+        REQUIRE(plugin.get_sounding_voices() <= 2);
+        REQUIRE(plugin.get_voices_shed() >= 6);
+    }
+
+    SECTION("changes polyphony without allocating") {
+        auto midi = chord(48, 8);
+        process(plugin, midi);
+        juce::AudioBuffer<float> buffer(2, BLOCK_SIZE);
+        realtime_checker::Report report;
+        {
+            realtime_checker::ScopedAudioThread audio_thread;
+            for (auto voices : { 32, 3, 64, 1, 16 }) {
+                plugin.set_max_voices(static_cast<size_t>(voices));
+                buffer.clear();
+                plugin.processBlock(buffer, empty);
+            }
+            report = audio_thread.get_report();
+        }
+        INFO(report.to_string());
+        REQUIRE(report.is_realtime_safe());
+    }
+}
+
+TEST_CASE("jnickg::audio::ws::CpuBudget") {
+    CpuBudget budget;
+    budget.reset();
+
+    SECTION("allows every voice when off") {
+        budget.end_block(ns_for_load(2.0), BLOCK_SIZE, SAMPLE_RATE);
+        REQUIRE(budget.get_voice_ceiling(16, 16) == 16);
+    }
+
+    SECTION("sheds voices in proportion to the overrun") {
+        budget.set_budget(0.5);
+        budget.end_block(ns_for_load(1.0), BLOCK_SIZE, SAMPLE_RATE);
+        REQUIRE(budget.get_voice_ceiling(16, 64) == 8);
+        REQUIRE(budget.get_load() > 0.9);
+
+        // The overrun is only counted once
+        REQUIRE(budget.get_voice_ceiling(8, 64) == 8);
+    }
+
+    SECTION("sheds at least one voice, and never the last") {
+        budget.set_budget(0.5);
+        budget.end_block(ns_for_load(0.51), BLOCK_SIZE, SAMPLE_RATE);
+        REQUIRE(budget.get_voice_ceiling(16, 64) == 15);
+        budget.end_block(ns_for_load(5.0), BLOCK_SIZE, SAMPLE_RATE);
+        REQUIRE(budget.get_voice_ceiling(1, 64) == 1);
+    }
+
+    SECTION("recovers a voice per block once well under budget") {
+        budget.set_budget(0.5);
+        budget.end_block(ns_for_load(1.0), BLOCK_SIZE, SAMPLE_RATE);
+        REQUIRE(budget.get_voice_ceiling(16, 16) == 8);
+
+        // The smoothed load falls slowly, so the ceiling holds for a while
+        budget.end_block(ns_for_load(0.1), BLOCK_SIZE, SAMPLE_RATE);
+        REQUIRE(budget.get_voice_ceiling(8, 16) == 8);
+
+        for (int i = 0; i < 200; ++i) {
+            budget.end_block(ns_for_load(0.1), BLOCK_SIZE, SAMPLE_RATE);
+            budget.get_voice_ceiling(8, 16);
+        }
+        REQUIRE(budget.get_voice_ceiling(8, 16) == 16);
+    }
+}
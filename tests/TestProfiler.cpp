@@ -0,0 +1,121 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+#include <Profiler.hpp>
+
+#include "helpers/realtime_checker.h"
+
+using jnickg::audio::ws::Profiler;
+using jnickg::audio::ws::Stage;
+
+TEST_CASE("jnickg::audio::ws::Profiler") {
+    constexpr double sample_rate = 48000.0;
+    constexpr int block_size = 480;             // A 10ms deadline
+    constexpr int64_t deadline_ns = 10'000'000;
+
+    Profiler profiler;
+    profiler.set_enabled(true);
+
+    auto run_block = [&](int64_t callback_ns, int64_t reverb_ns = 0) {
+        profiler.begin_block(block_size, sample_rate);
+        profiler.add(Stage::reverb, reverb_ns);
+        profiler.add_voice(0, callback_ns / 4);
+        profiler.add_voice(1, callback_ns / 4);
+        profiler.end_block(callback_ns);
+    };
+
+    SECTION("accumulates stage and voice timings per block") {
+        run_block(2'000'000, 1'000'000);
+        run_block(4'000'000, 3'000'000);
+
+        auto snapshot = profiler.get_snapshot();
+        REQUIRE(snapshot.blocks == 2);
+        REQUIRE(snapshot.callback.mean_us == Catch::Approx(3000.0));
+        REQUIRE(snapshot.callback.max_us == Catch::Approx(4000.0));
+        REQUIRE(snapshot.stage(Stage::reverb).mean_us == Catch::Approx(2000.0));
+        REQUIRE(snapshot.stage(Stage::reverb).max_us == Catch::Approx(3000.0));
+        REQUIRE(snapshot.stage(Stage::phaser).mean_us == 0.0);
+        REQUIRE(snapshot.num_voices == 2);
+        REQUIRE(snapshot.voices[1].mean_us == Catch::Approx(750.0));
+        REQUIRE(snapshot.mean_load == Catch::Approx(0.3));
+        REQUIRE(snapshot.max_load == Catch::Approx(0.4));
+    }
+
+    SECTION("bins callbacks by their share of the deadline") {
+        run_block(deadline_ns / 10);        // 10%
+        run_block(deadline_ns * 85 / 100); // near miss
+        run_block(deadline_ns * 2);         // overrun
+
+        auto snapshot = profiler.get_snapshot();
+        REQUIRE(snapshot.histogram[2] == 1);
+        REQUIRE(snapshot.histogram[17] == 1);
+        REQUIRE(snapshot.histogram[Profiler::NUM_BINS] == 1);
+        REQUIRE(snapshot.near_misses == 1);
+        REQUIRE(snapshot.overruns == 1);
+    }
+
+    SECTION("resets at the start of the next block") {
+        run_block(deadline_ns * 2);
+        profiler.reset();
+        REQUIRE(profiler.get_snapshot().overruns == 1);
+
+        run_block(deadline_ns / 2);
+        auto snapshot = profiler.get_snapshot();
+        REQUIRE(snapshot.blocks == 1);
+        REQUIRE(snapshot.overruns == 0);
+        REQUIRE(snapshot.max_load == Catch::Approx(0.5));
+    }
+
+    SECTION("records nothing while disabled, as it starts out") {
+        REQUIRE_FALSE(Profiler().is_enabled());
+        profiler.set_enabled(false);
+        run_block(deadline_ns);
+        REQUIRE(profiler.get_snapshot().blocks == 0);
+        REQUIRE_FALSE(profiler.is_voice_block());
+    }
+
+    SECTION("asks for each voice's time on one block in VOICE_SAMPLE_INTERVAL") {
+        uint64_t sampled = 0;
+        for (uint64_t i = 0; i < 4 * Profiler::VOICE_SAMPLE_INTERVAL; ++i) {
+            profiler.begin_block(block_size, sample_rate);
+            if (profiler.is_voice_block()) {
+                ++sampled;
+                profiler.add_voice(0, 1'000);
+            }
+            profiler.end_block(deadline_ns / 2);
+        }
+        REQUIRE(sampled == 4);
+
+        // Averaged over the blocks it was measured on, not all of them
+        auto snapshot = profiler.get_snapshot();
+        REQUIRE(snapshot.voice_blocks == 4);
+        REQUIRE(snapshot.voices[0].mean_us == Catch::Approx(1.0));
+    }
+
+    SECTION("times scopes against the steady clock") {
+        {
+            Profiler::ScopedBlock block(profiler, block_size, sample_rate);
+            Profiler::ScopedStage stage(profiler, Stage::midi);
+            auto start = Profiler::clock::now();
+            while (Profiler::elapsed_ns(start) < 100'000) {}
+        }
+        auto snapshot = profiler.get_snapshot();
+        REQUIRE(snapshot.blocks == 1);
+        REQUIRE(snapshot.stage(Stage::midi).mean_us >= 100.0);
+        REQUIRE(snapshot.callback.mean_us >= snapshot.stage(Stage::midi).mean_us);
+    }
+
+    SECTION("is real-time safe") {
+        realtime_checker::Report report;
+        {
+            realtime_checker::ScopedAudioThread audio_thread;
+            for (int i = 0; i < 100; ++i) {
+                Profiler::ScopedBlock block(profiler, block_size, sample_rate);
+                Profiler::ScopedStage stage(profiler, Stage::voices);
+                profiler.add_voice(static_cast<size_t>(i % 16), 10);
+            }
+            report = audio_thread.get_report();
+        }
+        REQUIRE(report.is_realtime_safe());
+    }
+}
@@ -0,0 +1,278 @@
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "helpers/realtime_checker.h"
+#include "helpers/test_helpers.h"
+
+using realtime_checker::Report;
+using realtime_checker::ScopedAudioThread;
+
+TEST_CASE("realtime_checker", "[realtime]") {
+    SECTION("catches allocations and frees") {
+        Report report;
+        {
+            ScopedAudioThread audio_thread;
+            std::vector<int>* volatile v = new std::vector<int>(16);
+            delete v;
+            report = audio_thread.get_report();
+        }
+        REQUIRE(report.allocations == 2);
+        REQUIRE(report.deallocations == 2);
+        REQUIRE_FALSE(report.is_realtime_safe());
+    }
+
+    SECTION("ignores other threads") {
+        std::atomic<bool> go { false };
+        std::atomic<bool> finished { false };
+        std::thread other([&] {
+            while (!go.load()) {}
+            std::vector<int> elsewhere(16);
+            finished.store(true);
+        });
+        Report report;
+        {
+            ScopedAudioThread audio_thread;
+            go.store(true);
+            while (!finished.load()) {}
+            report = audio_thread.get_report();
+        }
+        other.join();
+        REQUIRE(report.is_realtime_safe());
+        REQUIRE(report.allocations == 0);
+    }
+
+    if (!realtime_checker::has_system_hooks()) {
+        WARN("No malloc, lock or syscall hooks on this platform; only operator new/delete are checked");
+        return;
+    }
+
+    SECTION("catches malloc") {
+        Report report;
+        {
+            ScopedAudioThread audio_thread;
+            // volatile, or the compiler may elide the pair
+            void* volatile p = std::malloc(64);
+            std::free(p);
+            report = audio_thread.get_report();
+        }
+        REQUIRE(report.allocations == 1);
+        REQUIRE(report.deallocations == 1);
+    }
+
+    SECTION("catches printf") {
+        Report report;
+        {
+            ScopedAudioThread audio_thread;
+            printf("realtime_checker: this line is expected %d\n", 1);
+            report = audio_thread.get_report();
+        }
+        REQUIRE(report.syscalls >= 1);
+    }
+
+    SECTION("allows uncontended locks, but catches contended ones") {
+        std::mutex m;
+        Report uncontended;
+        {
+            ScopedAudioThread audio_thread;
+            m.lock();
+            m.unlock();
+            uncontended = audio_thread.get_report();
+        }
+        REQUIRE(uncontended.locks == 1);
+        REQUIRE(uncontended.is_realtime_safe());
+
+        std::promise<void> locked;
+        std::thread holder([&] {
+            std::lock_guard<std::mutex> lock(m);
+            locked.set_value();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        });
+        locked.get_future().wait();
+        Report contended;
+        {
+            ScopedAudioThread audio_thread;
+            m.lock();
+            m.unlock();
+            contended = audio_thread.get_report();
+        }
+        holder.join();
+        REQUIRE(contended.contended_locks == 1);
+        REQUIRE_FALSE(contended.is_realtime_safe());
+    }
+}
+
+namespace {
+
+/**
+ * @brief Pre-built blocks of MIDI, so that building them isn't counted against processBlock.
+ */
+std::vector<juce::MidiBuffer> note_storm(int num_blocks, int block_size, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> note(24, 100);
+    std::uniform_int_distribution<int> position(0, block_size - 1);
+    std::uniform_int_distribution<int> events_per_block(0, 8);
+    std::uniform_real_distribution<float> velocity(0.1f, 1.0f);
+
+    std::vector<juce::MidiBuffer> blocks(static_cast<size_t>(num_blocks));
+    for (auto& midi : blocks) {
+        auto num_events = events_per_block(rng);
+        for (int i = 0; i < num_events; ++i) {
+            auto n = note(rng);
+            if (rng() % 2 == 0) {
+                midi.addEvent(juce::MidiMessage::noteOn(1, n, velocity(rng)), position(rng));
+            } else {
+                midi.addEvent(juce::MidiMessage::noteOff(1, n, velocity(rng)), position(rng));
+            }
+        }
+        if (rng() % 16 == 0) {
+            midi.addEvent(juce::MidiMessage::pitchWheel(1, static_cast<int>(rng() % 16384)), position(rng));
+        }
+        // Per-channel expression, as an MPE controller sends it
+        if (rng() % 4 == 0) {
+            auto channel = 1 + static_cast<int>(rng() % 16);
+            midi.addEvent(juce::MidiMessage::pitchWheel(channel, static_cast<int>(rng() % 16384)), position(rng));
+            midi.addEvent(juce::MidiMessage::channelPressureChange(channel, static_cast<int>(rng() % 128)), position(rng));
+            midi.addEvent(juce::MidiMessage::controllerEvent(channel, 74, static_cast<int>(rng() % 128)), position(rng));
+        }
+    }
+    // Let everything ring out at the end, so the FX tails and idle gates get exercised too
+    for (int n = 0; n < 128; ++n) {
+        blocks.back().addEvent(juce::MidiMessage::noteOff(1, n), block_size - 1);
+    }
+    return blocks;
+}
+
+Report process_storm(PluginProcessor& plugin, juce::AudioBuffer<float>& buffer, std::vector<juce::MidiBuffer>& storm, int tail_blocks) {
+    juce::MidiBuffer empty;
+    ScopedAudioThread audio_thread;
+    for (auto& midi : storm) {
+        buffer.clear();
+        plugin.processBlock(buffer, midi);
+    }
+    for (int i = 0; i < tail_blocks; ++i) {
+        buffer.clear();
+        plugin.processBlock(buffer, empty);
+    }
+    return audio_thread.get_report();
+}
+
+} // namespace
+
+TEST_CASE("PluginProcessor::processBlock is real-time safe", "[realtime]") {
+    constexpr double sample_rate = 48000.0;
+    constexpr int block_size = 256;
+    constexpr int storm_blocks = 400;
+    constexpr int tail_blocks = 100;
+
+    auto gui = juce::ScopedJuceInitialiser_GUI {};
+    auto trace = juce::TemporaryFile(".log");
+    PluginProcessor plugin;
+    // Chord tracing stays on: it has to be real-time safe too
+    plugin.set_chord_trace_enabled(true);
+    plugin.set_chord_trace_file(trace.getFile());
+    plugin.prepareToPlay(sample_rate, block_size);
+    juce::AudioBuffer<float> buffer(2, block_size);
+    // Otherwise only built when convolution is first selected, below
+    plugin.load_impulse_response(jnickg::audio::ws::ir::Space::temple_hall);
+
+    // Warm up: first-use initialisation inside JUCE, and the background IR load landing
+    auto warm_up = note_storm(storm_blocks, block_size, 1);
+    process_storm(plugin, buffer, warm_up, tail_blocks);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    SECTION("in every phaser and reverb mode") {
+        using PhaserMode = PluginProcessor::PhaserMode;
+        using ReverbMode = PluginProcessor::ReverbMode;
+        for (auto phaser_mode : { PhaserMode::Global, PhaserMode::PerVoice }) {
+            for (auto reverb_mode : { ReverbMode::Fdn, ReverbMode::Convolution }) {
+                plugin.set_phaser_mode(phaser_mode);
+                plugin.set_reverb_mode(reverb_mode);
+                auto storm = note_storm(storm_blocks, block_size, 2);
+                auto report = process_storm(plugin, buffer, storm, tail_blocks);
+
+                INFO("phaser mode " << static_cast<int>(phaser_mode) << ", reverb mode " << static_cast<int>(reverb_mode));
+                INFO(report.to_string());
+                REQUIRE(report.is_realtime_safe());
+            }
+        }
+    }
+
+    SECTION("while settings change from another thread") {
+        std::atomic<bool> done { false };
+        std::thread ui([&] {
+            using Quality = jnickg::audio::ws::FdnReverb::Quality;
+            using OscillatorType = jnickg::audio::ws::Voice::OscillatorType;
+            size_t i = 0;
+            while (!done.load()) {
+                plugin.set_reverb_quality(i % 3 == 0 ? Quality::Eco : i % 3 == 1 ? Quality::Standard : Quality::High);
+                plugin.set_oscillator_type(i % 2 == 0 ? OscillatorType::Sine : OscillatorType::Saw);
+                plugin.set_max_chord_tones(1 + i % 5);
+                plugin.set_max_voices(1 + i % PluginProcessor::MAX_VOICES);
+                plugin.set_cpu_budget(i % 4 == 0 ? 0.5 : 0.0);
+                plugin.set_partial_sharing(i % 3 == 0);
+                plugin.set_scale_quantizer(static_cast<jnickg::audio::ws::ScaleQuantizer::Mode>(i % 5));
+                plugin.set_scale_degree_mapping(i % 7 < 3);
+                plugin.set_mpe(i % 3 != 0, i % 2 == 0 ? 48.0f : 24.0f);
+                plugin.set_strum(i % 4 == 0 ? 0.0 : 30.0, i % 2 == 0, static_cast<jnickg::audio::ws::StrumOrder>(i % 3));
+                ++i;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+        auto storm = note_storm(storm_blocks, block_size, 3);
+        auto report = process_storm(plugin, buffer, storm, tail_blocks);
+        done.store(true);
+        ui.join();
+
+        INFO(report.to_string());
+        REQUIRE(report.is_realtime_safe());
+    }
+
+    SECTION("while the key changes, from the UI and from automation") {
+        using jnickg::audio::note;
+        using jnickg::audio::scale;
+        const std::vector<jnickg::audio::key_info> keys {
+            { .root = note::C, .scale_type = scale::major },
+            { .root = note::D, .scale_type = scale::dorian },
+            { .root = note::A, .scale_type = scale::yonanuki },
+        };
+        // Tables are cached per key, so only the first build of each is slow
+        for (const auto& k : keys) {
+            plugin.set_key(k);
+        }
+
+        std::atomic<bool> done { false };
+        std::thread ui([&] {
+            auto* root = dynamic_cast<juce::AudioParameterChoice*>(plugin.getParameters()[0]);
+            auto* scale_type = dynamic_cast<juce::AudioParameterChoice*>(plugin.getParameters()[1]);
+            size_t i = 0;
+            while (!done.load()) {
+                const auto& k = keys[i % keys.size()];
+                if (i % 2 == 0) {
+                    plugin.set_key(k);
+                } else {
+                    // As a host would automate them; processBlock notices and asks for the new key
+                    *root = static_cast<int>(k.root);
+                    *scale_type = static_cast<int>(k.scale_type);
+                }
+                ++i;
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        });
+        auto storm = note_storm(storm_blocks, block_size, 4);
+        auto report = process_storm(plugin, buffer, storm, tail_blocks);
+        done.store(true);
+        ui.join();
+
+        INFO(report.to_string());
+        REQUIRE(report.is_realtime_safe());
+    }
+}
@@ -0,0 +1,114 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <PluginProcessor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+constexpr double SAMPLE_RATE = 48000.0;
+constexpr int BLOCK_SIZE = 256;
+
+float process_chord(PluginProcessor& plugin, int blocks) {
+    juce::MidiBuffer midi;
+    midi.addEvent(juce::MidiMessage::noteOn(1, 60, 0.8f), 0);
+    juce::AudioBuffer<float> buffer(2, BLOCK_SIZE);
+    auto peak = 0.0f;
+    for (int i = 0; i < blocks; ++i) {
+        buffer.clear();
+        plugin.processBlock(buffer, midi);
+        midi.clear();
+        peak = std::max(peak, buffer.getMagnitude(0, BLOCK_SIZE));
+    }
+    return peak;
+}
+
+// The IR is synthesized in the background; its length is known once it has been
+bool wait_for_impulse_response(const PluginProcessor& plugin, double tail_seconds) {
+    for (int i = 0; i < 500; ++i) {
+        if (plugin.getTailLengthSeconds() == tail_seconds) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+} // namespace
+
+TEST_CASE("PluginProcessor reverb modes") {
+    using ReverbMode = PluginProcessor::ReverbMode;
+    using jnickg::audio::ws::Voice;
+    namespace ir = jnickg::audio::ws::ir;
+
+    auto gui = juce::ScopedJuceInitialiser_GUI {};
+    PluginProcessor plugin;
+    plugin.set_chord_trace_enabled(false);
+    plugin.prepareToPlay(SAMPLE_RATE, BLOCK_SIZE);
+
+    SECTION("builds no impulse response until convolution is needed") {
+        REQUIRE_FALSE(plugin.has_impulse_response());
+        REQUIRE(process_chord(plugin, 20) > 0.0f);
+        REQUIRE_FALSE(plugin.has_impulse_response());
+
+        plugin.set_reverb_mode(ReverbMode::Convolution);
+        REQUIRE(plugin.has_impulse_response());
+    }
+
+    SECTION("keeps an impulse response loaded before convolution is selected") {
+        plugin.load_impulse_response(ir::Space::garden);
+        plugin.set_reverb_mode(ReverbMode::Convolution);
+        REQUIRE(wait_for_impulse_response(plugin, Voice::DEFAULT_RELEASE + ir::get_length_seconds(ir::Space::garden)));
+    }
+
+    SECTION("reopens each engine after a silence") {
+        for (auto mode : { ReverbMode::Fdn, ReverbMode::Convolution }) {
+            plugin.set_reverb_mode(mode);
+            wait_for_impulse_response(plugin, mode == ReverbMode::Fdn
+                ? plugin.getTailLengthSeconds()
+                : Voice::DEFAULT_RELEASE + ir::get_length_seconds(ir::Space::temple_hall));
+            REQUIRE(process_chord(plugin, 20) > 0.0f);
+
+            // Release the note, and wait out the release and the reverb tail
+            juce::MidiBuffer midi;
+            midi.addEvent(juce::MidiMessage::noteOff(1, 60), 0);
+            juce::AudioBuffer<float> buffer(2, BLOCK_SIZE);
+            for (int i = 0; i < 10000 && !plugin.is_fx_idle(); ++i) {
+                buffer.clear();
+                plugin.processBlock(buffer, midi);
+                midi.clear();
+            }
+            INFO("reverb mode " << static_cast<int>(mode));
+            REQUIRE(plugin.is_fx_idle());
+
+            // Idle, the whole block is skipped and comes out silent
+            for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+                juce::FloatVectorOperations::fill(buffer.getWritePointer(ch), 1.0f, BLOCK_SIZE);
+            }
+            plugin.processBlock(buffer, midi);
+            REQUIRE(buffer.getMagnitude(0, BLOCK_SIZE) == 0.0f);
+
+            auto peak = process_chord(plugin, 20);
+            REQUIRE(std::isfinite(peak));
+            REQUIRE(peak > 0.0f);
+            REQUIRE_FALSE(plugin.is_fx_idle());
+        }
+    }
+
+    SECTION("switches engines, and their tail lengths, both ways") {
+        auto fdn_tail = plugin.getTailLengthSeconds();
+        REQUIRE(fdn_tail > Voice::DEFAULT_RELEASE);
+
+        plugin.set_reverb_mode(ReverbMode::Convolution);
+        REQUIRE(plugin.get_reverb_mode() == ReverbMode::Convolution);
+        REQUIRE(wait_for_impulse_response(plugin, Voice::DEFAULT_RELEASE + ir::get_length_seconds(ir::Space::temple_hall)));
+        REQUIRE(process_chord(plugin, 20) > 0.0f);
+
+        plugin.set_reverb_mode(ReverbMode::Fdn);
+        REQUIRE(plugin.getTailLengthSeconds() == fdn_tail);
+        REQUIRE(process_chord(plugin, 20) > 0.0f);
+    }
+}
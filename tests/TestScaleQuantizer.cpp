@@ -0,0 +1,195 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <ScaleQuantizer.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using jnickg::audio::key_info;
+using jnickg::audio::note;
+using jnickg::audio::scale;
+using jnickg::audio::ws::MidiQuantizer;
+using jnickg::audio::ws::ScaleQuantizer;
+using Mode = ScaleQuantizer::Mode;
+
+namespace {
+
+const key_info c_major { .root = note::C, .scale_type = scale::major };
+const key_info a_yonanuki { .root = note::A, .scale_type = scale::yonanuki };
+
+struct Event {
+    bool on { false };
+    int note { 0 };
+    int channel { 1 };
+};
+
+std::vector<Event> get_notes(const juce::MidiBuffer& midi) {
+    std::vector<Event> events;
+    for (const auto metadata : midi) {
+        auto message = metadata.getMessage();
+        if (message.isNoteOnOrOff()) {
+            events.push_back({ message.isNoteOn(), message.getNoteNumber(), message.getChannel() });
+        }
+    }
+    return events;
+}
+
+juce::MidiBuffer note_on(int n, int channel = 1) {
+    juce::MidiBuffer midi;
+    midi.addEvent(juce::MidiMessage::noteOn(channel, n, static_cast<juce::uint8>(100)), 0);
+    return midi;
+}
+
+juce::MidiBuffer note_off(int n, int channel = 1) {
+    juce::MidiBuffer midi;
+    midi.addEvent(juce::MidiMessage::noteOff(channel, n), 0);
+    return midi;
+}
+
+} // namespace
+
+TEST_CASE("jnickg::audio::ws::ScaleQuantizer") {
+    SECTION("snaps out-of-key notes as the mode says") {
+        ScaleQuantizer q;
+        q.build(c_major);
+        REQUIRE(q.quantize(61, Mode::nearest, false) == 60);    // Ties go down
+        REQUIRE(q.quantize(61, Mode::up, false) == 62);
+        REQUIRE(q.quantize(61, Mode::down, false) == 60);
+        REQUIRE(q.quantize(61, Mode::drop, false) == ScaleQuantizer::DROP);
+        REQUIRE(q.quantize(61, Mode::off, false) == 61);
+        for (auto mode : { Mode::off, Mode::nearest, Mode::up, Mode::down, Mode::drop }) {
+            REQUIRE(q.quantize(64, mode, false) == 64);
+        }
+
+        q.build(a_yonanuki);
+        // A B C E F: D# is a semitone under E, and three over C
+        REQUIRE(q.quantize(63, Mode::nearest, false) == 64);
+        REQUIRE(q.quantize(63, Mode::down, false) == 60);
+    }
+
+    SECTION("only ever plays notes in key") {
+        ScaleQuantizer q;
+        for (int r = static_cast<int>(note::__FIRST); r < static_cast<int>(note::__COUNT); ++r) {
+            for (int s = static_cast<int>(scale::__FIRST); s < static_cast<int>(scale::__COUNT); ++s) {
+                key_info key { .root = static_cast<note>(r), .scale_type = static_cast<scale>(s) };
+                q.build(key);
+                auto notes = key.notes();
+                for (auto mode : { Mode::nearest, Mode::up, Mode::down, Mode::drop }) {
+                    for (auto mapping : { false, true }) {
+                        for (int m = 0; m < ScaleQuantizer::NUM_NOTES; ++m) {
+                            auto out = q.quantize(m, mode, mapping);
+                            INFO(key.to_string() << ", " << jnickg::audio::ws::to_string(mode) << ", note " << m);
+                            if (mode != Mode::drop && !mapping) {
+                                REQUIRE(out != ScaleQuantizer::DROP);
+                            }
+                            if (out != ScaleQuantizer::DROP) {
+                                REQUIRE(out >= 0);
+                                REQUIRE(std::find(notes.begin(), notes.end(), static_cast<note>(out % 12)) != notes.end());
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    SECTION("maps the white keys to scale degrees, from middle C on the root") {
+        ScaleQuantizer q;
+        q.build(a_yonanuki);
+        // A B C E F
+        REQUIRE(q.quantize(60, Mode::nearest, true) == 69);
+        REQUIRE(q.quantize(62, Mode::nearest, true) == 71);
+        REQUIRE(q.quantize(64, Mode::nearest, true) == 72);
+        REQUIRE(q.quantize(65, Mode::nearest, true) == 76);
+        REQUIRE(q.quantize(67, Mode::nearest, true) == 77);
+        REQUIRE(q.quantize(69, Mode::nearest, true) == 81);
+        REQUIRE(q.quantize(59, Mode::nearest, true) == 65);
+        // Black keys go to a neighbouring white key first
+        REQUIRE(q.quantize(61, Mode::nearest, true) == 69);
+        REQUIRE(q.quantize(61, Mode::up, true) == 71);
+        REQUIRE(q.quantize(61, Mode::drop, true) == ScaleQuantizer::DROP);
+        REQUIRE(q.quantize(61, Mode::off, true) == 61);
+    }
+}
+
+TEST_CASE("jnickg::audio::ws::MidiQuantizer") {
+    ScaleQuantizer q;
+    q.build(c_major);
+    MidiQuantizer stage;
+    stage.prepare(1024);
+
+    SECTION("passes MIDI straight through while off") {
+        auto midi = note_on(61);
+        REQUIRE(&stage.process(midi, q, Mode::off, false) == &midi);
+    }
+
+    SECTION("releases each note as it was played, across mode and key changes") {
+        auto on = note_on(61);
+        auto quantized = get_notes(stage.process(on, q, Mode::nearest, false));
+        REQUIRE(quantized.size() == 1);
+        REQUIRE(quantized[0].note == 60);
+
+        q.build(a_yonanuki);
+        auto off = note_off(61);
+        quantized = get_notes(stage.process(off, q, Mode::off, false));
+        REQUIRE(quantized.size() == 1);
+        REQUIRE_FALSE(quantized[0].on);
+        REQUIRE(quantized[0].note == 60);
+
+        // Nothing's remapped any more, so off really is off again
+        REQUIRE(&stage.process(off, q, Mode::off, false) == &off);
+    }
+
+    SECTION("drops the note-offs of dropped notes") {
+        auto on = note_on(61);
+        REQUIRE(get_notes(stage.process(on, q, Mode::drop, false)).empty());
+        auto off = note_off(61);
+        REQUIRE(get_notes(stage.process(off, q, Mode::nearest, false)).empty());
+    }
+
+    SECTION("releases the old note when one is struck again and lands elsewhere") {
+        auto on = note_on(61);
+        stage.process(on, q, Mode::nearest, false);
+        auto quantized = get_notes(stage.process(on, q, Mode::up, false));
+        REQUIRE(quantized.size() == 2);
+        REQUIRE_FALSE(quantized[0].on);
+        REQUIRE(quantized[0].note == 60);
+        REQUIRE(quantized[1].on);
+        REQUIRE(quantized[1].note == 62);
+    }
+
+    SECTION("tracks the same key held on two channels as two notes") {
+        auto on_2 = note_on(61, 2);
+        auto on_3 = note_on(61, 3);
+        REQUIRE(get_notes(stage.process(on_2, q, Mode::nearest, false))[0].note == 60);
+        auto quantized = get_notes(stage.process(on_3, q, Mode::up, false));
+        // Not a retrigger of channel 2's note, so nothing is released
+        REQUIRE(quantized.size() == 1);
+        REQUIRE(quantized[0].note == 62);
+        REQUIRE(quantized[0].channel == 3);
+
+        auto off_2 = note_off(61, 2);
+        quantized = get_notes(stage.process(off_2, q, Mode::off, false));
+        REQUIRE(quantized.size() == 1);
+        REQUIRE_FALSE(quantized[0].on);
+        REQUIRE(quantized[0].note == 60);
+        REQUIRE(quantized[0].channel == 2);
+
+        auto off_3 = note_off(61, 3);
+        quantized = get_notes(stage.process(off_3, q, Mode::off, false));
+        REQUIRE(quantized.size() == 1);
+        REQUIRE(quantized[0].note == 62);
+        REQUIRE(quantized[0].channel == 3);
+        REQUIRE(&stage.process(off_3, q, Mode::off, false) == &off_3);
+    }
+
+    SECTION("releases a retriggered note on the channel that started it") {
+        auto on = note_on(61, 5);
+        stage.process(on, q, Mode::nearest, false);
+        auto quantized = get_notes(stage.process(on, q, Mode::up, false));
+        REQUIRE(quantized.size() == 2);
+        REQUIRE_FALSE(quantized[0].on);
+        REQUIRE(quantized[0].note == 60);
+        REQUIRE(quantized[0].channel == 5);
+    }
+}
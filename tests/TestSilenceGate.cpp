@@ -0,0 +1,86 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <SilenceGate.hpp>
+
+#include "helpers/test_helpers.h"
+
+using jnickg::audio::ws::SilenceGate;
+
+TEST_CASE("jnickg::audio::ws::SilenceGate") {
+    constexpr double sample_rate = 48000.0;
+    constexpr int block_size = 480;
+
+    juce::AudioBuffer<float> buffer(2, block_size);
+    juce::dsp::AudioBlock<float> block(buffer);
+
+    SilenceGate gate;
+    gate.prepare(sample_rate, 1.0);
+
+    auto run_silent_blocks = [&](int count) {
+        for (int i = 0; i < count; ++i) {
+            buffer.clear();
+            if (gate.should_process(block)) {
+                gate.observe_output(block);
+            }
+        }
+    };
+
+    SECTION("goes idle once input and output have been silent for the hold time") {
+        // 50ms hold is 5 blocks of 10ms
+        run_silent_blocks(4);
+        REQUIRE(!gate.is_idle());
+        run_silent_blocks(1);
+        REQUIRE(gate.is_idle());
+    }
+
+    SECTION("stays active while the stage's own output is still ringing") {
+        for (int i = 0; i < 20; ++i) {
+            buffer.clear();
+            REQUIRE(gate.should_process(block));
+            buffer.setSample(0, 0, 0.1f);
+            gate.observe_output(block);
+        }
+        REQUIRE(!gate.is_idle());
+    }
+
+    SECTION("gives up after the maximum tail even if the output never settles") {
+        for (int i = 0; i < 100; ++i) {
+            buffer.clear();
+            if (gate.should_process(block)) {
+                buffer.setSample(0, 0, 0.1f);
+                gate.observe_output(block);
+            }
+        }
+        REQUIRE(gate.is_idle());
+    }
+
+    SECTION("wakes up as soon as input arrives") {
+        run_silent_blocks(10);
+        REQUIRE(gate.is_idle());
+
+        buffer.clear();
+        buffer.setSample(1, block_size - 1, 0.5f);
+        REQUIRE(gate.should_process(block));
+        REQUIRE(!gate.is_idle());
+    }
+
+    SECTION("says it's waking only on the block that reopens it") {
+        buffer.clear();
+        buffer.setSample(0, 0, 0.5f);
+        REQUIRE(gate.should_process(block));
+        REQUIRE_FALSE(gate.is_waking());
+
+        run_silent_blocks(10);
+        REQUIRE(gate.is_idle());
+        REQUIRE_FALSE(gate.is_waking());
+
+        buffer.clear();
+        buffer.setSample(0, 0, 0.5f);
+        REQUIRE(gate.should_process(block));
+        REQUIRE(gate.is_waking());
+        gate.observe_output(block);
+
+        REQUIRE(gate.should_process(block));
+        REQUIRE_FALSE(gate.is_waking());
+    }
+}
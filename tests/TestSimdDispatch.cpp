@@ -0,0 +1,137 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <FdnReverb.hpp>
+#include <SimdDispatch.hpp>
+#include <VoicePool.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using jnickg::audio::ws::FdnReverb;
+using jnickg::audio::ws::VoicePool;
+namespace simd = jnickg::audio::ws::simd;
+
+namespace {
+
+constexpr double sample_rate = 48000.0;
+constexpr int block_size = 256;
+constexpr int num_blocks = 40;
+
+std::vector<simd::Isa> get_supported() {
+    std::vector<simd::Isa> supported;
+    for (int i = static_cast<int>(simd::Isa::__FIRST); i < static_cast<int>(simd::Isa::__COUNT); ++i) {
+        auto isa = static_cast<simd::Isa>(i);
+        if (simd::is_supported(isa)) {
+            supported.push_back(isa);
+        }
+    }
+    return supported;
+}
+
+/**
+ * @brief Puts the active instruction set back however the test ends.
+ */
+struct ScopedIsa {
+    explicit ScopedIsa(simd::Isa isa) { simd::set_active(isa); }
+    ~ScopedIsa() { simd::set_active(this->previous); }
+    simd::Isa previous { simd::get_active() };
+};
+
+std::vector<float> render_voices(simd::Isa isa) {
+    ScopedIsa scoped(isa);
+    auto pool = std::make_unique<VoicePool>();
+    pool->prepare(sample_rate);
+    for (size_t v = 0; v < 10; ++v) {
+        auto& envelope = pool->get_envelope(v);
+        envelope.setSampleRate(sample_rate);
+        envelope.setParameters({ 0.01f, 0.1f, 0.8f, 0.05f });
+        pool->set_oscillator_type(v, static_cast<VoicePool::OscillatorType>(v % 5));
+        pool->set_phaser_enabled(v, v % 3 == 0);
+        auto tones = 1 + v % VoicePool::MAX_TONES;
+        for (size_t t = 0; t < tones; ++t) {
+            pool->set_frequency(v, t, 110.0f * static_cast<float>(v + 1) + 50.0f * static_cast<float>(t));
+        }
+        pool->set_num_tones(v, tones);
+        envelope.noteOn();
+        pool->set_held(v, true);
+    }
+
+    std::vector<float> out(block_size * num_blocks, 0.0f);
+    for (int b = 0; b < num_blocks; ++b) {
+        pool->render(out.data() + b * block_size, block_size);
+    }
+    return out;
+}
+
+std::vector<float> render_reverb(simd::Isa isa, FdnReverb::Quality quality) {
+    ScopedIsa scoped(isa);
+    FdnReverb reverb;
+    FdnReverb::Parameters params;
+    params.quality = quality;
+    reverb.set_parameters(params);
+    reverb.prepare({ sample_rate, block_size, 2 });
+
+    std::vector<float> left(block_size * num_blocks, 0.0f);
+    std::vector<float> right(block_size * num_blocks, 0.0f);
+    left[0] = 1.0f;
+    right[block_size / 2] = 1.0f;
+    for (int b = 0; b < num_blocks; ++b) {
+        reverb.process(left.data() + b * block_size, right.data() + b * block_size, block_size);
+    }
+    left.insert(left.end(), right.begin(), right.end());
+    return left;
+}
+
+float max_difference(const std::vector<float>& a, const std::vector<float>& b) {
+    auto d = 0.0f;
+    for (size_t i = 0; i < a.size(); ++i) {
+        d = std::max(d, std::abs(a[i] - b[i]));
+    }
+    return d;
+}
+
+} // namespace
+
+TEST_CASE("jnickg::audio::ws::simd") {
+    SECTION("always has the scalar fallback, and starts on the best instruction set") {
+        REQUIRE(simd::is_supported(simd::Isa::scalar));
+        REQUIRE(simd::is_supported(simd::get_best()));
+        REQUIRE(simd::get_active() == simd::get_best());
+        INFO("Best here: " << simd::to_string(simd::get_best()));
+        // Only one of the baselines is ever built
+        REQUIRE_FALSE((simd::is_compiled(simd::Isa::sse2) && simd::is_compiled(simd::Isa::neon)));
+    }
+
+    SECTION("refuses an instruction set it can't run") {
+        for (int i = static_cast<int>(simd::Isa::__FIRST); i < static_cast<int>(simd::Isa::__COUNT); ++i) {
+            auto isa = static_cast<simd::Isa>(i);
+            REQUIRE_FALSE(simd::to_string(isa).empty());
+            if (!simd::is_supported(isa)) {
+                REQUIRE_THROWS(simd::set_active(isa));
+                REQUIRE(simd::get_active() == simd::get_best());
+            }
+        }
+    }
+
+    SECTION("every path renders voices like the scalar one") {
+        auto scalar = render_voices(simd::Isa::scalar);
+        REQUIRE(std::any_of(scalar.begin(), scalar.end(), [](float s) { return s != 0.0f; }));
+        for (auto isa : get_supported()) {
+            INFO(simd::to_string(isa));
+            // Only FMA contraction should tell them apart
+            REQUIRE(max_difference(render_voices(isa), scalar) < 1.0e-5f);
+        }
+    }
+
+    SECTION("every path renders the reverb like the scalar one") {
+        for (auto quality : { FdnReverb::Quality::Eco, FdnReverb::Quality::Standard, FdnReverb::Quality::High }) {
+            auto scalar = render_reverb(simd::Isa::scalar, quality);
+            for (auto isa : get_supported()) {
+                INFO(simd::to_string(isa) << ", quality " << static_cast<int>(quality));
+                REQUIRE(max_difference(render_reverb(isa, quality), scalar) < 1.0e-5f);
+            }
+        }
+    }
+}
@@ -0,0 +1,177 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <LoadGenerator.hpp>
+#include <PluginProcessor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#if JUCE_LINUX
+    #include <unistd.h>
+#endif
+
+#include "helpers/realtime_checker.h"
+
+/*
+ * Plays hours of generated MIDI through the plugin and watches for slow trouble that short tests
+ * can't see: CPU time creeping up, memory growing, and denormals appearing in the output as
+ * feedback paths (reverb, phaser, filters) decay. The plugin normally flushes denormals to zero,
+ * which would hide them, so the soak runs with that off: a feedback path that decays into
+ * subnormals then shows up both in the output and as a slow block. It's hidden, so run it on purpose:
+ *
+ *   Tests "[soak]"
+ *
+ * WABISONORANCE_SOAK_SECONDS sets how much audio to play (default two hours, which renders in a
+ * few minutes on a desktop machine).
+ */
+
+namespace load = jnickg::audio::ws::load;
+
+namespace {
+
+constexpr double SAMPLE_RATE = 48000.0;
+constexpr int BLOCK_SIZE = 256;
+constexpr double DEFAULT_SOAK_SECONDS = 2.0 * 60.0 * 60.0;
+constexpr double WINDOW_SECONDS = 60.0;
+
+constexpr double MAX_CPU_DRIFT = 1.2;                       ///< Last windows over the first ones
+constexpr int DRIFT_WINDOWS = 3;                            ///< How many windows each side averages
+constexpr double MAX_MEMORY_GROWTH = 16.0 * 1024 * 1024;    ///< Bytes, after the first window
+
+struct Window {
+    double ns_per_sample { 0.0 };
+    double worst_block_load { 0.0 };    ///< Slowest block, as a fraction of its deadline
+    size_t subnormals { 0 };
+    size_t key_changes { 0 };
+    size_t resident_bytes { 0 };
+    realtime_checker::Report audio_thread;
+};
+
+double get_soak_seconds() {
+    auto seconds = juce::SystemStats::getEnvironmentVariable("WABISONORANCE_SOAK_SECONDS", {});
+    return seconds.isNotEmpty() ? seconds.getDoubleValue() : DEFAULT_SOAK_SECONDS;
+}
+
+/**
+ * @brief The process's resident memory, or 0 where it isn't known.
+ */
+size_t get_resident_bytes() {
+#if JUCE_LINUX
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    if (auto* statm = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(statm, "%zu %zu", &total_pages, &resident_pages) != 2) {
+            resident_pages = 0;
+        }
+        std::fclose(statm);
+    }
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+size_t count_subnormals(const juce::AudioBuffer<float>& buffer) {
+    size_t count = 0;
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        const auto* samples = buffer.getReadPointer(ch);
+        for (int i = 0; i < buffer.getNumSamples(); ++i) {
+            count += std::fpclassify(samples[i]) == FP_SUBNORMAL ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+double average_ns_per_sample(std::vector<Window>::const_iterator begin, std::vector<Window>::const_iterator end) {
+    double total = 0.0;
+    for (auto it = begin; it != end; ++it) {
+        total += it->ns_per_sample;
+    }
+    return total / static_cast<double>(std::distance(begin, end));
+}
+
+} // namespace
+
+TEST_CASE("Soak", "[.soak]") {
+    auto gui = juce::ScopedJuceInitialiser_GUI {};
+
+    PluginProcessor plugin;
+    plugin.set_chord_trace_enabled(false);
+    plugin.set_flush_denormals(false);
+    plugin.prepareToPlay(SAMPLE_RATE, BLOCK_SIZE);
+
+    load::Generator generator(load::Generator::Settings {}, SAMPLE_RATE);
+    juce::AudioBuffer<float> buffer(2, BLOCK_SIZE);
+    juce::MidiBuffer midi;
+    midi.ensureSize(4096);
+
+    const auto blocks_per_window = static_cast<int>(WINDOW_SECONDS * SAMPLE_RATE / BLOCK_SIZE);
+    const auto num_windows = std::max(static_cast<int>(get_soak_seconds() / WINDOW_SECONDS), 2 * DRIFT_WINDOWS + 1);
+    const auto block_seconds = BLOCK_SIZE / SAMPLE_RATE;
+
+    std::vector<Window> windows;
+    windows.reserve(static_cast<size_t>(num_windows));
+    printf("\n%8s %12s %12s %12s %8s %10s\n", "minute", "ns/sample", "worst block", "subnormals", "keys", "RSS (MB)");
+    for (int w = 0; w < num_windows; ++w) {
+        Window window;
+        std::chrono::steady_clock::duration busy {};
+        for (int b = 0; b < blocks_per_window; ++b) {
+            midi.clear();
+            if (auto key = generator.next_block(midi, BLOCK_SIZE)) {
+                // Builds the key's tables here, as a UI thread would; the next block swaps them in
+                plugin.set_key(*key);
+                ++window.key_changes;
+            }
+
+            buffer.clear();
+            auto start = std::chrono::steady_clock::now();
+            {
+                realtime_checker::ScopedAudioThread audio_thread;
+                plugin.processBlock(buffer, midi);
+                auto report = audio_thread.get_report();
+                window.audio_thread.allocations += report.allocations;
+                window.audio_thread.deallocations += report.deallocations;
+                window.audio_thread.locks += report.locks;
+                window.audio_thread.contended_locks += report.contended_locks;
+                window.audio_thread.syscalls += report.syscalls;
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            busy += elapsed;
+            window.worst_block_load = std::max(window.worst_block_load, std::chrono::duration<double>(elapsed).count() / block_seconds);
+            window.subnormals += count_subnormals(buffer);
+        }
+        window.ns_per_sample = std::chrono::duration<double, std::nano>(busy).count() / (blocks_per_window * BLOCK_SIZE);
+        window.resident_bytes = get_resident_bytes();
+        printf("%8d %12.2f %11.1f%% %12zu %8zu %10.1f\n",
+               w + 1,
+               window.ns_per_sample,
+               100.0 * window.worst_block_load,
+               window.subnormals,
+               window.key_changes,
+               static_cast<double>(window.resident_bytes) / (1024.0 * 1024.0));
+        fflush(stdout);
+        windows.push_back(window);
+    }
+
+    for (size_t w = 0; w < windows.size(); ++w) {
+        INFO("Minute " << w + 1);
+        INFO("Audio thread: " << windows[w].audio_thread.to_string());
+        CHECK(windows[w].audio_thread.is_realtime_safe());
+        CHECK(windows[w].subnormals == 0);
+    }
+
+    // The first window warms caches up and settles the SilenceGates, so drift is measured from the next ones
+    auto early = average_ns_per_sample(windows.begin() + 1, windows.begin() + 1 + DRIFT_WINDOWS);
+    auto late = average_ns_per_sample(windows.end() - DRIFT_WINDOWS, windows.end());
+    INFO("CPU: " << early << " ns/sample early on, " << late << " ns/sample at the end");
+    CHECK(late <= early * MAX_CPU_DRIFT);
+
+    if (windows.front().resident_bytes > 0) {
+        auto growth = static_cast<double>(windows.back().resident_bytes) - static_cast<double>(windows.front().resident_bytes);
+        INFO("Resident memory grew by " << growth / (1024.0 * 1024.0) << " MB after the first minute");
+        CHECK(growth <= MAX_MEMORY_GROWTH);
+    }
+}
@@ -0,0 +1,121 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <Tracer.hpp>
+
+#include <atomic>
+#include <set>
+#include <thread>
+
+#include "helpers/realtime_checker.h"
+
+using jnickg::audio::ws::Tracer;
+using realtime_checker::Report;
+using realtime_checker::ScopedAudioThread;
+
+namespace {
+
+juce::Array<juce::var> parse_events(const Tracer& tracer) {
+    juce::MemoryOutputStream out;
+    tracer.write_chrome_json(out);
+    auto json = juce::JSON::parse(out.toString());
+    REQUIRE(json.isObject());
+    auto* events = json["traceEvents"].getArray();
+    REQUIRE(events != nullptr);
+    return *events;
+}
+
+} // namespace
+
+TEST_CASE("jnickg::audio::ws::Tracer") {
+    Tracer tracer;
+
+    SECTION("records nothing until started") {
+        { Tracer::Scope s(&tracer, "early"); }
+        REQUIRE(tracer.get_num_events() == 0);
+    }
+
+    SECTION("writes Chrome trace JSON, one track per thread") {
+        tracer.start(16);
+        { Tracer::Scope s(&tracer, "main", 7); }
+        std::thread other([&] { Tracer::Scope s(&tracer, "other"); });
+        other.join();
+        tracer.stop();
+        { Tracer::Scope s(&tracer, "late"); }
+        REQUIRE(tracer.get_num_events() == 2);
+
+        std::set<int> tids;
+        std::set<juce::String> names;
+        for (const auto& e : parse_events(tracer)) {
+            if (e["ph"].toString() != "X") {
+                REQUIRE(e["ph"].toString() == "M");
+                continue;
+            }
+            tids.insert(static_cast<int>(e["tid"]));
+            names.insert(e["name"].toString());
+            REQUIRE(static_cast<double>(e["dur"]) >= 0.0);
+            if (e["name"].toString() == "main") {
+                REQUIRE(static_cast<int>(e["args"]["arg"]) == 7);
+            }
+        }
+        REQUIRE(tids.size() == 2);
+        REQUIRE(names == std::set<juce::String> { "main", "other" });
+    }
+
+    SECTION("restarting clears the previous trace") {
+        tracer.start(16);
+        { Tracer::Scope s(&tracer, "first"); }
+        tracer.start(16);
+        { Tracer::Scope s(&tracer, "second"); }
+        tracer.stop();
+        REQUIRE(tracer.get_num_events() == 1);
+    }
+
+    SECTION("drops and counts events when a thread's buffer is full") {
+        tracer.start(4);
+        for (int i = 0; i < 6; ++i) {
+            Tracer::Scope s(&tracer, "event", i);
+        }
+        tracer.stop();
+        REQUIRE(tracer.get_num_events() == 4);
+        REQUIRE(tracer.get_dropped() == 2);
+    }
+
+    SECTION("no event lands after stop() returns, even from another thread") {
+        std::atomic<bool> done { false };
+        std::thread recorder([&] {
+            while (!done.load()) {
+                Tracer::Scope s(&tracer, "busy");
+            }
+        });
+        auto late = 0;
+        for (int i = 0; i < 200; ++i) {
+            tracer.start(1024);
+            std::this_thread::yield();
+            tracer.stop();
+            auto count = tracer.get_num_events();
+            std::this_thread::yield();
+            if (tracer.get_num_events() != count) {
+                ++late;
+            }
+        }
+        done.store(true);
+        recorder.join();
+        REQUIRE(late == 0);
+    }
+
+    SECTION("records in real time") {
+        tracer.start(16);
+        Report report;
+        {
+            ScopedAudioThread audio_thread;
+            for (int i = 0; i < 8; ++i) {
+                Tracer::Scope s(&tracer, "block", i);
+            }
+            report = audio_thread.get_report();
+        }
+        tracer.stop();
+        INFO(report.to_string());
+        REQUIRE(report.is_realtime_safe());
+        REQUIRE(tracer.get_num_events() == 8);
+    }
+}
@@ -0,0 +1,470 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <VoicePool.hpp>
+
+#include <juce_dsp/juce_dsp.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "helpers/realtime_checker.h"
+
+using jnickg::audio::ws::MonoPhaser;
+using jnickg::audio::ws::VoicePool;
+
+namespace {
+
+float peak(const std::vector<float>& samples) {
+    auto p = 0.0f;
+    for (auto s : samples) {
+        p = std::max(p, std::abs(s));
+    }
+    return p;
+}
+
+// Energy of the changes between samples: higher for brighter sounds
+float roughness(const std::vector<float>& samples) {
+    auto r = 0.0f;
+    for (size_t i = 1; i < samples.size(); ++i) {
+        r += (samples[i] - samples[i - 1]) * (samples[i] - samples[i - 1]);
+    }
+    return r;
+}
+
+void start(VoicePool& pool, size_t voice, std::initializer_list<float> frequencies) {
+    size_t tone = 0;
+    for (auto f : frequencies) {
+        pool.set_frequency(voice, tone++, f);
+    }
+    pool.set_num_tones(voice, frequencies.size());
+    pool.get_envelope(voice).noteOn();
+    pool.set_held(voice, true);
+}
+
+/**
+ * @brief One voice the way it rendered before the VoicePool: a juce::dsp::Oscillator per tone, then
+ * the envelope, a juce::dsp::Gain and a juce::dsp::IIR::Filter, each stepped once per tone.
+ */
+class ReferenceVoice
+{
+public:
+    ReferenceVoice(double sample_rate, const juce::ADSR::Parameters& envelope_params, std::initializer_list<float> frequencies) {
+        juce::dsp::ProcessSpec spec { sample_rate, 4096, 1 };
+        for (auto f : frequencies) {
+            auto& osc = this->oscillators[this->num_tones++];
+            // VoicePool's saw, which needs no sine approximation to compare against
+            osc.initialise([](float x) { return std::clamp(x / juce::MathConstants<float>::pi, -0.6f, 0.6f); });
+            osc.prepare(spec);
+            osc.setFrequency(f, true);
+        }
+        this->gain.prepare(spec);
+        this->gain.setGainLinear(0.1f);
+        this->filter.coefficients = juce::dsp::IIR::Coefficients<float>::makeLowPass(sample_rate, VoicePool::CUTOFF);
+        this->filter.prepare(spec);
+        this->envelope.setSampleRate(sample_rate);
+        this->envelope.setParameters(envelope_params);
+        this->envelope.noteOn();
+        this->phaser.prepare(sample_rate);
+    }
+
+    void set_phaser_enabled(bool enabled) { this->phaser_enabled = enabled; }
+    void note_off() { this->envelope.noteOff(); }
+
+    void render(float* out, int num_samples) {
+        // Cut off with its envelope, phaser tail and all
+        if (!this->envelope.isActive()) {
+            return;
+        }
+        for (int i = 0; i < num_samples; ++i) {
+            auto voice_sample = 0.0f;
+            for (size_t t = 0; t < this->num_tones; ++t) {
+                auto x = this->oscillators[t].processSample(0.0f);
+                x *= this->envelope.getNextSample();
+                x = this->gain.processSample(x);
+                voice_sample += this->filter.processSample(x);
+            }
+            if (this->phaser_enabled) {
+                voice_sample = this->phaser.process_sample(voice_sample);
+            }
+            out[i] += voice_sample;
+        }
+    }
+
+private:
+    std::array<juce::dsp::Oscillator<float>, VoicePool::MAX_TONES> oscillators;
+    size_t num_tones { 0 };
+    juce::ADSR envelope;
+    juce::dsp::Gain<float> gain;
+    juce::dsp::IIR::Filter<float> filter;
+    MonoPhaser phaser;
+    bool phaser_enabled { false };
+};
+
+} // namespace
+
+TEST_CASE("jnickg::audio::ws::VoicePool") {
+    constexpr double sample_rate = 48000.0;
+    constexpr int block_size = 256;
+
+    VoicePool pool;
+    pool.prepare(sample_rate);
+    for (size_t v = 0; v < VoicePool::MAX_VOICES; ++v) {
+        auto& envelope = pool.get_envelope(v);
+        envelope.setSampleRate(sample_rate);
+        envelope.setParameters({ 0.01f, 0.1f, 0.8f, 0.05f });
+    }
+
+    std::vector<float> out(block_size, 0.0f);
+
+    SECTION("renders nothing while every voice is idle") {
+        pool.render(out.data(), block_size);
+        REQUIRE(peak(out) == 0.0f);
+    }
+
+    SECTION("renders held voices, and only those") {
+        start(pool, 3, { 220.0f, 277.2f, 329.6f });
+        REQUIRE(pool.is_active(3));
+        REQUIRE_FALSE(pool.is_active(2));
+
+        pool.render(2, out.data(), block_size);
+        REQUIRE(peak(out) == 0.0f);
+
+        for (int i = 0; i < 10; ++i) {
+            pool.render(out.data(), block_size);
+        }
+        REQUIRE(peak(out) > 0.0f);
+    }
+
+    for (auto sharing : { false, true }) {
+        DYNAMIC_SECTION("sounds like the juce::dsp chain it replaced" << (sharing ? ", sharing partials" : "")) {
+            pool.set_partial_sharing(sharing);
+
+            const juce::ADSR::Parameters envelope_params { 0.01f, 0.1f, 0.8f, 0.05f };
+            std::vector<ReferenceVoice> reference;
+            reference.emplace_back(sample_rate, envelope_params, std::initializer_list<float> { 220.0f, 330.0f, 440.0f });
+            reference.emplace_back(sample_rate, envelope_params, std::initializer_list<float> { 330.0f, 495.0f });
+            reference[1].set_phaser_enabled(true);
+
+            for (size_t v : { 0, 5 }) {
+                pool.set_oscillator_type(v, VoicePool::OscillatorType::Saw);
+                pool.get_phaser(v).prepare(sample_rate);
+            }
+            start(pool, 0, { 220.0f, 330.0f, 440.0f });
+            start(pool, 5, { 330.0f, 495.0f });
+            pool.set_phaser_enabled(5, true);
+            // juce's oscillators started on their pitch, rather than gliding to it
+            for (size_t v : { 0, 5 }) {
+                pool.reset(v);
+                pool.get_envelope(v).noteOn();
+                pool.set_held(v, true);
+            }
+
+            std::vector<float> expected(block_size, 0.0f);
+            auto max_difference = 0.0f;
+            auto loudest = 0.0f;
+            for (int b = 0; b < 40; ++b) {
+                if (b == 20) {
+                    for (size_t v : { 0, 5 }) {
+                        pool.get_envelope(v).noteOff();
+                        pool.set_held(v, false);
+                    }
+                    for (auto& r : reference) {
+                        r.note_off();
+                    }
+                }
+                std::fill(out.begin(), out.end(), 0.0f);
+                std::fill(expected.begin(), expected.end(), 0.0f);
+                pool.render(out.data(), block_size);
+                for (auto& r : reference) {
+                    r.render(expected.data(), block_size);
+                }
+                for (int i = 0; i < block_size; ++i) {
+                    max_difference = std::max(max_difference, std::abs(out[static_cast<size_t>(i)] - expected[static_cast<size_t>(i)]));
+                }
+                loudest = std::max(loudest, peak(expected));
+            }
+            REQUIRE(loudest > 0.01f);
+            REQUIRE(max_difference < 1.0e-5f);
+            REQUIRE_FALSE(pool.is_active(0));
+            REQUIRE_FALSE(pool.is_active(5));
+        }
+    }
+
+    SECTION("renders only the tones in use") {
+        start(pool, 0, { 220.0f, 277.2f, 329.6f, 415.3f, 493.9f });
+        start(pool, 1, { 220.0f, 277.2f, 329.6f });
+        pool.set_num_tones(0, 3);
+        REQUIRE(pool.get_num_tones(0) == 3);
+
+        std::vector<float> triad(block_size, 0.0f);
+        for (int i = 0; i < 10; ++i) {
+            pool.render(0, out.data(), block_size);
+            pool.render(1, triad.data(), block_size);
+        }
+        REQUIRE(out == triad);
+    }
+
+    SECTION("goes idle once a released voice's envelope ends") {
+        start(pool, 7, { 440.0f });
+        pool.render(out.data(), block_size);
+        pool.get_envelope(7).noteOff();
+        pool.set_held(7, false);
+        REQUIRE(pool.is_active(7));
+
+        // The release is 50ms
+        for (int i = 0; i < 20; ++i) {
+            pool.render(out.data(), block_size);
+        }
+        REQUIRE_FALSE(pool.is_active(7));
+    }
+
+    SECTION("reset silences a voice") {
+        start(pool, 1, { 440.0f });
+        pool.render(out.data(), block_size);
+        pool.reset(1);
+        REQUIRE_FALSE(pool.is_active(1));
+    }
+
+    SECTION("costs less to steal when released, and when quieter") {
+        start(pool, 0, { 220.0f });
+        start(pool, 1, { 330.0f });
+        start(pool, 2, { 440.0f });
+        for (int i = 0; i < 20; ++i) {
+            pool.render(out.data(), block_size);
+        }
+        pool.get_envelope(1).noteOff();
+        pool.set_held(1, false);
+        pool.render(out.data(), block_size);
+        pool.fade_out(2);
+
+        REQUIRE(pool.get_steal_cost(3) == 0.0f);    // idle
+        REQUIRE(pool.get_steal_cost(2) == 0.0f);    // fading
+        REQUIRE(pool.is_fading(2));
+        REQUIRE(pool.get_steal_cost(1) > 0.0f);
+        REQUIRE(pool.get_steal_cost(1) < pool.get_steal_cost(0));
+
+        // A fade is quick
+        for (int i = 0; i < 2; ++i) {
+            pool.render(out.data(), block_size);
+        }
+        REQUIRE_FALSE(pool.is_active(2));
+        REQUIRE_FALSE(pool.is_fading(2));
+    }
+
+    SECTION("sharing partials sounds the same as rendering each voice") {
+        pool.set_partial_sharing(true);
+        start(pool, 0, { 220.0f, 330.0f });
+        start(pool, 4, { 330.0f, 440.0f });
+        pool.set_oscillator_type(6, VoicePool::OscillatorType::Saw);
+        start(pool, 6, { 330.0f });
+        auto copy = pool;
+
+        // Odd sizes, so blocks end partway through a shared chunk
+        std::vector<float> one_by_one(block_size, 0.0f);
+        for (int i = 0; i < 20; ++i) {
+            pool.render(out.data(), block_size - 1 - i);
+            for (size_t v = 0; v < VoicePool::MAX_VOICES; ++v) {
+                copy.render(v, one_by_one.data(), block_size - 1 - i);
+            }
+        }
+        REQUIRE(out == one_by_one);
+    }
+
+    SECTION("renders a pitch held by two voices once") {
+        pool.set_partial_sharing(true);
+        start(pool, 0, { 220.0f, 330.0f });
+        pool.render(out.data(), block_size);
+        REQUIRE(pool.get_num_shared_partials() == 2);
+
+        // Starts in phase with voice 0's 330Hz, rather than gliding up from 0Hz
+        start(pool, 1, { 330.0f, 440.0f });
+        pool.render(out.data(), block_size);
+        REQUIRE(pool.get_num_shared_partials() == 3);
+
+        // A different waveform is a different partial
+        pool.set_oscillator_type(1, VoicePool::OscillatorType::Square);
+        pool.render(out.data(), block_size);
+        REQUIRE(pool.get_num_shared_partials() == 4);
+    }
+
+    SECTION("regroups partials once a released voice stops sounding") {
+        pool.set_partial_sharing(true);
+        start(pool, 0, { 220.0f, 330.0f });
+        start(pool, 1, { 330.0f, 440.0f });
+        pool.render(out.data(), block_size);
+        REQUIRE(pool.get_num_shared_partials() == 3);
+
+        // The release is 50ms; voice 1's 440Hz is heard until it ends
+        pool.get_envelope(1).noteOff();
+        pool.set_held(1, false);
+        pool.render(out.data(), block_size);
+        REQUIRE(pool.get_num_shared_partials() == 3);
+        for (int i = 0; i < 20; ++i) {
+            pool.render(out.data(), block_size);
+        }
+        REQUIRE_FALSE(pool.is_active(1));
+        REQUIRE(pool.get_num_shared_partials() == 2);
+    }
+
+    SECTION("starts each tone on its onset sample, however the blocks are split") {
+        constexpr int onset = 300;
+        constexpr int length = 4 * block_size;
+        pool.set_oscillator_type(2, VoicePool::OscillatorType::Saw);
+        start(pool, 2, { 220.0f });
+        pool.set_onset(2, 0, onset);
+        auto copy = pool;
+
+        std::vector<float> whole(length, 0.0f);
+        pool.render(whole.data(), length);
+        auto first = std::find_if(whole.begin(), whole.end(), [](float s) { return s != 0.0f; });
+        REQUIRE(first - whole.begin() == onset);
+
+        // Sizes that don't line up with the onset, or with each other
+        std::vector<float> split(length, 0.0f);
+        int done = 0;
+        for (int i = 0; done < length; ++i) {
+            auto n = std::min(1 + (i * 37) % 101, length - done);
+            copy.render(split.data() + done, n);
+            done += n;
+        }
+        REQUIRE(split == whole);
+    }
+
+    SECTION("strummed tones share partials once they've started together") {
+        pool.set_partial_sharing(true);
+        start(pool, 0, { 220.0f, 330.0f });
+        start(pool, 1, { 220.0f, 330.0f });
+        pool.set_onset(0, 1, block_size / 2);
+        pool.set_onset(1, 1, block_size / 2);
+        auto copy = pool;
+        pool.render(out.data(), block_size);
+        REQUIRE(pool.get_num_shared_partials() == 2);
+
+        std::vector<float> one_by_one(block_size, 0.0f);
+        copy.render(0, one_by_one.data(), block_size);
+        copy.render(1, one_by_one.data(), block_size);
+        REQUIRE(out == one_by_one);
+    }
+
+    SECTION("follows each voice's expression gain and cutoff") {
+        pool.set_oscillator_type(0, VoicePool::OscillatorType::Saw);
+        start(pool, 0, { 220.0f });
+        auto louder = pool;
+        auto brighter = pool;
+        louder.set_expression(0, 2.0f, VoicePool::CUTOFF);
+        brighter.set_expression(0, 1.0f, 4.0f * VoicePool::CUTOFF);
+
+        // Well past the envelope's attack and the expression's smoothing
+        std::vector<float> loud(block_size, 0.0f);
+        std::vector<float> bright(block_size, 0.0f);
+        for (int i = 0; i < 100; ++i) {
+            std::fill(out.begin(), out.end(), 0.0f);
+            std::fill(loud.begin(), loud.end(), 0.0f);
+            std::fill(bright.begin(), bright.end(), 0.0f);
+            pool.render(out.data(), block_size);
+            louder.render(loud.data(), block_size);
+            brighter.render(bright.data(), block_size);
+        }
+        REQUIRE(peak(loud) > 1.99f * peak(out));
+        REQUIRE(peak(loud) < 2.01f * peak(out));
+        REQUIRE(roughness(bright) > 2.0f * roughness(out));
+
+        // Back at rest, it's as if nothing had moved
+        louder.set_expression(0, 1.0f, VoicePool::CUTOFF);
+        for (int i = 0; i < 100; ++i) {
+            std::fill(out.begin(), out.end(), 0.0f);
+            std::fill(loud.begin(), loud.end(), 0.0f);
+            pool.render(out.data(), block_size);
+            louder.render(loud.data(), block_size);
+        }
+        REQUIRE(peak(loud) == peak(out));
+    }
+
+    SECTION("moves the cutoff on the same samples, however small the blocks") {
+        pool.set_oscillator_type(0, VoicePool::OscillatorType::Saw);
+        start(pool, 0, { 220.0f });
+        pool.render(out.data(), block_size);
+        pool.set_expression(0, 1.0f, 4.0f * VoicePool::CUTOFF);
+        auto split = pool;
+
+        // As a block split at every MIDI event might be
+        constexpr int length = 16 * VoicePool::SHARED_CHUNK;
+        std::vector<float> chunked(length, 0.0f);
+        std::vector<float> sample_by_sample(length, 0.0f);
+        pool.render(chunked.data(), length);
+        for (int i = 0; i < length; ++i) {
+            split.render(sample_by_sample.data() + i, 1);
+        }
+        REQUIRE(sample_by_sample == chunked);
+    }
+
+    SECTION("moves the expression gain without jumps") {
+        start(pool, 0, { 220.0f });
+        for (int i = 0; i < 100; ++i) {
+            std::fill(out.begin(), out.end(), 0.0f);
+            pool.render(out.data(), block_size);
+        }
+        auto steady = pool;
+        pool.set_expression(0, 4.0f, VoicePool::CUTOFF);
+
+        // Against the same voice at rest, it climbs block by block rather than all at once
+        std::vector<float> rest(block_size, 0.0f);
+        auto last_ratio = 1.0f;
+        for (int b = 0; b < 20; ++b) {
+            std::fill(out.begin(), out.end(), 0.0f);
+            std::fill(rest.begin(), rest.end(), 0.0f);
+            pool.render(out.data(), block_size);
+            steady.render(rest.data(), block_size);
+            auto ratio = peak(out) / peak(rest);
+            INFO("block " << b);
+            REQUIRE(ratio > last_ratio - 1.0e-3f);
+            REQUIRE(ratio < (b == 0 ? 3.0f : 4.01f));
+            last_ratio = ratio;
+        }
+        REQUIRE(last_ratio > 3.99f);
+    }
+
+    SECTION("sharing partials sounds the same with each voice's own expression") {
+        pool.set_partial_sharing(true);
+        start(pool, 0, { 220.0f, 330.0f });
+        start(pool, 1, { 220.0f, 330.0f });
+        pool.set_expression(1, 1.5f, 2.0f * VoicePool::CUTOFF);
+        auto copy = pool;
+
+        std::vector<float> one_by_one(block_size, 0.0f);
+        for (int i = 0; i < 20; ++i) {
+            if (i == 10) {
+                pool.set_expression(0, 0.5f, 0.5f * VoicePool::CUTOFF);
+                copy.set_expression(0, 0.5f, 0.5f * VoicePool::CUTOFF);
+            }
+            pool.render(out.data(), block_size - 1 - i);
+            for (size_t v = 0; v < VoicePool::MAX_VOICES; ++v) {
+                copy.render(v, one_by_one.data(), block_size - 1 - i);
+            }
+        }
+        REQUIRE(pool.get_num_shared_partials() == 2);
+        REQUIRE(out == one_by_one);
+    }
+
+    SECTION("renders without allocating") {
+        for (size_t v = 0; v < VoicePool::MAX_VOICES; ++v) {
+            pool.get_phaser(v).prepare(sample_rate);
+            pool.set_phaser_enabled(v, v % 2 == 0);
+            start(pool, v, { 110.0f * static_cast<float>(v + 1), 165.0f * static_cast<float>(v + 1) });
+        }
+        realtime_checker::Report report;
+        {
+            realtime_checker::ScopedAudioThread audio_thread;
+            for (int i = 0; i < 100; ++i) {
+                pool.set_partial_sharing(i % 2 == 0);
+                pool.set_expression(static_cast<size_t>(i) % VoicePool::MAX_VOICES, 1.0f + static_cast<float>(i % 3), VoicePool::CUTOFF * static_cast<float>(1 + i % 4));
+                pool.render(out.data(), block_size);
+            }
+            report = audio_thread.get_report();
+        }
+        INFO(report.to_string());
+        REQUIRE(report.is_realtime_safe());
+    }
+}
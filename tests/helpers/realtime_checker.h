@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/* Catches real-time-safety violations on the audio thread.
+ *
+ * The Tests target links in replacement hooks (see tests/RealtimeChecker.cpp) for:
+ *  - operator new/delete (all platforms)
+ *  - malloc, calloc, realloc and free (glibc)
+ *  - pthread_mutex_lock (glibc)
+ *  - stdio output, read/write and sleeping (glibc)
+ * They only count calls made by a thread inside a ScopedAudioThread, so the rest of the test
+ * binary is unaffected.
+ *
+ * Uncontended locks are counted, but aren't violations: juce::Synthesiser takes its own lock every
+ * block, and an uncontended lock never leaves user space. A lock that would block is one.
+ *
+ * Example usage
+ *
+  realtime_checker::Report report;
+  {
+      realtime_checker::ScopedAudioThread audio_thread;
+      plugin.processBlock (buffer, midi);
+      report = audio_thread.get_report();
+  }
+  INFO (report.to_string());
+  REQUIRE (report.is_realtime_safe());
+
+ */
+namespace realtime_checker {
+
+struct Report {
+    size_t allocations { 0 };
+    size_t deallocations { 0 };
+    size_t locks { 0 };
+    size_t contended_locks { 0 };
+    size_t syscalls { 0 };
+
+    bool is_realtime_safe() const {
+        return this->allocations == 0 && this->deallocations == 0 && this->contended_locks == 0 && this->syscalls == 0;
+    }
+
+    std::string to_string() const {
+        return std::to_string(this->allocations) + " allocations, "
+            + std::to_string(this->deallocations) + " deallocations, "
+            + std::to_string(this->contended_locks) + " contended locks (of " + std::to_string(this->locks) + "), "
+            + std::to_string(this->syscalls) + " I/O or sleep calls";
+    }
+};
+
+/// Whether the malloc, mutex and syscall hooks are available (operator new/delete always are).
+bool has_system_hooks();
+
+/// Counts violations on the calling thread for as long as it is alive. Doesn't nest.
+class ScopedAudioThread
+{
+public:
+    ScopedAudioThread();
+    ~ScopedAudioThread();
+
+    /// Counts so far. Doesn't allocate, so it's safe to call inside the scope.
+    Report get_report() const;
+
+    ScopedAudioThread (const ScopedAudioThread&) = delete;
+    ScopedAudioThread& operator= (const ScopedAudioThread&) = delete;
+};
+
+} // namespace realtime_checker